@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Counts the heap allocations of script verification. This is a binary of its
+// own because it replaces the global operator new, which would change the
+// behaviour of every benchmark in bench_bitcoin.
+
+#include <bench/script_spends.h>
+#include <key.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <tinyformat.h>
+
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+// operator new[] and the nothrow versions call this one.
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+static const int ITERATIONS = 1000;
+
+/**
+ * The stack traffic of verifying a spend, with stack elements of type T:
+ * the pushes of the scriptSig, the copy of its stack kept for P2SH, the stack
+ * built from the witness and the copy of the top element made by OP_DUP or
+ * taken as the redeem script. data is a buffer for the pushes.
+ */
+template <typename T>
+static void ReplayStacks(const ScriptSpend& spend, std::vector<unsigned char>& data)
+{
+    std::vector<T> stack;
+    CScript::const_iterator pc = spend.scriptSig.begin();
+    opcodetype opcode;
+    while (spend.scriptSig.GetOp(pc, opcode, data)) {
+        stack.emplace_back(data.begin(), data.end());
+    }
+    std::vector<T> stack_copy;
+    if (spend.scriptPubKey.IsPayToScriptHash()) stack_copy = stack;
+    for (const auto& element : spend.witness.stack) {
+        stack.emplace_back(element.begin(), element.end());
+    }
+    if (!stack.empty()) stack.push_back(T(stack.back()));
+}
+
+/** Heap allocations per iteration of fn. */
+template <typename F>
+static uint64_t CountAllocations(F fn)
+{
+    const uint64_t start = g_allocations.load(std::memory_order_relaxed);
+    for (int i = 0; i < ITERATIONS; ++i) fn();
+    return (g_allocations.load(std::memory_order_relaxed) - start) / ITERATIONS;
+}
+
+int main()
+{
+    ECC_Start();
+    const std::vector<ScriptSpend> spends = MakeScriptSpends();
+    ECC_Stop();
+
+    std::vector<unsigned char> data;
+    data.reserve(MAX_SCRIPT_ELEMENT_SIZE);
+    const uint64_t vector_stacks = CountAllocations([&] {
+        for (const ScriptSpend& spend : spends) ReplayStacks<std::vector<unsigned char>>(spend, data);
+    });
+    const uint64_t element_stacks = CountAllocations([&] {
+        for (const ScriptSpend& spend : spends) ReplayStacks<ScriptStackElement>(spend, data);
+    });
+
+    const AcceptingSignatureChecker checker;
+    const uint64_t verify = CountAllocations([&] {
+        for (const ScriptSpend& spend : spends) {
+            ScriptError err;
+            bool success = VerifyScript(spend.scriptSig, spend.scriptPubKey, &spend.witness, SCRIPT_SPENDS_FLAGS, checker, &err);
+            assert(success);
+        }
+    });
+
+    std::cout << strprintf("# Heap allocations of the stacks of a P2PKH, a P2WPKH, a P2SH and a P2WSH spend: %u with std::vector elements, %u with ScriptStackElement\n", vector_stacks, element_stacks);
+    std::cout << strprintf("# Heap allocations of VerifyScript of these spends: %u\n", verify);
+
+    // Only elements larger than a signature or a public key may allocate.
+    if (element_stacks >= vector_stacks) {
+        std::cerr << "ScriptStackElement does not allocate less than std::vector\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -4,7 +4,10 @@
 
 #include <bench/bench.h>
 
+#include <crypto/ripemd160.h>
 #include <crypto/sha256.h>
+#include <crypto/sha512.h>
+#include <crypto/siphash.h>
 #include <key.h>
 #include <util/strencodings.h>
 #include <util/system.h>
@@ -68,6 +71,11 @@ int main(int argc, char** argv)
             gArgs.GetArg("-plot-height", DEFAULT_PLOT_HEIGHT)));
     }
 
+    SHA256AutoDetect();
+    RIPEMD160AutoDetect();
+    SHA512AutoDetect();
+    SipHashAutoDetect();
+
     benchmark::BenchRunner::RunAll(*printer, evaluations, scaling_factor, regex_filter, is_list_only);
 
     return EXIT_SUCCESS;
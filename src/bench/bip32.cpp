@@ -0,0 +1,98 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <hash.h>
+#include <key.h>
+
+#include <numeric>
+#include <vector>
+
+static CExtKey MakeExtKey()
+{
+    static const unsigned char seed[32] = {1};
+    CExtKey key;
+    key.SetSeed(seed, sizeof(seed));
+    return key;
+}
+
+static std::vector<unsigned int> MakeChildren()
+{
+    std::vector<unsigned int> children(1000);
+    std::iota(children.begin(), children.end(), 0);
+    return children;
+}
+
+static void BIP32Hash_1000_Serial(benchmark::State& state)
+{
+    const CExtPubKey pubkey = MakeExtKey().Neuter();
+    const std::vector<unsigned int> children = MakeChildren();
+    std::vector<unsigned char> out(64 * children.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < children.size(); ++i) {
+            BIP32Hash(pubkey.chaincode, children[i], *pubkey.pubkey.begin(), pubkey.pubkey.begin() + 1, out.data() + 64 * i);
+        }
+    }
+}
+
+static void BIP32HashMulti_1000(benchmark::State& state)
+{
+    const CExtPubKey pubkey = MakeExtKey().Neuter();
+    const std::vector<unsigned int> children = MakeChildren();
+    std::vector<unsigned char> out(64 * children.size());
+    while (state.KeepRunning()) {
+        BIP32HashMulti(pubkey.chaincode, children.data(), children.size(), *pubkey.pubkey.begin(), pubkey.pubkey.begin() + 1, out.data());
+    }
+}
+
+static void BIP32DerivePub_1000_Serial(benchmark::State& state)
+{
+    const CExtPubKey pubkey = MakeExtKey().Neuter();
+    const std::vector<unsigned int> children = MakeChildren();
+    std::vector<CExtPubKey> out(children.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < children.size(); ++i) {
+            pubkey.Derive(out[i], children[i]);
+        }
+    }
+}
+
+static void BIP32DerivePubMulti_1000(benchmark::State& state)
+{
+    const CExtPubKey pubkey = MakeExtKey().Neuter();
+    const std::vector<unsigned int> children = MakeChildren();
+    std::vector<CExtPubKey> out;
+    while (state.KeepRunning()) {
+        pubkey.DeriveMulti(out, children);
+    }
+}
+
+static void BIP32DerivePriv_1000_Serial(benchmark::State& state)
+{
+    const CExtKey key = MakeExtKey();
+    const std::vector<unsigned int> children = MakeChildren();
+    std::vector<CExtKey> out(children.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < children.size(); ++i) {
+            key.Derive(out[i], children[i]);
+        }
+    }
+}
+
+static void BIP32DerivePrivMulti_1000(benchmark::State& state)
+{
+    const CExtKey key = MakeExtKey();
+    const std::vector<unsigned int> children = MakeChildren();
+    std::vector<CExtKey> out;
+    while (state.KeepRunning()) {
+        key.DeriveMulti(out, children);
+    }
+}
+
+BENCHMARK(BIP32Hash_1000_Serial, 100);
+BENCHMARK(BIP32HashMulti_1000, 100);
+BENCHMARK(BIP32DerivePub_1000_Serial, 5);
+BENCHMARK(BIP32DerivePubMulti_1000, 5);
+BENCHMARK(BIP32DerivePriv_1000_Serial, 5);
+BENCHMARK(BIP32DerivePrivMulti_1000, 5);
@@ -0,0 +1,71 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <policy/policy.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <vector>
+
+//! Transactions in the mempool the block is reconstructed from
+static const int MEMPOOL_SIZE = 50000;
+//! Transactions in the block besides the coinbase
+static const int BLOCK_SIZE = 2000;
+
+static void AddTx(const CTransactionRef& tx, const CAmount& nFee, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    LockPoints lp;
+    pool.addUnchecked(CTxMemPoolEntry(tx, nFee, 0, 1, false, 4, lp));
+}
+
+static CTransactionRef MakeTx(uint32_t n)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.n = n;
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx.vout[0].nValue = 10 * COIN;
+    return MakeTransactionRef(tx);
+}
+
+/**
+ * Reconstruct a block of the highest fee transactions from a large mempool,
+ * or one that also has a transaction the mempool does not, which means
+ * searching all of it.
+ */
+static void CompactBlockInitData(benchmark::State& state, bool missing_tx)
+{
+    CTxMemPool pool;
+    CBlock block;
+    block.nBits = 0x207fffff;
+    block.vtx.push_back(MakeTx(std::numeric_limits<uint32_t>::max()));
+    {
+        LOCK2(cs_main, pool.cs);
+        for (int i = 0; i < MEMPOOL_SIZE; ++i) {
+            const CTransactionRef tx = MakeTx(i);
+            AddTx(tx, 1000 + i, pool);
+            if (i >= MEMPOOL_SIZE - BLOCK_SIZE) block.vtx.push_back(tx);
+        }
+    }
+    if (missing_tx) block.vtx.back() = MakeTx(MEMPOOL_SIZE);
+    const CBlockHeaderAndShortTxIDs cmpctblock(block, true);
+    const std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
+
+    while (state.KeepRunning()) {
+        PartiallyDownloadedBlock partial_block(&pool);
+        const ReadStatus status = partial_block.InitData(cmpctblock, extra_txn);
+        assert(status == READ_STATUS_OK);
+        assert(partial_block.IsTxAvailable(block.vtx.size() - 1) != missing_tx);
+    }
+}
+
+static void CompactBlockInitDataAllInMempool(benchmark::State& state) { CompactBlockInitData(state, false); }
+static void CompactBlockInitDataMissingTx(benchmark::State& state) { CompactBlockInitData(state, true); }
+
+BENCHMARK(CompactBlockInitDataAllInMempool, 500);
+BENCHMARK(CompactBlockInitDataMissingTx, 50);
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <crypto/sha256.h>
 #include <util/system.h>
 #include <validation.h>
 #include <checkqueue.h>
@@ -36,7 +37,7 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
         }
         void swap(PrevectorJob& x){p.swap(x.p);};
     };
-    CCheckQueue<PrevectorJob> queue {QUEUE_BATCH_SIZE};
+    CCheckQueue<PrevectorJob> queue {QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS};
     boost::thread_group tg;
     for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
        tg.create_thread([&]{queue.Thread();});
@@ -60,3 +61,53 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.join_all();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+
+// This Benchmark tests how the CheckQueue scales with the number of threads
+// (the master and threads-1 workers, as with -par), with a block's worth of
+// checks that each do a few microseconds of work.
+static void CCheckQueueScaling(benchmark::State& state, int threads)
+{
+    struct HashJob {
+        unsigned char data[CSHA256::OUTPUT_SIZE] = {};
+        bool operator()()
+        {
+            for (int i = 0; i < 16; ++i) {
+                CSHA256().Write(data, sizeof(data)).Finalize(data);
+            }
+            return true;
+        }
+        void swap(HashJob& x) { std::swap(data, x.data); }
+    };
+    CCheckQueue<HashJob> queue {QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS};
+    boost::thread_group tg;
+    for (auto x = 0; x < threads - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        CCheckQueueControl<HashJob> control(&queue);
+        // Transactions of one to four inputs, as in a typical block
+        for (size_t i = 0; i < BATCHES * BATCH_SIZE / 2; ++i) {
+            std::vector<HashJob> vChecks(1 + i % 4);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void CCheckQueueScaling_1Thread(benchmark::State& state) { CCheckQueueScaling(state, 1); }
+static void CCheckQueueScaling_2Threads(benchmark::State& state) { CCheckQueueScaling(state, 2); }
+static void CCheckQueueScaling_4Threads(benchmark::State& state) { CCheckQueueScaling(state, 4); }
+static void CCheckQueueScaling_8Threads(benchmark::State& state) { CCheckQueueScaling(state, 8); }
+static void CCheckQueueScaling_16Threads(benchmark::State& state) { CCheckQueueScaling(state, 16); }
+static void CCheckQueueScaling_32Threads(benchmark::State& state) { CCheckQueueScaling(state, 32); }
+static void CCheckQueueScaling_64Threads(benchmark::State& state) { CCheckQueueScaling(state, 64); }
+
+BENCHMARK(CCheckQueueScaling_1Thread, 20);
+BENCHMARK(CCheckQueueScaling_2Threads, 20);
+BENCHMARK(CCheckQueueScaling_4Threads, 20);
+BENCHMARK(CCheckQueueScaling_8Threads, 20);
+BENCHMARK(CCheckQueueScaling_16Threads, 20);
+BENCHMARK(CCheckQueueScaling_32Threads, 20);
+BENCHMARK(CCheckQueueScaling_64Threads, 20);
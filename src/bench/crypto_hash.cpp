@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <iostream>
+#include <numeric>
 
 #include <bench/bench.h>
 #include <bloom.h>
@@ -61,6 +62,87 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+/** 1024 messages of transaction-like sizes, to hash one at a time or in lanes. */
+static void MakeMessages(std::vector<uint8_t>& data, std::vector<const unsigned char*>& inputs, std::vector<size_t>& lengths)
+{
+    FastRandomContext rng(true);
+    for (int i = 0; i < 1024; ++i) {
+        lengths.push_back(150 + rng.randrange(500));
+    }
+    data.resize(std::accumulate(lengths.begin(), lengths.end(), size_t{0}));
+    size_t pos = 0;
+    for (size_t length : lengths) {
+        inputs.push_back(data.data() + pos);
+        pos += length;
+    }
+}
+
+static void SHA256D_1024_Serial(benchmark::State& state)
+{
+    std::vector<uint8_t> data, out(32 * 1024);
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    MakeMessages(data, inputs, lengths);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            CHash256().Write(inputs[i], lengths[i]).Finalize(out.data() + 32 * i);
+        }
+    }
+}
+
+static void SHA256DMulti_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> data, out(32 * 1024);
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    MakeMessages(data, inputs, lengths);
+    while (state.KeepRunning()) {
+        SHA256DMulti(out.data(), inputs.data(), lengths.data(), inputs.size());
+    }
+}
+
+/** 1024 compressed public key sized messages, for Hash160. */
+static void MakePubKeys(std::vector<uint8_t>& data, std::vector<const unsigned char*>& inputs, std::vector<size_t>& lengths)
+{
+    data.resize(33 * 1024);
+    for (size_t i = 0; i < 1024; ++i) {
+        inputs.push_back(data.data() + 33 * i);
+        lengths.push_back(33);
+    }
+}
+
+static void Hash160_1024_Serial(benchmark::State& state)
+{
+    std::vector<uint8_t> data, out(20 * 1024);
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    MakePubKeys(data, inputs, lengths);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            CHash160().Write(inputs[i], lengths[i]).Finalize(out.data() + 20 * i);
+        }
+    }
+}
+
+static void Hash160Multi_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> data, out(20 * 1024);
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    MakePubKeys(data, inputs, lengths);
+    while (state.KeepRunning()) {
+        Hash160Multi(out.data(), inputs.data(), lengths.data(), inputs.size());
+    }
+}
+
+static void RIPEMD160_32_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(32 * 1024, 0), out(20 * 1024);
+    while (state.KeepRunning()) {
+        RIPEMD160_32(out.data(), in.data(), 1024);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -78,6 +160,56 @@ static void SipHash_32b(benchmark::State& state)
     }
 }
 
+static void SipHashUint256_1024_Serial(benchmark::State& state)
+{
+    std::vector<uint256> vals(1024);
+    std::vector<uint64_t> out(1024);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vals.size(); ++i) {
+            out[i] = SipHashUint256(0, 1, vals[i]);
+        }
+    }
+}
+
+static void SipHashUint256Multi_1024(benchmark::State& state)
+{
+    std::vector<uint256> vals(1024);
+    std::vector<const uint256*> inputs;
+    std::vector<uint64_t> out(1024);
+    for (const uint256& val : vals) {
+        inputs.push_back(&val);
+    }
+    while (state.KeepRunning()) {
+        SipHashUint256Multi(0, 1, out.data(), inputs.data(), inputs.size());
+    }
+}
+
+static void SipHash_1024_Serial(benchmark::State& state)
+{
+    std::vector<uint8_t> data;
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    std::vector<uint64_t> out(1024);
+    MakePubKeys(data, inputs, lengths);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            out[i] = CSipHasher(0, 1).Write(inputs[i], lengths[i]).Finalize();
+        }
+    }
+}
+
+static void SipHashMulti_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> data;
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    std::vector<uint64_t> out(1024);
+    MakePubKeys(data, inputs, lengths);
+    while (state.KeepRunning()) {
+        SipHashMulti(0, 1, out.data(), inputs.data(), lengths.data(), inputs.size());
+    }
+}
+
 static void FastRandom_32bit(benchmark::State& state)
 {
     FastRandomContext rng(true);
@@ -101,6 +233,15 @@ BENCHMARK(SHA512, 330);
 
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
+BENCHMARK(SipHashUint256_1024_Serial, 40 * 1000);
+BENCHMARK(SipHashUint256Multi_1024, 40 * 1000);
+BENCHMARK(SipHash_1024_Serial, 30 * 1000);
+BENCHMARK(SipHashMulti_1024, 30 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256D_1024_Serial, 1000);
+BENCHMARK(SHA256DMulti_1024, 1000);
+BENCHMARK(RIPEMD160_32_1024, 1000);
+BENCHMARK(Hash160_1024_Serial, 1000);
+BENCHMARK(Hash160Multi_1024, 1000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
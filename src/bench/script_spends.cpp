@@ -0,0 +1,42 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/script_spends.h>
+
+#include <key.h>
+#include <script/standard.h>
+#include <uint256.h>
+
+#include <array>
+
+std::vector<ScriptSpend> MakeScriptSpends()
+{
+    std::vector<CKey> keys(3);
+    std::vector<CPubKey> pubkeys;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        std::array<unsigned char, 32> vchKey{};
+        vchKey[31] = i + 1;
+        keys[i].Set(vchKey.begin(), vchKey.end(), true);
+        pubkeys.push_back(keys[i].GetPubKey());
+    }
+    // Signatures of anything will do
+    std::vector<std::vector<unsigned char>> sigs(2);
+    for (size_t i = 0; i < sigs.size(); ++i) {
+        keys[i].Sign(uint256S("1"), sigs[i]);
+        sigs[i].push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    }
+    const CScript multisig = GetScriptForMultisig(2, pubkeys);
+    const std::vector<unsigned char> multisig_bytes(multisig.begin(), multisig.end());
+
+    std::vector<ScriptSpend> spends(4);
+    spends[0].scriptSig = CScript() << sigs[0] << ToByteVector(pubkeys[0]);
+    spends[0].scriptPubKey = GetScriptForDestination(pubkeys[0].GetID());
+    spends[1].scriptPubKey = GetScriptForDestination(WitnessV0KeyHash(pubkeys[0].GetID()));
+    spends[1].witness.stack = {sigs[0], ToByteVector(pubkeys[0])};
+    spends[2].scriptSig = CScript() << OP_0 << sigs[0] << sigs[1] << multisig_bytes;
+    spends[2].scriptPubKey = GetScriptForDestination(CScriptID(multisig));
+    spends[3].scriptPubKey = GetScriptForDestination(WitnessV0ScriptHash(multisig));
+    spends[3].witness.stack = {{}, sigs[0], sigs[1], multisig_bytes};
+    return spends;
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BENCH_SCRIPT_SPENDS_H
+#define BITCOIN_BENCH_SCRIPT_SPENDS_H
+
+#include <script/interpreter.h>
+#include <script/script.h>
+
+#include <vector>
+
+/** Flags the spends of MakeScriptSpends() are valid under, with an AcceptingSignatureChecker. */
+static const unsigned int SCRIPT_SPENDS_FLAGS = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY |
+    SCRIPT_VERIFY_CHECKSEQUENCEVERIFY | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_NULLDUMMY;
+
+struct ScriptSpend {
+    CScript scriptSig;
+    CScript scriptPubKey;
+    CScriptWitness witness;
+};
+
+/**
+ * A P2PKH, a P2WPKH, a 2-of-3 P2SH multisig and a 2-of-3 P2WSH multisig
+ * spend, with signatures of nothing in particular. Needs ECC to be started.
+ */
+std::vector<ScriptSpend> MakeScriptSpends();
+
+/** Accepts every signature, so that only the script interpreter itself is measured. */
+class AcceptingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckSig(Span<const unsigned char> scriptSig, Span<const unsigned char> vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override { return true; }
+};
+
+#endif // BITCOIN_BENCH_SCRIPT_SPENDS_H
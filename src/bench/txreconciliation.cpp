@@ -0,0 +1,95 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <node/txreconciliation.h>
+#include <protocol.h>
+#include <random.h>
+#include <serialize.h>
+#include <tinyformat.h>
+#include <version.h>
+
+#include <iostream>
+#include <vector>
+
+//! Transactions that reach a node between two reconciliations with a peer
+static const int TXS_PER_ROUND = 100;
+//! Chance that one end of a connection has not heard of a transaction from its other peers by the time the connection reconciles
+static const int MISSING_PERCENT = 10;
+//! Size of an inv entry
+static const size_t INV_ENTRY_SIZE = 36;
+
+static size_t MessageSize(size_t payload)
+{
+    return CMessageHeader::HEADER_SIZE + payload;
+}
+
+static size_t InvSize(size_t count)
+{
+    return count == 0 ? 0 : MessageSize(GetSizeOfCompactSize(count) + count * INV_ENTRY_SIZE);
+}
+
+/**
+ * One round of transaction relay on each connection of a node with the given
+ * number of peers: time the reconciliations, and compare the announcement
+ * bytes they take to flooding, which sends at least one inv entry per
+ * transaction on every connection. Getdata and tx messages are the same
+ * either way and left out.
+ */
+static void TxReconciliation(benchmark::State& state, int peers)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> txids(TXS_PER_ROUND);
+    for (uint256& txid : txids) txid = rng.rand256();
+
+    // Which of the transactions each end of each connection knows about
+    std::vector<std::vector<bool>> node_has(peers), peer_has(peers);
+    for (int p = 0; p < peers; ++p) {
+        for (int i = 0; i < TXS_PER_ROUND; ++i) {
+            node_has[p].push_back(rng.randrange(100) >= MISSING_PERCENT);
+            peer_has[p].push_back(rng.randrange(100) >= MISSING_PERCENT);
+        }
+    }
+
+    uint64_t rounds = 0, flooding_bytes = 0, reconciliation_bytes = 0, failures = 0;
+    while (state.KeepRunning()) {
+        for (int p = 0; p < peers; ++p) {
+            const uint64_t salt1 = rng.rand64(), salt2 = rng.rand64();
+            TxReconciliationState initiator(true, salt1, salt2), responder(false, salt2, salt1);
+            size_t known = 0;
+            for (int i = 0; i < TXS_PER_ROUND; ++i) {
+                if (node_has[p][i]) initiator.Add(txids[i]);
+                if (peer_has[p][i]) responder.Add(txids[i]);
+                known += node_has[p][i] || peer_has[p][i];
+            }
+            flooding_bytes += InvSize(known);
+
+            std::vector<unsigned char> sketch;
+            std::vector<uint256> initiator_announce, responder_announce;
+            const uint32_t set_size = initiator.StartRequest(0, 0);
+            responder.HandleRequest(set_size, sketch, responder_announce);
+            std::vector<uint32_t> request;
+            const bool success = initiator.HandleSketch(sketch, initiator_announce, request);
+            responder.HandleDiff(success, request, responder_announce);
+            failures += !success;
+
+            reconciliation_bytes += MessageSize(sizeof(set_size));
+            reconciliation_bytes += MessageSize(GetSerializeSize(sketch, PROTOCOL_VERSION));
+            reconciliation_bytes += MessageSize(sizeof(success) + GetSerializeSize(request, PROTOCOL_VERSION));
+            reconciliation_bytes += InvSize(initiator_announce.size()) + InvSize(responder_announce.size());
+        }
+        ++rounds;
+    }
+
+    std::cerr << strprintf("# TxReconciliation%dPeers: %u announcement bytes per round by flooding, %u by reconciliation (%d%% saved), %u of %u reconciliations failed\n",
+        peers, flooding_bytes / rounds, reconciliation_bytes / rounds, 100 - (int)(100 * reconciliation_bytes / flooding_bytes), failures, rounds * peers);
+}
+
+static void TxReconciliation8Peers(benchmark::State& state) { TxReconciliation(state, 8); }
+static void TxReconciliation32Peers(benchmark::State& state) { TxReconciliation(state, 32); }
+static void TxReconciliation125Peers(benchmark::State& state) { TxReconciliation(state, 125); }
+
+BENCHMARK(TxReconciliation8Peers, 50);
+BENCHMARK(TxReconciliation32Peers, 12);
+BENCHMARK(TxReconciliation125Peers, 3);
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <bench/script_spends.h>
 #include <key.h>
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
@@ -106,4 +107,52 @@ static void VerifyScriptBench(benchmark::State& state)
     }
 }
 
+// The legacy SIGHASH_ALL signature hashes of all inputs of a transaction with
+// 1000 P2PKH inputs and 2 outputs, which take time quadratic in its size.
+static void SignatureHashLegacy(benchmark::State& state, bool midstates)
+{
+    const int inputs = 1000;
+
+    CMutableTransaction txSpend;
+    txSpend.vin.resize(inputs);
+    txSpend.vout.resize(2);
+    for (int i = 0; i < inputs; ++i) {
+        txSpend.vin[i].prevout.hash = uint256S("1");
+        txSpend.vin[i].prevout.n = i;
+        // A signature and a compressed public key
+        txSpend.vin[i].scriptSig = CScript() << std::vector<unsigned char>(72) << std::vector<unsigned char>(33);
+    }
+    const CScript code = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+    const CTransaction tx(txSpend);
+
+    while (state.KeepRunning()) {
+        const PrecomputedTransactionData txdata(tx);
+        for (int i = 0; i < inputs; ++i) {
+            SignatureHash(code, tx, i, SIGHASH_ALL, 0, SigVersion::BASE, midstates ? &txdata : nullptr);
+        }
+    }
+}
+
+static void SignatureHashLegacy_1000(benchmark::State& state) { SignatureHashLegacy(state, false); }
+static void SignatureHashLegacyMidstates_1000(benchmark::State& state) { SignatureHashLegacy(state, true); }
+
+// Evaluation of the spends of MakeScriptSpends() with the signature checks
+// stubbed out, which measures the script interpreter itself. The heap
+// allocations it makes are counted by bench_allocations.
+static void VerifyScriptInterpreter(benchmark::State& state)
+{
+    const std::vector<ScriptSpend> spends = MakeScriptSpends();
+    const AcceptingSignatureChecker checker;
+    while (state.KeepRunning()) {
+        for (const ScriptSpend& spend : spends) {
+            ScriptError err;
+            bool success = VerifyScript(spend.scriptSig, spend.scriptPubKey, &spend.witness, SCRIPT_SPENDS_FLAGS, checker, &err);
+            assert(success);
+        }
+    }
+}
+
 BENCHMARK(VerifyScriptBench, 6300);
+BENCHMARK(VerifyScriptInterpreter, 20000);
+BENCHMARK(SignatureHashLegacy_1000, 5);
+BENCHMARK(SignatureHashLegacyMidstates_1000, 5);
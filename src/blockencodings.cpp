@@ -14,18 +14,27 @@
 #include <validation.h>
 #include <util/system.h>
 
+#include <algorithm>
 #include <unordered_map>
 
+//! Mempool transactions looked through in ancestor fee rate order, per short id, before searching all of them
+static const size_t MEMPOOL_FIRST_PASS_FACTOR = 4;
+//! Mempool transactions whose short ids are computed together
+static const size_t SHORTID_BATCH_SIZE = 64;
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
         shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
     FillShortTxIDSelector();
     //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
     prefilledtxn[0] = {0, block.vtx[0]};
+    std::vector<const uint256*> txhashes;
+    txhashes.reserve(shorttxids.size());
     for (size_t i = 1; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
+        txhashes.push_back(fUseWTXID ? &tx.GetWitnessHash() : &tx.GetHash());
     }
+    GetShortIDs(shorttxids.data(), txhashes.data(), txhashes.size());
 }
 
 void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const {
@@ -44,6 +53,13 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
 }
 
+void CBlockHeaderAndShortTxIDs::GetShortIDs(uint64_t* shortids, const uint256* const* txhashes, size_t count) const {
+    SipHashUint256Multi(shorttxidk0, shorttxidk1, shortids, txhashes, count);
+    for (size_t i = 0; i < count; i++) {
+        shortids[i] &= 0xffffffffffffL;
+    }
+}
+
 
 
 ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
@@ -105,36 +121,75 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     std::vector<bool> have_txn(txn_available.size());
     {
     LOCK(pool->cs);
-    const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = pool->vTxHashes;
-    for (size_t i = 0; i < vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(vTxHashes[i].first);
+    auto fill_from_mempool = [&](uint64_t shortid, const uint256& wtxid, CTxMemPool::txiter entry) {
         std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
-                mempool_count++;
-            } else {
-                // If we find two mempool txn that match the short id, just request it.
-                // This should be rare enough that the extra bandwidth doesn't matter,
-                // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
-                    mempool_count--;
-                }
+        if (idit == shorttxids.end()) return;
+        if (!have_txn[idit->second]) {
+            txn_available[idit->second] = entry->GetSharedTx();
+            have_txn[idit->second]  = true;
+            mempool_count++;
+        } else {
+            // If we find two mempool txn that match the short id, just request it.
+            // This should be rare enough that the extra bandwidth doesn't matter,
+            // but eating a round-trip due to FillBlock failure would be annoying.
+            // The same transaction is seen twice if it was found in the first pass.
+            if (txn_available[idit->second] && txn_available[idit->second]->GetWitnessHash() != wtxid) {
+                txn_available[idit->second].reset();
+                mempool_count--;
             }
         }
-        // Though ideally we'd continue scanning for the two-txn-match-shortid case,
-        // the performance win of an early exit here is too good to pass up and worth
-        // the extra risk.
-        if (mempool_count == shorttxids.size())
-            break;
+    };
+
+    // The block most likely consists of the transactions with the highest
+    // ancestor fee rates, so look through those first. If that finds all of
+    // them, the cost depends on the size of the block instead of the size of
+    // the mempool; otherwise the whole mempool is searched.
+    const auto& by_score = pool->mapTx.get<ancestor_score>();
+    const size_t max_first_pass = MEMPOOL_FIRST_PASS_FACTOR * shorttxids.size();
+    size_t scanned = 0;
+    // Short ids are computed a batch at a time; a batch may run past the
+    // point where everything is found, which only costs a few hashes.
+    const uint256* batch_wtxids[SHORTID_BATCH_SIZE];
+    CTxMemPool::txiter batch_entries[SHORTID_BATCH_SIZE];
+    uint64_t batch_shortids[SHORTID_BATCH_SIZE];
+    auto it = by_score.begin();
+    while (it != by_score.end() && scanned < max_first_pass && mempool_count < shorttxids.size()) {
+        size_t count = 0;
+        for (; it != by_score.end() && count < SHORTID_BATCH_SIZE && scanned + count < max_first_pass; ++it, ++count) {
+            batch_wtxids[count] = &it->GetTx().GetWitnessHash();
+            batch_entries[count] = pool->mapTx.project<0>(it);
+        }
+        cmpctblock.GetShortIDs(batch_shortids, batch_wtxids, count);
+        for (size_t j = 0; j < count && mempool_count < shorttxids.size(); j++, scanned++) {
+            fill_from_mempool(batch_shortids[j], *batch_wtxids[j], batch_entries[j]);
+        }
     }
+
+    const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = pool->vTxHashes;
+    // Though ideally we'd continue scanning for the two-txn-match-shortid case,
+    // the performance win of an early exit once all are found is too good to
+    // pass up and worth the extra risk.
+    for (size_t i = 0; i < vTxHashes.size() && mempool_count < shorttxids.size();) {
+        const size_t count = std::min(SHORTID_BATCH_SIZE, vTxHashes.size() - i);
+        for (size_t j = 0; j < count; j++) {
+            batch_wtxids[j] = &vTxHashes[i + j].first;
+        }
+        cmpctblock.GetShortIDs(batch_shortids, batch_wtxids, count);
+        for (size_t j = 0; j < count && mempool_count < shorttxids.size(); j++, i++, scanned++) {
+            fill_from_mempool(batch_shortids[j], vTxHashes[i].first, vTxHashes[i].second);
+        }
+    }
+    LogPrint(BCLog::CMPCTBLOCK, "Looked up %u of %u short ids in %u mempool transactions\n", mempool_count, shorttxids.size(), scanned);
     }
 
+    std::vector<const uint256*> extra_wtxids(extra_txn.size());
     for (size_t i = 0; i < extra_txn.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
+        extra_wtxids[i] = &extra_txn[i].first;
+    }
+    std::vector<uint64_t> extra_shortids(extra_txn.size());
+    cmpctblock.GetShortIDs(extra_shortids.data(), extra_wtxids.data(), extra_txn.size());
+    for (size_t i = 0; i < extra_txn.size(); i++) {
+        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(extra_shortids[i]);
         if (idit != shorttxids.end()) {
             if (!have_txn[idit->second]) {
                 txn_available[idit->second] = extra_txn[i].second;
@@ -86,12 +86,15 @@ public:
         uint64_t txn_size = (uint64_t)txn.size();
         READWRITE(COMPACTSIZE(txn_size));
         if (ser_action.ForRead()) {
+            // Read all transactions first, to hash them together.
+            std::vector<CMutableTransaction> txs;
             size_t i = 0;
-            while (txn.size() < txn_size) {
-                txn.resize(std::min((uint64_t)(1000 + txn.size()), txn_size));
-                for (; i < txn.size(); i++)
-                    READWRITE(TransactionCompressor(txn[i]));
+            while (txs.size() < txn_size) {
+                txs.resize(std::min((uint64_t)(1000 + txs.size()), txn_size));
+                for (; i < txs.size(); i++)
+                    READWRITE(txs[i]);
             }
+            txn = MakeTransactionRefs(std::move(txs));
         } else {
             for (size_t i = 0; i < txn.size(); i++)
                 READWRITE(TransactionCompressor(txn[i]));
@@ -151,6 +154,8 @@ public:
     CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID);
 
     uint64_t GetShortID(const uint256& txhash) const;
+    /** Compute the short ids of count transaction hashes at once, in parallel where the CPU supports it. */
+    void GetShortIDs(uint64_t* shortids, const uint256* const* txhashes, size_t count) const;
 
     size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
 
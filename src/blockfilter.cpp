@@ -94,10 +94,18 @@ uint64_t GCSFilter::HashToRange(const Element& element) const
 
 std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
 {
-    std::vector<uint64_t> hashed_elements;
-    hashed_elements.reserve(elements.size());
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    inputs.reserve(elements.size());
+    lengths.reserve(elements.size());
     for (const Element& element : elements) {
-        hashed_elements.push_back(HashToRange(element));
+        inputs.push_back(element.data());
+        lengths.push_back(element.size());
+    }
+    std::vector<uint64_t> hashed_elements(elements.size());
+    SipHashMulti(m_params.m_siphash_k0, m_params.m_siphash_k1, hashed_elements.data(), inputs.data(), lengths.data(), elements.size());
+    for (uint64_t& hash : hashed_elements) {
+        hash = MapIntoRange(hash, m_F);
     }
     std::sort(hashed_elements.begin(), hashed_elements.end());
     return hashed_elements;
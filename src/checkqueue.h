@@ -8,6 +8,8 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -25,12 +27,27 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every participant has its own deque of checks, and each batch the master
+  * adds goes to the next deque in turn. Participants take batches from the
+  * back of their own deque, and when that is empty steal from the front of
+  * another one, so the only lock they share is taken to go to sleep. Batches
+  * are at most half the deque they are taken from and shrink as the queue
+  * drains, so that all participants finish at about the same time.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Checks queued for one participant
+    struct WorkerQueue {
+        boost::mutex mutex;
+        std::deque<T> checks;
+        //! Size of checks, for others to skip an empty queue without locking it
+        std::atomic<size_t> size{0};
+    };
+
+    //! Mutex to protect going to sleep and waking up
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,87 +56,133 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The queues of the master (the first one) and the workers, in order of registration.
+    //! Workers that register once all are in use share them.
+    std::vector<std::atomic<WorkerQueue*>> queues;
+
+    //! The number of queues in use
+    std::atomic<size_t> nQueues;
+
+    //! The number of workers that registered. Protected by mutex.
+    size_t nWorkers;
+
+    //! The queue the master adds the next batch to
+    size_t nNextQueue;
+
+    //! The number of checks in all queues
+    std::atomic<unsigned int> nQueued;
 
     //! The number of workers (including the master) that are idle.
-    int nIdle;
+    std::atomic<int> nIdle;
 
     //! The total number of workers (including the master).
-    int nTotal;
+    std::atomic<int> nTotal;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Give a new worker a queue of its own (or a shared one once all are in use).
+    size_t RegisterWorker()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        const size_t index = 1 + nWorkers++ % (queues.size() - 1);
+        if (index == nQueues.load()) {
+            queues[index].store(new WorkerQueue());
+            nQueues.store(index + 1);
+        }
+        return index;
+    }
+
+    /** Move up to half of queue into vChecks, from the back if it is our own and from the front otherwise. */
+    bool TakeBatch(WorkerQueue& queue, bool own, std::vector<T>& vChecks)
+    {
+        boost::unique_lock<boost::mutex> lock(queue.mutex);
+        const size_t size = queue.checks.size();
+        if (size == 0) return false;
+        // Don't do batches larger than nBatchSize, or larger than our share
+        // of everything that is still queued.
+        const size_t share = nQueued.load(std::memory_order_relaxed) / nTotal.load(std::memory_order_relaxed);
+        const size_t nNow = std::max<size_t>(1, std::min<size_t>({nBatchSize, (size + 1) / 2, share}));
+        vChecks.resize(nNow);
+        for (T& check : vChecks) {
+            // Swap jobs out of the queue instead of copying them.
+            if (own) {
+                check.swap(queue.checks.back());
+                queue.checks.pop_back();
+            } else {
+                check.swap(queue.checks.front());
+                queue.checks.pop_front();
+            }
+        }
+        queue.size.store(queue.checks.size(), std::memory_order_relaxed);
+        nQueued -= nNow;
+        return true;
+    }
+
+    /** Take a batch from our own queue, or steal one starting at the queue after victim. */
+    bool FindBatch(size_t self, size_t& victim, std::vector<T>& vChecks)
+    {
+        if (TakeBatch(*queues[self].load(), true, vChecks)) return true;
+        const size_t n = nQueues.load();
+        for (size_t i = 0; i < n && nQueued.load(std::memory_order_relaxed) > 0; ++i) {
+            victim = (victim + 1) % n;
+            WorkerQueue& queue = *queues[victim].load();
+            if (victim == self || queue.size.load(std::memory_order_relaxed) == 0) continue;
+            if (TakeBatch(queue, false, vChecks)) return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        const size_t self = fMaster ? 0 : RegisterWorker();
+        size_t victim = self;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
+        nTotal++;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
+            if (FindBatch(self, victim, vChecks)) {
                 // Check whether we need to do work at all
-                fOk = fAllOk;
+                bool fOk = fAllOk.load(std::memory_order_relaxed);
+                // execute work
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check();
+                if (!fOk) fAllOk.store(false, std::memory_order_relaxed);
+                const unsigned int nNow = vChecks.size();
+                // Destroy the checks before they count as done.
+                vChecks.clear();
+                if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    condMaster.notify_one();
+                }
+                continue;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster && nTodo == 0) {
+                nTotal--;
+                // return the current status, and reset it for new work later
+                return fAllOk.exchange(true);
+            }
+            // Count ourselves idle before looking at nQueued, so that Add
+            // either sees us idle or has already queued what we would miss.
+            nIdle++;
+            if (nQueued == 0 && !(fMaster && nTodo == 0))
+                cond.wait(lock); // wait
+            nIdle--;
         } while (true);
     }
 
@@ -127,8 +190,11 @@ public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     boost::mutex ControlMutex;
 
-    //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    //! Create a new check queue, whose first nMaxThreadsIn participants (the master included) get a queue of their own
+    CCheckQueue(unsigned int nBatchSizeIn, size_t nMaxThreadsIn) : queues(std::max<size_t>(2, nMaxThreadsIn)), nQueues(1), nWorkers(0), nNextQueue(0), nQueued(0), nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn)
+    {
+        queues[0].store(new WorkerQueue());
+    }
 
     //! Worker thread
     void Thread()
@@ -145,20 +211,33 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty()) return;
+        // Count the checks before anyone can take them.
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+        nQueued += vChecks.size();
+        WorkerQueue& queue = *queues[nNextQueue++ % nQueues.load()].load();
+        {
+            boost::unique_lock<boost::mutex> lock(queue.mutex);
+            for (T& check : vChecks) {
+                queue.checks.emplace_back();
+                check.swap(queue.checks.back());
+            }
+            queue.size.store(queue.checks.size(), std::memory_order_relaxed);
+        }
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
     }
 
     ~CCheckQueue()
     {
+        for (size_t i = 0; i < nQueues.load(); ++i) {
+            delete queues[i].load();
+        }
     }
 
 };
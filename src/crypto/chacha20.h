@@ -21,6 +21,9 @@ public:
     void SetIV(uint64_t iv);
     void Seek(uint64_t pos);
     void Output(unsigned char* output, size_t bytes);
+
+    /** Encrypt or decrypt bytes bytes of m into c (which may be the same) by xoring them with the keystream. */
+    void Crypt(const unsigned char* m, unsigned char* c, size_t bytes);
 };
 
 #endif // BITCOIN_CRYPTO_CHACHA20_H
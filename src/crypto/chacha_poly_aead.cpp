@@ -0,0 +1,88 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/chacha_poly_aead.h>
+
+#include <crypto/poly1305.h>
+
+#include <assert.h>
+#include <string.h>
+
+static int timingsafe_bcmp(const unsigned char* b1, const unsigned char* b2, size_t n)
+{
+    unsigned char ret = 0;
+    for (size_t i = 0; i < n; i++) {
+        ret |= b1[i] ^ b2[i];
+    }
+    return ret != 0;
+}
+
+ChaCha20Poly1305AEAD::ChaCha20Poly1305AEAD(const unsigned char* K_1, size_t K_1_len, const unsigned char* K_2, size_t K_2_len)
+{
+    assert(K_1_len == CHACHA20_POLY1305_AEAD_KEY_LEN);
+    assert(K_2_len == CHACHA20_POLY1305_AEAD_KEY_LEN);
+    m_chacha_main.SetKey(K_2, CHACHA20_POLY1305_AEAD_KEY_LEN);
+    m_chacha_header.SetKey(K_1, CHACHA20_POLY1305_AEAD_KEY_LEN);
+}
+
+bool ChaCha20Poly1305AEAD::Crypt(uint64_t seqnr, unsigned char* dest, size_t dest_len, const unsigned char* src, size_t src_len, bool is_encrypt)
+{
+    // check buffer boundaries
+    if (
+        // if we encrypt, make sure the source contains at least the expected AAD and the destination has space for the source + MAC
+        (is_encrypt && (src_len < CHACHA20_POLY1305_AEAD_AAD_LEN || dest_len != src_len + POLY1305_TAGLEN)) ||
+        // if we decrypt, make sure the source contains at least the expected AAD+MAC and the destination has space for the source - MAC
+        (!is_encrypt && (src_len < CHACHA20_POLY1305_AEAD_AAD_LEN + POLY1305_TAGLEN || dest_len != src_len - POLY1305_TAGLEN))) {
+        return false;
+    }
+
+    unsigned char expected_tag[POLY1305_TAGLEN], poly_key[POLY1305_KEYLEN];
+    memset(poly_key, 0, sizeof(poly_key));
+    m_chacha_main.SetIV(seqnr);
+
+    // block counter 0 for the poly1305 key
+    // use lower 32bytes for the poly1305 key
+    // (throws away 32 unused bytes (upper 32) from this ChaCha20 round)
+    m_chacha_main.Seek(0);
+    m_chacha_main.Crypt(poly_key, poly_key, sizeof(poly_key));
+
+    // if decrypting, verify the tag prior to decryption
+    if (!is_encrypt) {
+        const unsigned char* tag = src + src_len - POLY1305_TAGLEN;
+        poly1305_auth(expected_tag, src, src_len - POLY1305_TAGLEN, poly_key);
+
+        // constant time compare the calculated MAC with the provided MAC
+        if (timingsafe_bcmp(expected_tag, tag, POLY1305_TAGLEN) != 0) {
+            return false;
+        }
+        // MAC has been successfully verified, make sure we don't convert it in decryption
+        src_len -= POLY1305_TAGLEN;
+    }
+
+    // encrypt / decrypt the length with K_1
+    m_chacha_header.SetIV(seqnr);
+    m_chacha_header.Seek(0);
+    m_chacha_header.Crypt(src, dest, CHACHA20_POLY1305_AEAD_AAD_LEN);
+
+    // set the payload ChaCha instance block counter to 1 and crypt the payload
+    m_chacha_main.Seek(1);
+    m_chacha_main.Crypt(src + CHACHA20_POLY1305_AEAD_AAD_LEN, dest + CHACHA20_POLY1305_AEAD_AAD_LEN, src_len - CHACHA20_POLY1305_AEAD_AAD_LEN);
+
+    // If encrypting, calculate and append tag
+    if (is_encrypt) {
+        // the poly1305 tag expands over the AAD (3 bytes length) & encrypted payload
+        poly1305_auth(dest + src_len, dest, src_len, poly_key);
+    }
+
+    return true;
+}
+
+uint32_t ChaCha20Poly1305AEAD::GetLength(uint64_t seqnr, const unsigned char* ciphertext)
+{
+    unsigned char length[CHACHA20_POLY1305_AEAD_AAD_LEN];
+    m_chacha_header.SetIV(seqnr);
+    m_chacha_header.Seek(0);
+    m_chacha_header.Crypt(ciphertext, length, CHACHA20_POLY1305_AEAD_AAD_LEN);
+    return length[0] | (length[1] << 8) | (length[2] << 16);
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_CHACHA_POLY_AEAD_H
+#define BITCOIN_CRYPTO_CHACHA_POLY_AEAD_H
+
+#include <crypto/chacha20.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static constexpr int CHACHA20_POLY1305_AEAD_KEY_LEN = 32;
+static constexpr int CHACHA20_POLY1305_AEAD_AAD_LEN = 3; /* 3 bytes length */
+
+/**
+ * The ChaCha20-Poly1305 AEAD of OpenSSH (chacha20-poly1305@openssh.com), for
+ * messages that start with their length in 3 bytes.
+ *
+ * Two ChaCha20 instances are used, both with the sequence number of the
+ * message as nonce. The one keyed with K_1 only encrypts the length, so that
+ * it can be decrypted before the rest of the message has been received. The
+ * one keyed with K_2 gives the Poly1305 key (the first 32 bytes of its
+ * keystream) and encrypts the payload (from the second 64-byte block of its
+ * keystream on). The tag is computed over the encrypted length and payload.
+ */
+class ChaCha20Poly1305AEAD
+{
+private:
+    ChaCha20 m_chacha_main;   // payload and poly1305 key-derivation cipher instance
+    ChaCha20 m_chacha_header; // AAD cipher instance (encrypted length)
+
+public:
+    ChaCha20Poly1305AEAD(const unsigned char* K_1, size_t K_1_len, const unsigned char* K_2, size_t K_2_len);
+
+    ChaCha20Poly1305AEAD(const ChaCha20Poly1305AEAD&) = delete;
+    ChaCha20Poly1305AEAD& operator=(const ChaCha20Poly1305AEAD&) = delete;
+
+    /**
+     * Encrypt the length and payload in src (src_len bytes) of message seqnr
+     * into dest, followed by the tag (dest_len = src_len + POLY1305_TAGLEN),
+     * or check the tag of and decrypt such a message (dest_len = src_len -
+     * POLY1305_TAGLEN). src and dest may be the same. Returns false if the
+     * sizes are wrong or the tag does not match.
+     */
+    bool Crypt(uint64_t seqnr, unsigned char* dest, size_t dest_len, const unsigned char* src, size_t src_len, bool is_encrypt);
+
+    /** Decrypt the length of message seqnr from its first CHACHA20_POLY1305_AEAD_AAD_LEN bytes. */
+    uint32_t GetLength(uint64_t seqnr, const unsigned char* ciphertext);
+};
+
+#endif // BITCOIN_CRYPTO_CHACHA_POLY_AEAD_H
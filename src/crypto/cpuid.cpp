@@ -0,0 +1,58 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <crypto/cpuid.h>
+
+#include <stdint.h>
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+
+namespace
+{
+// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
+void inline cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+#ifdef __GNUC__
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+#else
+  __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+#endif
+}
+
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+} // namespace
+
+CPUFeatures GetCPUFeatures()
+{
+    CPUFeatures features;
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, eax, ebx, ecx, edx);
+    features.sse41 = (ecx >> 19) & 1;
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    const bool enabled_avx = have_xsave && have_avx && AVXEnabled();
+    if (features.sse41) {
+        cpuid(7, 0, eax, ebx, ecx, edx);
+        features.avx2 = enabled_avx && ((ebx >> 5) & 1);
+        features.shani = (ebx >> 29) & 1;
+    }
+    return features;
+}
+#else
+CPUFeatures GetCPUFeatures()
+{
+    return CPUFeatures();
+}
+#endif
@@ -0,0 +1,19 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_CPUID_H
+#define BITCOIN_CRYPTO_CPUID_H
+
+/** The instruction set extensions of the running CPU that the hash implementations dispatch on. */
+struct CPUFeatures
+{
+    bool sse41 = false;
+    bool avx2 = false;  //!< also requires the OS to save the AVX registers
+    bool shani = false;
+};
+
+/** Query the running CPU. All features are absent unless built with USE_ASM for x86. */
+CPUFeatures GetCPUFeatures();
+
+#endif // BITCOIN_CRYPTO_CPUID_H
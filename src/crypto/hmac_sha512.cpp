@@ -3,8 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/hmac_sha512.h>
+#include <support/cleanse.h>
 
 #include <string.h>
+#include <vector>
 
 CHMAC_SHA512::CHMAC_SHA512(const unsigned char* key, size_t keylen)
 {
@@ -32,3 +34,17 @@ void CHMAC_SHA512::Finalize(unsigned char hash[OUTPUT_SIZE])
     inner.Finalize(temp);
     outer.Write(temp, 64).Finalize(hash);
 }
+
+void CHMAC_SHA512::FinalizeMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count) const
+{
+    std::vector<unsigned char> temp(OUTPUT_SIZE * count);
+    inner.FinalizeMulti(temp.data(), inputs, lengths, count);
+    std::vector<const unsigned char*> temp_inputs(count);
+    for (size_t i = 0; i < count; ++i) {
+        temp_inputs[i] = temp.data() + OUTPUT_SIZE * i;
+    }
+    const std::vector<size_t> temp_lengths(count, OUTPUT_SIZE);
+    outer.FinalizeMulti(output, temp_inputs.data(), temp_lengths.data(), count);
+    // The inner hashes depend on the key.
+    memory_cleanse(temp.data(), temp.size());
+}
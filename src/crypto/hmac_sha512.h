@@ -27,6 +27,11 @@ public:
         return *this;
     }
     void Finalize(unsigned char hash[OUTPUT_SIZE]);
+
+    /** Finalize the HMACs of count messages under this key (each after what
+     *  was written so far), in parallel lanes where the CPU supports it.
+     */
+    void FinalizeMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count) const;
 };
 
 #endif // BITCOIN_CRYPTO_HMAC_SHA512_H
@@ -5,9 +5,21 @@
 #include <crypto/ripemd160.h>
 
 #include <crypto/common.h>
+#include <crypto/cpuid.h>
 
+#include <assert.h>
 #include <string.h>
 
+namespace ripemd160_sse41
+{
+void Transform_4way(unsigned char* out, const unsigned char* in);
+}
+
+namespace ripemd160_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+}
+
 // Internal implementation code.
 namespace
 {
@@ -233,10 +245,78 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     s[4] = t + b1 + c2;
 }
 
+/** Compute the RIPEMD-160 of a 32-byte blob, which pads to a single chunk. */
+void Transform32(unsigned char* out, const unsigned char* in)
+{
+    unsigned char chunk[64] = {0};
+    memcpy(chunk, in, 32);
+    chunk[32] = 0x80;
+    WriteLE64(chunk + 56, 32 << 3);
+    uint32_t s[5];
+    Initialize(s);
+    Transform(s, chunk);
+    for (int i = 0; i < 5; ++i) {
+        WriteLE32(out + 4 * i, s[i]);
+    }
+}
+
 } // namespace ripemd160
 
+typedef void (*Transform32MultiType)(unsigned char*, const unsigned char*);
+
+Transform32MultiType Transform32_4way = nullptr;
+Transform32MultiType Transform32_8way = nullptr;
+
+bool SelfTest32(Transform32MultiType tr, size_t lanes)
+{
+    unsigned char in[8 * 32];
+    for (size_t i = 0; i < sizeof(in); ++i) {
+        in[i] = i * 7 + 3;
+    }
+    unsigned char out[8 * 20], expected[20];
+    tr(out, in);
+    for (size_t i = 0; i < lanes; ++i) {
+        ripemd160::Transform32(expected, in + 32 * i);
+        if (memcmp(out + 20 * i, expected, 20)) return false;
+    }
+    return true;
+}
+
+bool SelfTest()
+{
+    // RIPEMD160 of 32 zero bytes.
+    static const unsigned char zero[32] = {0};
+    static const unsigned char result[20] = {0xd1, 0xa7, 0x01, 0x26, 0xff, 0x7a, 0x14, 0x9c, 0xa6, 0xf9, 0xb6, 0x38, 0xdb, 0x08, 0x44, 0x80, 0x44, 0x0f, 0xf8, 0x42};
+    unsigned char out[20];
+    ripemd160::Transform32(out, zero);
+    if (memcmp(out, result, 20)) return false;
+    if (Transform32_4way && !SelfTest32(Transform32_4way, 4)) return false;
+    if (Transform32_8way && !SelfTest32(Transform32_8way, 8)) return false;
+    return true;
+}
 } // namespace
 
+std::string RIPEMD160AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (GetCPUFeatures().sse41) {
+        Transform32_4way = ripemd160_sse41::Transform_4way;
+        ret += ",sse41(4way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (GetCPUFeatures().avx2) {
+        Transform32_8way = ripemd160_avx2::Transform_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
 ////// RIPEMD160
 
 CRIPEMD160::CRIPEMD160() : bytes(0)
@@ -290,3 +370,29 @@ CRIPEMD160& CRIPEMD160::Reset()
     ripemd160::Initialize(s);
     return *this;
 }
+
+void RIPEMD160_32(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (Transform32_8way) {
+        while (blocks >= 8) {
+            Transform32_8way(out, in);
+            out += 160;
+            in += 256;
+            blocks -= 8;
+        }
+    }
+    if (Transform32_4way) {
+        while (blocks >= 4) {
+            Transform32_4way(out, in);
+            out += 80;
+            in += 128;
+            blocks -= 4;
+        }
+    }
+    while (blocks) {
+        ripemd160::Transform32(out, in);
+        out += 20;
+        in += 32;
+        --blocks;
+    }
+}
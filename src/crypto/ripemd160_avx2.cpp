@@ -0,0 +1,138 @@
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/ripemd160.h>
+#include <crypto/common.h>
+
+namespace ripemd160_avx2 {
+namespace {
+
+__m256i inline K(uint32_t x) { return _mm256_set1_epi32(x); }
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z) { return Add(Add(x, y), z); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z, __m256i w) { return Add(Add(x, y), Add(z, w)); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z) { return Xor(Xor(x, y), z); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__m256i inline AndNot(__m256i x, __m256i y) { return _mm256_andnot_si256(x, y); }
+__m256i inline Not(__m256i x) { return Xor(x, K(0xFFFFFFFFul)); }
+__m256i inline Rol(__m256i x, int n) { return Or(_mm256_sll_epi32(x, _mm_cvtsi32_si128(n)), _mm256_srl_epi32(x, _mm_cvtsi32_si128(32 - n))); }
+
+__m256i inline f1(__m256i x, __m256i y, __m256i z) { return Xor(x, y, z); }
+__m256i inline f2(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), AndNot(x, z)); }
+__m256i inline f3(__m256i x, __m256i y, __m256i z) { return Xor(Or(x, Not(y)), z); }
+__m256i inline f4(__m256i x, __m256i y, __m256i z) { return Or(And(x, z), AndNot(z, y)); }
+__m256i inline f5(__m256i x, __m256i y, __m256i z) { return Xor(x, Or(y, Not(z))); }
+
+/** Message word and rotation of each step of the left and right lines. */
+const int WORD_LEFT[80] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+    3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+    1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+    4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13};
+const int WORD_RIGHT[80] = {
+    5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+    6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+    15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+    8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+    12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11};
+const int ROT_LEFT[80] = {
+    11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+    7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+    11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+    11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+    9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6};
+const int ROT_RIGHT[80] = {
+    8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+    9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+    9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+    15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+    8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11};
+
+/** One step of either line; the caller rotates the roles of the state words. */
+__m256i inline __attribute__((always_inline)) Step(__m256i a, __m256i& c, __m256i e, __m256i f, __m256i x, __m256i k, int r)
+{
+    c = Rol(c, 10);
+    return Add(Rol(Add(a, f, x, k), r), e);
+}
+
+__m256i inline Read8(const unsigned char* in, int offset) {
+    return _mm256_set_epi32(
+        ReadLE32(in + 224 + offset),
+        ReadLE32(in + 192 + offset),
+        ReadLE32(in + 160 + offset),
+        ReadLE32(in + 128 + offset),
+        ReadLE32(in + 96 + offset),
+        ReadLE32(in + 64 + offset),
+        ReadLE32(in + 32 + offset),
+        ReadLE32(in + 0 + offset)
+    );
+}
+
+void inline Write8(unsigned char* out, int offset, __m256i v) {
+    WriteLE32(out + 0 + offset, _mm256_extract_epi32(v, 0));
+    WriteLE32(out + 20 + offset, _mm256_extract_epi32(v, 1));
+    WriteLE32(out + 40 + offset, _mm256_extract_epi32(v, 2));
+    WriteLE32(out + 60 + offset, _mm256_extract_epi32(v, 3));
+    WriteLE32(out + 80 + offset, _mm256_extract_epi32(v, 4));
+    WriteLE32(out + 100 + offset, _mm256_extract_epi32(v, 5));
+    WriteLE32(out + 120 + offset, _mm256_extract_epi32(v, 6));
+    WriteLE32(out + 140 + offset, _mm256_extract_epi32(v, 7));
+}
+}
+
+void Transform_8way(unsigned char* out, const unsigned char* in)
+{
+    // A 32-byte message, padded to a single chunk.
+    __m256i w[16];
+    for (int i = 0; i < 8; ++i) w[i] = Read8(in, 4 * i);
+    w[8] = K(0x80);
+    for (int i = 9; i < 16; ++i) w[i] = K(0);
+    w[14] = K(256);
+
+    const __m256i h0 = K(0x67452301ul), h1 = K(0xEFCDAB89ul), h2 = K(0x98BADCFEul), h3 = K(0x10325476ul), h4 = K(0xC3D2E1F0ul);
+    __m256i a1 = h0, b1 = h1, c1 = h2, d1 = h3, e1 = h4;
+    __m256i a2 = h0, b2 = h1, c2 = h2, d2 = h3, e2 = h4;
+    for (int j = 0; j < 80; ++j) {
+        __m256i t1, t2;
+        switch (j / 16) {
+        case 0:
+            t1 = Step(a1, c1, e1, f1(b1, c1, d1), w[WORD_LEFT[j]], K(0), ROT_LEFT[j]);
+            t2 = Step(a2, c2, e2, f5(b2, c2, d2), w[WORD_RIGHT[j]], K(0x50A28BE6ul), ROT_RIGHT[j]);
+            break;
+        case 1:
+            t1 = Step(a1, c1, e1, f2(b1, c1, d1), w[WORD_LEFT[j]], K(0x5A827999ul), ROT_LEFT[j]);
+            t2 = Step(a2, c2, e2, f4(b2, c2, d2), w[WORD_RIGHT[j]], K(0x5C4DD124ul), ROT_RIGHT[j]);
+            break;
+        case 2:
+            t1 = Step(a1, c1, e1, f3(b1, c1, d1), w[WORD_LEFT[j]], K(0x6ED9EBA1ul), ROT_LEFT[j]);
+            t2 = Step(a2, c2, e2, f3(b2, c2, d2), w[WORD_RIGHT[j]], K(0x6D703EF3ul), ROT_RIGHT[j]);
+            break;
+        case 3:
+            t1 = Step(a1, c1, e1, f4(b1, c1, d1), w[WORD_LEFT[j]], K(0x8F1BBCDCul), ROT_LEFT[j]);
+            t2 = Step(a2, c2, e2, f2(b2, c2, d2), w[WORD_RIGHT[j]], K(0x7A6D76E9ul), ROT_RIGHT[j]);
+            break;
+        default:
+            t1 = Step(a1, c1, e1, f5(b1, c1, d1), w[WORD_LEFT[j]], K(0xA953FD4Eul), ROT_LEFT[j]);
+            t2 = Step(a2, c2, e2, f1(b2, c2, d2), w[WORD_RIGHT[j]], K(0), ROT_RIGHT[j]);
+            break;
+        }
+        a1 = e1; e1 = d1; d1 = c1; c1 = b1; b1 = t1;
+        a2 = e2; e2 = d2; d2 = c2; c2 = b2; b2 = t2;
+    }
+
+    Write8(out, 0, Add(h1, c1, d2));
+    Write8(out, 4, Add(h2, d1, e2));
+    Write8(out, 8, Add(h3, e1, a2));
+    Write8(out, 12, Add(h4, a1, b2));
+    Write8(out, 16, Add(h0, b1, c2));
+}
+
+}
+
+#endif
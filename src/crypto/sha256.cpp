@@ -4,14 +4,15 @@
 
 #include <crypto/sha256.h>
 #include <crypto/common.h>
+#include <crypto/cpuid.h>
 
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 #include <atomic>
 
 #if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
 #if defined(USE_ASM)
-#include <cpuid.h>
 namespace sha256_sse4
 {
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
@@ -24,11 +25,21 @@ namespace sha256d64_sse41
 void Transform_4way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_sse41
+{
+void Transform_4way(uint32_t* const* s, const unsigned char* const* chunks);
+}
+
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* const* s, const unsigned char* const* chunks);
+}
+
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
@@ -37,6 +48,7 @@ void Transform_2way(unsigned char* out, const unsigned char* in);
 namespace sha256_shani
 {
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+void Transform_2way(uint32_t* const* s, const unsigned char* const* chunks);
 }
 
 // Internal implementation code.
@@ -462,6 +474,31 @@ TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
 
+/** Transform one 64-byte chunk for each of several independent states (one per lane). */
+typedef void (*TransformMultiType)(uint32_t* const* s, const unsigned char* const* chunks);
+
+TransformMultiType TransformMulti_2way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
+
+bool SelfTestMulti(TransformMultiType tr, size_t lanes, const uint32_t (*result)[8], const unsigned char* data)
+{
+    // Lane i continues from the state after i chunks, with chunk i.
+    uint32_t states[8][8];
+    uint32_t* s[8];
+    const unsigned char* chunks[8];
+    for (size_t i = 0; i < lanes; ++i) {
+        std::copy(result[i], result[i] + 8, states[i]);
+        s[i] = states[i];
+        chunks[i] = data + 64 * i;
+    }
+    tr(s, chunks);
+    for (size_t i = 0; i < lanes; ++i) {
+        if (!std::equal(states[i], states[i] + 8, result[i + 1])) return false;
+    }
+    return true;
+}
+
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
     static const uint32_t init[8] = {
@@ -544,77 +581,46 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
-    return true;
-}
-
+    // Test the multi-lane transforms, if available.
+    if (TransformMulti_2way && !SelfTestMulti(TransformMulti_2way, 2, result, data + 1)) return false;
+    if (TransformMulti_4way && !SelfTestMulti(TransformMulti_4way, 4, result, data + 1)) return false;
+    if (TransformMulti_8way && !SelfTestMulti(TransformMulti_8way, 8, result, data + 1)) return false;
 
-#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
-// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
-void inline cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
-{
-#ifdef __GNUC__
-    __cpuid_count(leaf, subleaf, a, b, c, d);
-#else
-  __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
-#endif
-}
-
-/** Check whether the OS has enabled AVX registers. */
-bool AVXEnabled()
-{
-    uint32_t a, d;
-    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
-    return (a & 6) == 6;
+    return true;
 }
-#endif
 } // namespace
 
 
-std::string SHA256AutoDetect()
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation)
 {
     std::string ret = "standard";
+    Transform = sha256::Transform;
+    TransformD64 = sha256::TransformD64;
+    TransformD64_2way = nullptr;
+    TransformD64_4way = nullptr;
+    TransformD64_8way = nullptr;
+    TransformMulti_2way = nullptr;
+    TransformMulti_4way = nullptr;
+    TransformMulti_8way = nullptr;
 #if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
-    bool have_sse4 = false;
-    bool have_xsave = false;
-    bool have_avx = false;
-    bool have_avx2 = false;
-    bool have_shani = false;
-    bool enabled_avx = false;
-
-    (void)AVXEnabled;
-    (void)have_sse4;
-    (void)have_avx;
-    (void)have_xsave;
-    (void)have_avx2;
-    (void)have_shani;
-    (void)enabled_avx;
-
-    uint32_t eax, ebx, ecx, edx;
-    cpuid(1, 0, eax, ebx, ecx, edx);
-    have_sse4 = (ecx >> 19) & 1;
-    have_xsave = (ecx >> 27) & 1;
-    have_avx = (ecx >> 28) & 1;
-    if (have_xsave && have_avx) {
-        enabled_avx = AVXEnabled();
-    }
-    if (have_sse4) {
-        cpuid(7, 0, eax, ebx, ecx, edx);
-        have_avx2 = (ebx >> 5) & 1;
-        have_shani = (ebx >> 29) & 1;
-    }
+    CPUFeatures cpu = GetCPUFeatures();
+    cpu.sse41 &= (use_implementation & sha256_implementation::USE_SSE4) != 0;
+    cpu.avx2 &= (use_implementation & sha256_implementation::USE_AVX2) != 0;
+    cpu.shani &= (use_implementation & sha256_implementation::USE_SHANI) != 0;
 
 #if defined(ENABLE_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
-    if (have_shani) {
+    if (cpu.shani) {
         Transform = sha256_shani::Transform;
         TransformD64 = TransformD64Wrapper<sha256_shani::Transform>;
         TransformD64_2way = sha256d64_shani::Transform_2way;
+        TransformMulti_2way = sha256_shani::Transform_2way;
         ret = "shani(1way,2way)";
-        have_sse4 = false; // Disable SSE4/AVX2;
-        have_avx2 = false;
+        cpu.sse41 = false; // Disable SSE4/AVX2;
+        cpu.avx2 = false;
     }
 #endif
 
-    if (have_sse4) {
+    if (cpu.sse41) {
 #if defined(__x86_64__) || defined(__amd64__)
         Transform = sha256_sse4::Transform;
         TransformD64 = TransformD64Wrapper<sha256_sse4::Transform>;
@@ -622,13 +628,15 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformMulti_4way = sha256_sse41::Transform_4way;
         ret += ",sse41(4way)";
 #endif
     }
 
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
-    if (have_avx2 && have_avx && enabled_avx) {
+    if (cpu.avx2) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256_avx2::Transform_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +736,137 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+namespace {
+
+/** A message being hashed in one lane of a multi-lane transform. */
+struct Lane
+{
+    uint32_t s[8];
+    const unsigned char* data;  //!< full 64-byte chunks of the message not yet hashed
+    size_t chunks;              //!< how many of them
+    unsigned char tail[128];    //!< the rest of the message, padded
+    const unsigned char* tail_pos;
+    const unsigned char* tail_end;
+    unsigned char* out;
+    bool rehash;                //!< hash the result once more (double SHA256)
+};
+
+void StartLane(Lane& lane, const unsigned char* data, size_t len, unsigned char* out, bool rehash)
+{
+    sha256::Initialize(lane.s);
+    lane.data = data;
+    lane.chunks = len / 64;
+    const size_t rest = len % 64;
+    const size_t tail_size = rest < 56 ? 64 : 128;
+    memcpy(lane.tail, data + len - rest, rest);
+    memset(lane.tail + rest, 0, tail_size - rest);
+    lane.tail[rest] = 0x80;
+    WriteBE64(lane.tail + tail_size - 8, (uint64_t)len << 3);
+    lane.tail_pos = lane.tail;
+    lane.tail_end = lane.tail + tail_size;
+    lane.out = out;
+    lane.rehash = rehash;
+}
+
+const unsigned char* NextChunk(Lane& lane)
+{
+    if (lane.chunks) {
+        --lane.chunks;
+        lane.data += 64;
+        return lane.data - 64;
+    }
+    lane.tail_pos += 64;
+    return lane.tail_pos - 64;
+}
+
+/** After a chunk of the lane has been transformed: returns whether its message is done. */
+bool FinishChunk(Lane& lane)
+{
+    if (lane.chunks || lane.tail_pos != lane.tail_end) return false;
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    for (int i = 0; i < 8; ++i) {
+        WriteBE32(hash + 4 * i, lane.s[i]);
+    }
+    if (lane.rehash) {
+        StartLane(lane, hash, sizeof(hash), lane.out, false);
+        return false;
+    }
+    memcpy(lane.out, hash, sizeof(hash));
+    return true;
+}
+
+/**
+ * Run all messages through a transform of the given number of lanes, for as
+ * long as there are enough of them to fill all lanes. Lanes [0, active) hold
+ * the messages in progress, before and after.
+ */
+void RunLanes(TransformMultiType tr, size_t width, Lane* lanes, size_t& active, unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count, size_t& next, bool rehash)
+{
+    uint32_t* s[8];
+    const unsigned char* chunks[8];
+    while (true) {
+        while (active < width && next < count) {
+            StartLane(lanes[active++], inputs[next], lengths[next], output + 32 * next, rehash);
+            ++next;
+        }
+        if (active < width) return;
+        for (size_t i = 0; i < width; ++i) {
+            s[i] = lanes[i].s;
+            chunks[i] = NextChunk(lanes[i]);
+        }
+        tr(s, chunks);
+        for (size_t i = 0; i < width && i < active;) {
+            if (FinishChunk(lanes[i])) {
+                lanes[i] = lanes[--active];
+                // The lane moved here may hold pointers into its own tail.
+                const ptrdiff_t pos = lanes[i].tail_pos - lanes[active].tail;
+                const ptrdiff_t end = lanes[i].tail_end - lanes[active].tail;
+                lanes[i].tail_pos = lanes[i].tail + pos;
+                lanes[i].tail_end = lanes[i].tail + end;
+            } else {
+                ++i;
+            }
+        }
+    }
+}
+
+void HashMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count, bool rehash)
+{
+    Lane lanes[8];
+    size_t active = 0, next = 0;
+    if (TransformMulti_8way) RunLanes(TransformMulti_8way, 8, lanes, active, output, inputs, lengths, count, next, rehash);
+    if (TransformMulti_4way) RunLanes(TransformMulti_4way, 4, lanes, active, output, inputs, lengths, count, next, rehash);
+    if (TransformMulti_2way) RunLanes(TransformMulti_2way, 2, lanes, active, output, inputs, lengths, count, next, rehash);
+    // Finish what is left one message at a time.
+    for (size_t i = 0; i < active; ++i) {
+        do {
+            Transform(lanes[i].s, NextChunk(lanes[i]), 1);
+        } while (!FinishChunk(lanes[i]));
+    }
+    for (; next < count; ++next) {
+        unsigned char* out = output + 32 * next;
+        CSHA256().Write(inputs[next], lengths[next]).Finalize(out);
+        if (rehash) CSHA256().Write(out, 32).Finalize(out);
+    }
+}
+
+} // namespace
+
+void SHA256Multi(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    HashMulti(output, inputs, lengths, count, false);
+}
+
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    HashMulti(output, inputs, lengths, count, true);
+}
+
+size_t SHA256MultiLanes()
+{
+    if (TransformMulti_8way) return 8;
+    if (TransformMulti_4way) return 4;
+    if (TransformMulti_2way) return 2;
+    return 1;
+}
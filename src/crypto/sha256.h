@@ -26,10 +26,23 @@ public:
     CSHA256& Reset();
 };
 
+namespace sha256_implementation {
+/** The CPU-specific implementations SHA256AutoDetect may pick from. */
+enum UseImplementation : uint8_t {
+    STANDARD = 0,
+    USE_SSE4 = 1 << 0,  //!< SSE4 and the 4-way SSE4.1 transforms
+    USE_AVX2 = 1 << 1,  //!< 8-way AVX2 transforms (on top of USE_SSE4)
+    USE_SHANI = 1 << 2, //!< SHA-NI and its 2-way transforms; excludes the others
+    USE_SSE4_AND_AVX2 = USE_SSE4 | USE_AVX2,
+    USE_ALL = USE_SSE4 | USE_AVX2 | USE_SHANI,
+};
+}
+
 /** Autodetect the best available SHA256 implementation.
  *  Returns the name of the implementation.
+ *  Tests restrict use_implementation to exercise each of them on the same host.
  */
-std::string SHA256AutoDetect();
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation = sha256_implementation::USE_ALL);
 
 /** Compute multiple double-SHA256's of 64-byte blobs.
  *  output:  pointer to a blocks*32 byte output buffer
@@ -38,4 +51,19 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the SHA256's of multiple messages of any length, in parallel lanes
+ *  where the CPU supports it.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointers to the count messages
+ *  lengths: their lengths in bytes
+ *  count:   the number of hashes to compute.
+ */
+void SHA256Multi(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
+/** Like SHA256Multi, but computes double-SHA256's. */
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
+/** The most messages SHA256Multi hashes in parallel (1 if it hashes them one at a time). */
+size_t SHA256MultiLanes();
+
 #endif // BITCOIN_CRYPTO_SHA256_H
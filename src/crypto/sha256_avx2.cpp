@@ -322,4 +322,82 @@ void Transform_8way(unsigned char* out, const unsigned char* in)
 
 }
 
+namespace sha256_avx2 {
+namespace {
+const uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+__m256i inline ReadLanes(const unsigned char* const* chunks, int offset)
+{
+    return _mm256_set_epi32(ReadBE32(chunks[7] + offset), ReadBE32(chunks[6] + offset), ReadBE32(chunks[5] + offset), ReadBE32(chunks[4] + offset), ReadBE32(chunks[3] + offset), ReadBE32(chunks[2] + offset), ReadBE32(chunks[1] + offset), ReadBE32(chunks[0] + offset));
+}
+}
+
+void Transform_8way(uint32_t* const* s, const unsigned char* const* chunks)
+{
+    using namespace sha256d64_avx2;
+
+    __m256i w[16];
+    __m256i st[8];
+    for (int i = 0; i < 8; ++i) {
+        st[i] = _mm256_set_epi32(s[7][i], s[6][i], s[5][i], s[4][i], s[3][i], s[2][i], s[1][i], s[0][i]);
+    }
+    __m256i a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+
+    for (int i = 0; i < 16; i += 8) {
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 0]), w[i + 0] = ReadLanes(chunks, 4 * i + 0)));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 1]), w[i + 1] = ReadLanes(chunks, 4 * i + 4)));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 2]), w[i + 2] = ReadLanes(chunks, 4 * i + 8)));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 3]), w[i + 3] = ReadLanes(chunks, 4 * i + 12)));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 4]), w[i + 4] = ReadLanes(chunks, 4 * i + 16)));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 5]), w[i + 5] = ReadLanes(chunks, 4 * i + 20)));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 6]), w[i + 6] = ReadLanes(chunks, 4 * i + 24)));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 7]), w[i + 7] = ReadLanes(chunks, 4 * i + 28)));
+    }
+    for (int i = 16; i < 64; i += 16) {
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 0]), Inc(w[0], sigma1(w[14]), w[9], sigma0(w[1]))));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 1]), Inc(w[1], sigma1(w[15]), w[10], sigma0(w[2]))));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 2]), Inc(w[2], sigma1(w[0]), w[11], sigma0(w[3]))));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 3]), Inc(w[3], sigma1(w[1]), w[12], sigma0(w[4]))));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 4]), Inc(w[4], sigma1(w[2]), w[13], sigma0(w[5]))));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 5]), Inc(w[5], sigma1(w[3]), w[14], sigma0(w[6]))));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 6]), Inc(w[6], sigma1(w[4]), w[15], sigma0(w[7]))));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 7]), Inc(w[7], sigma1(w[5]), w[0], sigma0(w[8]))));
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 8]), Inc(w[8], sigma1(w[6]), w[1], sigma0(w[9]))));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 9]), Inc(w[9], sigma1(w[7]), w[2], sigma0(w[10]))));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 10]), Inc(w[10], sigma1(w[8]), w[3], sigma0(w[11]))));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 11]), Inc(w[11], sigma1(w[9]), w[4], sigma0(w[12]))));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 12]), Inc(w[12], sigma1(w[10]), w[5], sigma0(w[13]))));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 13]), Inc(w[13], sigma1(w[11]), w[6], sigma0(w[14]))));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 14]), Inc(w[14], sigma1(w[12]), w[7], sigma0(w[15]))));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 15]), Inc(w[15], sigma1(w[13]), w[8], sigma0(w[0]))));
+    }
+
+    st[0] = Add(st[0], a);
+    st[1] = Add(st[1], b);
+    st[2] = Add(st[2], c);
+    st[3] = Add(st[3], d);
+    st[4] = Add(st[4], e);
+    st[5] = Add(st[5], f);
+    st[6] = Add(st[6], g);
+    st[7] = Add(st[7], h);
+    for (int i = 0; i < 8; ++i) {
+        alignas(sizeof(__m256i)) uint32_t lanes[8];
+        _mm256_store_si256(((__m256i*)lanes), st[i]);
+        for (int j = 0; j < 8; ++j) {
+            s[j][i] = lanes[j];
+        }
+    }
+}
+
+}
+
 #endif
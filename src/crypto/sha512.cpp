@@ -5,8 +5,16 @@
 #include <crypto/sha512.h>
 
 #include <crypto/common.h>
+#include <crypto/cpuid.h>
 
+#include <assert.h>
 #include <string.h>
+#include <algorithm>
+
+namespace sha512_avx2
+{
+void Transform_4way(uint64_t* const* s, const unsigned char* const* chunks);
+}
 
 // Internal implementation code.
 namespace
@@ -146,8 +154,106 @@ void Transform(uint64_t* s, const unsigned char* chunk)
 
 } // namespace sha512
 
+/** Transform one 128-byte chunk for each of several independent states (one per lane). */
+typedef void (*TransformMultiType)(uint64_t* const* s, const unsigned char* const* chunks);
+
+TransformMultiType TransformMulti_4way = nullptr;
+
+bool SelfTest()
+{
+    // Lane i continues from the state after i chunks of the same data, with chunk i.
+    unsigned char data[4 * 128];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i * 13 + 1;
+    }
+    uint64_t states[5][8];
+    sha512::Initialize(states[0]);
+    for (int i = 0; i < 4; ++i) {
+        std::copy(states[i], states[i] + 8, states[i + 1]);
+        sha512::Transform(states[i + 1], data + 128 * i);
+    }
+    if (TransformMulti_4way) {
+        uint64_t lanes[4][8];
+        uint64_t* s[4];
+        const unsigned char* chunks[4];
+        for (int i = 0; i < 4; ++i) {
+            std::copy(states[i], states[i] + 8, lanes[i]);
+            s[i] = lanes[i];
+            chunks[i] = data + 128 * i;
+        }
+        TransformMulti_4way(s, chunks);
+        for (int i = 0; i < 4; ++i) {
+            if (!std::equal(lanes[i], lanes[i] + 8, states[i + 1])) return false;
+        }
+    }
+    return true;
+}
+
+
+/** A message being hashed in one lane of FinalizeMulti. */
+struct Lane
+{
+    uint64_t s[8];
+    const unsigned char* data;  //!< full 128-byte chunks of the message not yet hashed
+    size_t chunks;              //!< how many of them
+    unsigned char tail[256];    //!< the rest of the message, padded
+    size_t tail_pos;
+    size_t tail_size;
+    unsigned char* out;
+};
+
+void StartLane(Lane& lane, const uint64_t* s, uint64_t prefix, const unsigned char* data, size_t len, unsigned char* out)
+{
+    std::copy(s, s + 8, lane.s);
+    lane.data = data;
+    lane.chunks = len / 128;
+    const size_t rest = len % 128;
+    lane.tail_size = rest < 112 ? 128 : 256;
+    memcpy(lane.tail, data + len - rest, rest);
+    memset(lane.tail + rest, 0, lane.tail_size - rest);
+    lane.tail[rest] = 0x80;
+    WriteBE64(lane.tail + lane.tail_size - 8, (prefix + len) << 3);
+    lane.tail_pos = 0;
+    lane.out = out;
+}
+
+const unsigned char* NextChunk(Lane& lane)
+{
+    if (lane.chunks) {
+        --lane.chunks;
+        lane.data += 128;
+        return lane.data - 128;
+    }
+    lane.tail_pos += 128;
+    return lane.tail + lane.tail_pos - 128;
+}
+
+/** After a chunk of the lane has been transformed: returns whether its message is done. */
+bool FinishChunk(Lane& lane)
+{
+    if (lane.chunks || lane.tail_pos != lane.tail_size) return false;
+    for (int i = 0; i < 8; ++i) {
+        WriteBE64(lane.out + 8 * i, lane.s[i]);
+    }
+    return true;
+}
+
 } // namespace
 
+std::string SHA512AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (GetCPUFeatures().avx2) {
+        TransformMulti_4way = sha512_avx2::Transform_4way;
+        ret += ",avx2(4way)";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
 
 ////// SHA-512
 
@@ -199,6 +305,46 @@ void CSHA512::Finalize(unsigned char hash[OUTPUT_SIZE])
     WriteBE64(hash + 56, s[7]);
 }
 
+void CSHA512::FinalizeMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count) const
+{
+    size_t next = 0;
+    // Lanes can only pick up from a state that has no partial chunk buffered.
+    if (TransformMulti_4way && bytes % 128 == 0) {
+        Lane lanes[4];
+        uint64_t* states[4];
+        const unsigned char* chunks[4];
+        size_t active = 0;
+        while (true) {
+            while (active < 4 && next < count) {
+                StartLane(lanes[active++], s, bytes, inputs[next], lengths[next], output + OUTPUT_SIZE * next);
+                ++next;
+            }
+            if (active < 4) break;
+            for (size_t i = 0; i < 4; ++i) {
+                states[i] = lanes[i].s;
+                chunks[i] = NextChunk(lanes[i]);
+            }
+            TransformMulti_4way(states, chunks);
+            for (size_t i = 0; i < active;) {
+                if (FinishChunk(lanes[i])) {
+                    lanes[i] = lanes[--active];
+                } else {
+                    ++i;
+                }
+            }
+        }
+        // Finish what is left one message at a time.
+        for (size_t i = 0; i < active; ++i) {
+            do {
+                sha512::Transform(lanes[i].s, NextChunk(lanes[i]));
+            } while (!FinishChunk(lanes[i]));
+        }
+    }
+    for (; next < count; ++next) {
+        CSHA512(*this).Write(inputs[next], lengths[next]).Finalize(output + OUTPUT_SIZE * next);
+    }
+}
+
 CSHA512& CSHA512::Reset()
 {
     bytes = 0;
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-512. */
 class CSHA512
@@ -23,6 +24,18 @@ public:
     CSHA512& Write(const unsigned char* data, size_t len);
     void Finalize(unsigned char hash[OUTPUT_SIZE]);
     CSHA512& Reset();
+
+    /** Finalize copies of this hasher, each extended with one of count
+     *  messages, into count*OUTPUT_SIZE bytes of output. The messages are
+     *  hashed in parallel lanes where the CPU supports it, which makes this
+     *  cheap for many messages after a common prefix (as in HMAC).
+     */
+    void FinalizeMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count) const;
 };
 
+/** Autodetect the best available SHA512 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string SHA512AutoDetect();
+
 #endif // BITCOIN_CRYPTO_SHA512_H
@@ -0,0 +1,127 @@
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/sha512.h>
+#include <crypto/common.h>
+
+namespace sha512_avx2 {
+namespace {
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z) { return Add(Add(x, y), z); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z, __m256i w) { return Add(Add(x, y), Add(z, w)); }
+__m256i inline Inc(__m256i& x, __m256i y, __m256i z, __m256i w) { x = Add(x, y, z, w); return x; }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z) { return Xor(Xor(x, y), z); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__m256i inline ShR(__m256i x, int n) { return _mm256_srli_epi64(x, n); }
+__m256i inline ShL(__m256i x, int n) { return _mm256_slli_epi64(x, n); }
+
+__m256i inline Ch(__m256i x, __m256i y, __m256i z) { return Xor(z, And(x, Xor(y, z))); }
+__m256i inline Maj(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m256i inline Sigma0(__m256i x) { return Xor(Or(ShR(x, 28), ShL(x, 36)), Or(ShR(x, 34), ShL(x, 30)), Or(ShR(x, 39), ShL(x, 25))); }
+__m256i inline Sigma1(__m256i x) { return Xor(Or(ShR(x, 14), ShL(x, 50)), Or(ShR(x, 18), ShL(x, 46)), Or(ShR(x, 41), ShL(x, 23))); }
+__m256i inline sigma0(__m256i x) { return Xor(Or(ShR(x, 1), ShL(x, 63)), Or(ShR(x, 8), ShL(x, 56)), ShR(x, 7)); }
+__m256i inline sigma1(__m256i x) { return Xor(Or(ShR(x, 19), ShL(x, 45)), Or(ShR(x, 61), ShL(x, 3)), ShR(x, 6)); }
+
+/** One round of SHA-512. */
+void inline __attribute__((always_inline)) Round(__m256i a, __m256i b, __m256i c, __m256i& d, __m256i e, __m256i f, __m256i g, __m256i& h, __m256i k)
+{
+    __m256i t1 = Add(h, Sigma1(e), Ch(e, f, g), k);
+    __m256i t2 = Add(Sigma0(a), Maj(a, b, c));
+    d = Add(d, t1);
+    h = Add(t1, t2);
+}
+
+const uint64_t ROUND_CONSTANTS[80] = {
+    0x428a2f98d728ae22ull, 0x7137449123ef65cdull, 0xb5c0fbcfec4d3b2full, 0xe9b5dba58189dbbcull,
+    0x3956c25bf348b538ull, 0x59f111f1b605d019ull, 0x923f82a4af194f9bull, 0xab1c5ed5da6d8118ull,
+    0xd807aa98a3030242ull, 0x12835b0145706fbeull, 0x243185be4ee4b28cull, 0x550c7dc3d5ffb4e2ull,
+    0x72be5d74f27b896full, 0x80deb1fe3b1696b1ull, 0x9bdc06a725c71235ull, 0xc19bf174cf692694ull,
+    0xe49b69c19ef14ad2ull, 0xefbe4786384f25e3ull, 0x0fc19dc68b8cd5b5ull, 0x240ca1cc77ac9c65ull,
+    0x2de92c6f592b0275ull, 0x4a7484aa6ea6e483ull, 0x5cb0a9dcbd41fbd4ull, 0x76f988da831153b5ull,
+    0x983e5152ee66dfabull, 0xa831c66d2db43210ull, 0xb00327c898fb213full, 0xbf597fc7beef0ee4ull,
+    0xc6e00bf33da88fc2ull, 0xd5a79147930aa725ull, 0x06ca6351e003826full, 0x142929670a0e6e70ull,
+    0x27b70a8546d22ffcull, 0x2e1b21385c26c926ull, 0x4d2c6dfc5ac42aedull, 0x53380d139d95b3dfull,
+    0x650a73548baf63deull, 0x766a0abb3c77b2a8ull, 0x81c2c92e47edaee6ull, 0x92722c851482353bull,
+    0xa2bfe8a14cf10364ull, 0xa81a664bbc423001ull, 0xc24b8b70d0f89791ull, 0xc76c51a30654be30ull,
+    0xd192e819d6ef5218ull, 0xd69906245565a910ull, 0xf40e35855771202aull, 0x106aa07032bbd1b8ull,
+    0x19a4c116b8d2d0c8ull, 0x1e376c085141ab53ull, 0x2748774cdf8eeb99ull, 0x34b0bcb5e19b48a8ull,
+    0x391c0cb3c5c95a63ull, 0x4ed8aa4ae3418acbull, 0x5b9cca4f7763e373ull, 0x682e6ff3d6b2b8a3ull,
+    0x748f82ee5defb2fcull, 0x78a5636f43172f60ull, 0x84c87814a1f0ab72ull, 0x8cc702081a6439ecull,
+    0x90befffa23631e28ull, 0xa4506cebde82bde9ull, 0xbef9a3f7b2c67915ull, 0xc67178f2e372532bull,
+    0xca273eceea26619cull, 0xd186b8c721c0c207ull, 0xeada7dd6cde0eb1eull, 0xf57d4f7fee6ed178ull,
+    0x06f067aa72176fbaull, 0x0a637dc5a2c898a6ull, 0x113f9804bef90daeull, 0x1b710b35131c471bull,
+    0x28db77f523047d84ull, 0x32caab7b40c72493ull, 0x3c9ebe0a15c9bebcull, 0x431d67c49c100d4cull,
+    0x4cc5d4becb3e42b6ull, 0x597f299cfc657e2aull, 0x5fcb6fab3ad6faecull, 0x6c44198c4a475817ull
+};
+
+__m256i inline ReadLanes(const unsigned char* const* chunks, int offset)
+{
+    return _mm256_set_epi64x(ReadBE64(chunks[3] + offset), ReadBE64(chunks[2] + offset), ReadBE64(chunks[1] + offset), ReadBE64(chunks[0] + offset));
+}
+}
+
+void Transform_4way(uint64_t* const* s, const unsigned char* const* chunks)
+{
+    __m256i w[16];
+    __m256i st[8];
+    for (int i = 0; i < 8; ++i) {
+        st[i] = _mm256_set_epi64x(s[3][i], s[2][i], s[1][i], s[0][i]);
+    }
+    __m256i a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+
+    for (int i = 0; i < 16; i += 8) {
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 0]), w[i + 0] = ReadLanes(chunks, 8 * i + 0)));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 1]), w[i + 1] = ReadLanes(chunks, 8 * i + 8)));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 2]), w[i + 2] = ReadLanes(chunks, 8 * i + 16)));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 3]), w[i + 3] = ReadLanes(chunks, 8 * i + 24)));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 4]), w[i + 4] = ReadLanes(chunks, 8 * i + 32)));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 5]), w[i + 5] = ReadLanes(chunks, 8 * i + 40)));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 6]), w[i + 6] = ReadLanes(chunks, 8 * i + 48)));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 7]), w[i + 7] = ReadLanes(chunks, 8 * i + 56)));
+    }
+    for (int i = 16; i < 80; i += 16) {
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 0]), Inc(w[0], sigma1(w[14]), w[9], sigma0(w[1]))));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 1]), Inc(w[1], sigma1(w[15]), w[10], sigma0(w[2]))));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 2]), Inc(w[2], sigma1(w[0]), w[11], sigma0(w[3]))));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 3]), Inc(w[3], sigma1(w[1]), w[12], sigma0(w[4]))));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 4]), Inc(w[4], sigma1(w[2]), w[13], sigma0(w[5]))));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 5]), Inc(w[5], sigma1(w[3]), w[14], sigma0(w[6]))));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 6]), Inc(w[6], sigma1(w[4]), w[15], sigma0(w[7]))));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 7]), Inc(w[7], sigma1(w[5]), w[0], sigma0(w[8]))));
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 8]), Inc(w[8], sigma1(w[6]), w[1], sigma0(w[9]))));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 9]), Inc(w[9], sigma1(w[7]), w[2], sigma0(w[10]))));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 10]), Inc(w[10], sigma1(w[8]), w[3], sigma0(w[11]))));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 11]), Inc(w[11], sigma1(w[9]), w[4], sigma0(w[12]))));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 12]), Inc(w[12], sigma1(w[10]), w[5], sigma0(w[13]))));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 13]), Inc(w[13], sigma1(w[11]), w[6], sigma0(w[14]))));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 14]), Inc(w[14], sigma1(w[12]), w[7], sigma0(w[15]))));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 15]), Inc(w[15], sigma1(w[13]), w[8], sigma0(w[0]))));
+    }
+
+    st[0] = Add(st[0], a);
+    st[1] = Add(st[1], b);
+    st[2] = Add(st[2], c);
+    st[3] = Add(st[3], d);
+    st[4] = Add(st[4], e);
+    st[5] = Add(st[5], f);
+    st[6] = Add(st[6], g);
+    st[7] = Add(st[7], h);
+    for (int i = 0; i < 8; ++i) {
+        alignas(sizeof(__m256i)) uint64_t lanes[4];
+        _mm256_store_si256(((__m256i*)lanes), st[i]);
+        for (int j = 0; j < 4; ++j) {
+            s[j][i] = lanes[j];
+        }
+    }
+}
+
+}
+
+#endif
@@ -4,6 +4,19 @@
 
 #include <crypto/siphash.h>
 
+#include <crypto/common.h>
+#include <crypto/cpuid.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+namespace siphash_avx2
+{
+void Uint256_4way(uint64_t k0, uint64_t k1, uint64_t* output, const uint256* const* inputs);
+void Uint256_8way(uint64_t k0, uint64_t k1, uint64_t* output, const uint256* const* inputs);
+void Bytes_4way(uint64_t k0, uint64_t k1, uint64_t* output, const unsigned char* const* inputs, const size_t* lengths);
+}
+
 #define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
 
 #define SIPROUND do { \
@@ -171,3 +184,111 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace
+{
+/** Hash one uint256 per lane. */
+typedef void (*Uint256MultiType)(uint64_t k0, uint64_t k1, uint64_t* output, const uint256* const* inputs);
+/** Hash one message of any length per lane. */
+typedef void (*BytesMultiType)(uint64_t k0, uint64_t k1, uint64_t* output, const unsigned char* const* inputs, const size_t* lengths);
+
+Uint256MultiType Uint256Multi_4way = nullptr;
+Uint256MultiType Uint256Multi_8way = nullptr;
+BytesMultiType BytesMulti_4way = nullptr;
+
+bool SelfTest()
+{
+    const uint64_t k0 = 0x0706050403020100ULL, k1 = 0x0F0E0D0C0B0A0908ULL;
+    unsigned char data[64];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i * 13 + 1;
+    }
+
+    // Values overlapping each other in data.
+    uint256 vals[8];
+    const uint256* val_ptrs[8];
+    uint64_t expected[8], out[8];
+    for (int i = 0; i < 8; ++i) {
+        vals[i] = uint256(std::vector<unsigned char>(data + 4 * i, data + 4 * i + 32));
+        val_ptrs[i] = &vals[i];
+        expected[i] = SipHashUint256(k0, k1, vals[i]);
+    }
+    if (Uint256Multi_4way) {
+        Uint256Multi_4way(k0, k1, out, val_ptrs);
+        if (!std::equal(out, out + 4, expected)) return false;
+    }
+    if (Uint256Multi_8way) {
+        Uint256Multi_8way(k0, k1, out, val_ptrs);
+        if (!std::equal(out, out + 8, expected)) return false;
+    }
+
+    // Messages of different lengths, ending inside and at the end of a word.
+    const unsigned char* inputs[4] = {data, data + 1, data + 2, data + 3};
+    const size_t lengths[4] = {0, 7, 8, 61};
+    for (int i = 0; i < 4; ++i) {
+        expected[i] = CSipHasher(k0, k1).Write(inputs[i], lengths[i]).Finalize();
+    }
+    if (BytesMulti_4way) {
+        BytesMulti_4way(k0, k1, out, inputs, lengths);
+        if (!std::equal(out, out + 4, expected)) return false;
+    }
+    return true;
+}
+} // namespace
+
+std::string SipHashAutoDetect()
+{
+    std::string ret = "standard";
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (GetCPUFeatures().avx2) {
+        Uint256Multi_4way = siphash_avx2::Uint256_4way;
+        Uint256Multi_8way = siphash_avx2::Uint256_8way;
+        BytesMulti_4way = siphash_avx2::Bytes_4way;
+        ret += ",avx2(4way,8way)";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+void SipHashUint256Multi(uint64_t k0, uint64_t k1, uint64_t* output, const uint256* const* inputs, size_t count)
+{
+    if (Uint256Multi_8way) {
+        while (count >= 8) {
+            Uint256Multi_8way(k0, k1, output, inputs);
+            output += 8;
+            inputs += 8;
+            count -= 8;
+        }
+    }
+    if (Uint256Multi_4way) {
+        while (count >= 4) {
+            Uint256Multi_4way(k0, k1, output, inputs);
+            output += 4;
+            inputs += 4;
+            count -= 4;
+        }
+    }
+    while (count) {
+        *output++ = SipHashUint256(k0, k1, **inputs++);
+        --count;
+    }
+}
+
+void SipHashMulti(uint64_t k0, uint64_t k1, uint64_t* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    if (BytesMulti_4way) {
+        while (count >= 4) {
+            BytesMulti_4way(k0, k1, output, inputs, lengths);
+            output += 4;
+            inputs += 4;
+            lengths += 4;
+            count -= 4;
+        }
+    }
+    while (count) {
+        *output++ = CSipHasher(k0, k1).Write(*inputs++, *lengths++).Finalize();
+        --count;
+    }
+}
@@ -6,6 +6,7 @@
 #define BITCOIN_CRYPTO_SIPHASH_H
 
 #include <stdint.h>
+#include <string>
 
 #include <uint256.h>
 
@@ -44,4 +45,27 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** Compute the SipHashUint256's of multiple values, in parallel lanes where
+ *  the CPU supports it.
+ *  output: pointer to a count-element output buffer
+ *  inputs: pointers to the count values
+ *  count:  the number of hashes to compute.
+ */
+void SipHashUint256Multi(uint64_t k0, uint64_t k1, uint64_t* output, const uint256* const* inputs, size_t count);
+
+/** Compute the SipHash-2-4's of multiple messages of any length (as
+ *  CSipHasher(k0, k1).Write(data, size).Finalize() would), in parallel lanes
+ *  where the CPU supports it.
+ *  output:  pointer to a count-element output buffer
+ *  inputs:  pointers to the count messages
+ *  lengths: their lengths in bytes
+ *  count:   the number of hashes to compute.
+ */
+void SipHashMulti(uint64_t k0, uint64_t k1, uint64_t* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
+/** Autodetect the best available SipHash implementation for the Multi functions.
+ *  Returns the name of the implementation.
+ */
+std::string SipHashAutoDetect();
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
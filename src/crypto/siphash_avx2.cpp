@@ -0,0 +1,165 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+#include <crypto/siphash.h>
+
+namespace siphash_avx2 {
+namespace {
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z, __m256i w) { return Xor(Xor(x, y), Xor(z, w)); }
+
+template <int n>
+__m256i inline Rol(__m256i x) { return _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - n)); }
+
+/** Rotations by 16 and 32 bits move whole bytes, which a single shuffle does. */
+template <>
+__m256i inline Rol<16>(__m256i x)
+{
+    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(
+        6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13,
+        6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13));
+}
+
+template <>
+__m256i inline Rol<32>(__m256i x) { return _mm256_shuffle_epi32(x, 0xB1); }
+
+/** The SipHash state of four lanes. */
+struct Lanes
+{
+    __m256i v0, v1, v2, v3;
+
+    Lanes(uint64_t k0, uint64_t k1) :
+        v0(K(0x736f6d6570736575ULL ^ k0)),
+        v1(K(0x646f72616e646f6dULL ^ k1)),
+        v2(K(0x6c7967656e657261ULL ^ k0)),
+        v3(K(0x7465646279746573ULL ^ k1)) {}
+};
+
+void inline __attribute__((always_inline)) SipRound(Lanes& s)
+{
+    s.v0 = Add(s.v0, s.v1); s.v1 = Rol<13>(s.v1); s.v1 = Xor(s.v1, s.v0);
+    s.v0 = Rol<32>(s.v0);
+    s.v2 = Add(s.v2, s.v3); s.v3 = Rol<16>(s.v3); s.v3 = Xor(s.v3, s.v2);
+    s.v0 = Add(s.v0, s.v3); s.v3 = Rol<21>(s.v3); s.v3 = Xor(s.v3, s.v0);
+    s.v2 = Add(s.v2, s.v1); s.v1 = Rol<17>(s.v1); s.v1 = Xor(s.v1, s.v2);
+    s.v2 = Rol<32>(s.v2);
+}
+
+/** Hash one 64-bit word of each lane's message. */
+void inline __attribute__((always_inline)) Compress(Lanes& s, __m256i m)
+{
+    s.v3 = Xor(s.v3, m);
+    SipRound(s);
+    SipRound(s);
+    s.v0 = Xor(s.v0, m);
+}
+
+__m256i inline __attribute__((always_inline)) Finalize(Lanes& s)
+{
+    s.v2 = Xor(s.v2, K(0xFF));
+    SipRound(s);
+    SipRound(s);
+    SipRound(s);
+    SipRound(s);
+    return Xor(s.v0, s.v1, s.v2, s.v3);
+}
+
+/** Load word j of the four values into w[j], for each j. */
+void inline Load(__m256i w[4], const uint256* const* inputs)
+{
+    __m256i a = _mm256_loadu_si256((const __m256i*)inputs[0]->begin());
+    __m256i b = _mm256_loadu_si256((const __m256i*)inputs[1]->begin());
+    __m256i c = _mm256_loadu_si256((const __m256i*)inputs[2]->begin());
+    __m256i d = _mm256_loadu_si256((const __m256i*)inputs[3]->begin());
+    __m256i ab0 = _mm256_unpacklo_epi64(a, b), ab1 = _mm256_unpackhi_epi64(a, b);
+    __m256i cd0 = _mm256_unpacklo_epi64(c, d), cd1 = _mm256_unpackhi_epi64(c, d);
+    w[0] = _mm256_permute2x128_si256(ab0, cd0, 0x20);
+    w[1] = _mm256_permute2x128_si256(ab1, cd1, 0x20);
+    w[2] = _mm256_permute2x128_si256(ab0, cd0, 0x31);
+    w[3] = _mm256_permute2x128_si256(ab1, cd1, 0x31);
+}
+
+/** Word t of a message as SipHash reads it, the last one holding its length. */
+uint64_t inline Word(const unsigned char* data, size_t len, size_t t)
+{
+    if (t < len / 8) return ReadLE64(data + 8 * t);
+    uint64_t word = ((uint64_t)len) << 56;
+    for (size_t i = 8 * t; i < len; ++i) {
+        word |= ((uint64_t)data[i]) << (8 * (i - 8 * t));
+    }
+    return word;
+}
+
+} // namespace
+
+void Uint256_4way(uint64_t k0, uint64_t k1, uint64_t* output, const uint256* const* inputs)
+{
+    __m256i w[4];
+    Load(w, inputs);
+    Lanes s(k0, k1);
+    for (int j = 0; j < 4; ++j) {
+        Compress(s, w[j]);
+    }
+    Compress(s, K(((uint64_t)32) << 56));
+    _mm256_storeu_si256((__m256i*)output, Finalize(s));
+}
+
+void Uint256_8way(uint64_t k0, uint64_t k1, uint64_t* output, const uint256* const* inputs)
+{
+    // Two independent groups of four lanes, so that the CPU can overlap their rounds.
+    __m256i wa[4], wb[4];
+    Load(wa, inputs);
+    Load(wb, inputs + 4);
+    Lanes a(k0, k1), b(k0, k1);
+    for (int j = 0; j < 4; ++j) {
+        Compress(a, wa[j]);
+        Compress(b, wb[j]);
+    }
+    Compress(a, K(((uint64_t)32) << 56));
+    Compress(b, K(((uint64_t)32) << 56));
+    _mm256_storeu_si256((__m256i*)output, Finalize(a));
+    _mm256_storeu_si256((__m256i*)(output + 4), Finalize(b));
+}
+
+void Bytes_4way(uint64_t k0, uint64_t k1, uint64_t* output, const unsigned char* const* inputs, const size_t* lengths)
+{
+    // Lanes whose message is done keep their state while the longer ones
+    // continue, and are finalized with them.
+    size_t words[4], max_words = 0;
+    for (int i = 0; i < 4; ++i) {
+        words[i] = lengths[i] / 8 + 1;
+        if (words[i] > max_words) max_words = words[i];
+    }
+    const __m256i remaining = _mm256_setr_epi64x(words[0], words[1], words[2], words[3]);
+    Lanes s(k0, k1);
+    for (size_t t = 0; t < max_words; ++t) {
+        const __m256i m = _mm256_setr_epi64x(
+            t < words[0] ? Word(inputs[0], lengths[0], t) : 0,
+            t < words[1] ? Word(inputs[1], lengths[1], t) : 0,
+            t < words[2] ? Word(inputs[2], lengths[2], t) : 0,
+            t < words[3] ? Word(inputs[3], lengths[3], t) : 0);
+        const __m256i active = _mm256_cmpgt_epi64(remaining, K(t));
+        Lanes next = s;
+        Compress(next, m);
+        s.v0 = _mm256_blendv_epi8(s.v0, next.v0, active);
+        s.v1 = _mm256_blendv_epi8(s.v1, next.v1, active);
+        s.v2 = _mm256_blendv_epi8(s.v2, next.v2, active);
+        s.v3 = _mm256_blendv_epi8(s.v3, next.v3, active);
+    }
+    _mm256_storeu_si256((__m256i*)output, Finalize(s));
+}
+
+} // namespace siphash_avx2
+
+#endif
@@ -176,6 +176,12 @@ private:
      */
     mutable std::vector<bool> epoch_flags;
 
+    /** aged_flags marks the entries that epoch_check made collectible while
+     * they were still in use (as opposed to erased ones), so that insert can
+     * report overwriting them as an eviction.
+     */
+    std::vector<bool> aged_flags;
+
     /** epoch_heuristic_counter is used to determine when an epoch might be aged
      * & an expensive scan should be done.  epoch_heuristic_counter is
      * decremented on insert and reset to the new number of inserts which would
@@ -306,8 +312,11 @@ private:
             for (uint32_t i = 0; i < size; ++i)
                 if (epoch_flags[i])
                     epoch_flags[i] = false;
-                else
+                else {
+                    if (!collection_flags.bit_is_set(i))
+                        aged_flags[i] = true;
                     allow_erase(i);
+                }
             epoch_heuristic_counter = epoch_size;
         } else
             // reset the epoch_heuristic_counter to next do a scan when worst
@@ -324,7 +333,7 @@ public:
     /** You must always construct a cache with some elements via a subsequent
      * call to setup or setup_bytes, otherwise operations may segfault.
      */
-    cache() : table(), size(), collection_flags(0), epoch_flags(),
+    cache() : table(), size(), collection_flags(0), epoch_flags(), aged_flags(),
     epoch_heuristic_counter(), epoch_size(), depth_limit(0), hash_function()
     {
     }
@@ -345,6 +354,7 @@ public:
         table.resize(size);
         collection_flags.setup(size);
         epoch_flags.resize(size);
+        aged_flags.resize(size);
         // Set to 45% as described above
         epoch_size = std::max((uint32_t)1, (45 * size) / 100);
         // Initially set to wait for a whole epoch
@@ -387,9 +397,11 @@ public:
      * @post one of the following: All previously inserted elements and e are
      * now in the table, one previously inserted element is evicted from the
      * table, the entry attempted to be inserted is evicted.
-     *
+     * @returns true if an element that was not erased had to be dropped to
+     * make room (either at the end of the cuckoo walk or because its slot was
+     * reclaimed by age), false otherwise
      */
-    inline void insert(Element e)
+    inline bool insert(Element e)
     {
         epoch_check();
         uint32_t last_loc = invalid();
@@ -401,17 +413,20 @@ public:
             if (table[loc] == e) {
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                aged_flags[loc] = false;
+                return false;
             }
         for (uint8_t depth = 0; depth < depth_limit; ++depth) {
             // First try to insert to an empty slot, if one exists
             for (const uint32_t loc : locs) {
                 if (!collection_flags.bit_is_set(loc))
                     continue;
+                const bool evicted = aged_flags[loc];
                 table[loc] = std::move(e);
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                aged_flags[loc] = false;
+                return evicted;
             }
             /** Swap with the element at the location that was
             * not the last one looked at. Example:
@@ -437,6 +452,7 @@ public:
             // Recompute the locs -- unfortunately happens one too many times!
             locs = compute_hashes(e);
         }
+        return true;
     }
 
     /* contains iterates through the hash locations for a given element
@@ -5,7 +5,17 @@
 #include <hash.h>
 #include <crypto/common.h>
 #include <crypto/hmac_sha512.h>
+#include <support/cleanse.h>
 
+#include <vector>
+
+
+void Hash160Multi(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    std::vector<unsigned char> sha(CSHA256::OUTPUT_SIZE * count);
+    SHA256Multi(sha.data(), inputs, lengths, count);
+    RIPEMD160_32(output, sha.data(), count);
+}
 
 inline uint32_t ROTL32(uint32_t x, int8_t r)
 {
@@ -77,3 +87,20 @@ void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char he
     num[3] = (nChild >>  0) & 0xFF;
     CHMAC_SHA512(chainCode.begin(), chainCode.size()).Write(&header, 1).Write(data, 32).Write(num, 4).Finalize(output);
 }
+
+void BIP32HashMulti(const ChainCode &chainCode, const unsigned int* children, size_t count, unsigned char header, const unsigned char data[32], unsigned char* output)
+{
+    std::vector<unsigned char> messages(37 * count);
+    std::vector<const unsigned char*> inputs(count);
+    const std::vector<size_t> lengths(count, 37);
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char* message = messages.data() + 37 * i;
+        message[0] = header;
+        memcpy(message + 1, data, 32);
+        WriteBE32(message + 33, children[i]);
+        inputs[i] = message;
+    }
+    CHMAC_SHA512(chainCode.begin(), chainCode.size()).FinalizeMulti(output, inputs.data(), lengths.data(), count);
+    // For hardened children, data is a private key.
+    memory_cleanse(messages.data(), messages.size());
+}
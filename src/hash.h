@@ -113,6 +113,14 @@ inline uint160 Hash160(const prevector<N, unsigned char>& vch)
     return Hash160(vch.begin(), vch.end());
 }
 
+/** Compute the 160-bit hashes of count messages at once, in parallel SHA256
+ *  and RIPEMD160 lanes where the CPU supports it.
+ *  output:  pointer to a count*20 byte output buffer
+ *  inputs:  pointers to the count messages
+ *  lengths: their lengths in bytes
+ */
+void Hash160Multi(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
 /** A writer stream (for serialization) that computes a 256-bit hash. */
 class CHashWriter
 {
@@ -204,4 +212,7 @@ unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char
 
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
 
+/** BIP32Hash for count children of the same parent at once, into count*64 bytes of output. */
+void BIP32HashMulti(const ChainCode &chainCode, const unsigned int* children, size_t count, unsigned char header, const unsigned char data[32], unsigned char* output);
+
 #endif // BITCOIN_HASH_H
@@ -7,6 +7,7 @@
 #include <chainparams.h>
 #include <httpserver.h>
 #include <key_io.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <random.h>
@@ -175,6 +176,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
+    bool streaming = false;
     try {
         // Parse request
         UniValue valRequest;
@@ -189,8 +191,29 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // The reply is only started once the first chunk of a streamed
+            // result is ready, so errors raised before that are still
+            // reported normally.
+            JSONStreamWriter stream([req, &streaming](const std::string& chunk) {
+                if (!streaming) {
+                    req->WriteHeader("Content-Type", "application/json");
+                    req->StartChunkedReply(HTTP_OK);
+                    req->WriteReplyChunk("{\"result\":");
+                    streaming = true;
+                }
+                req->WriteReplyChunk(chunk);
+            });
+            jreq.resultStream = &stream;
+
             UniValue result = tableRPC.execute(jreq);
 
+            if (stream.IsUsed()) {
+                stream.Flush();
+                req->WriteReplyChunk(",\"error\":null,\"id\":" + jreq.id.write() + "}\n");
+                req->EndChunkedReply();
+                return true;
+            }
+
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
@@ -203,9 +226,19 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
+        if (streaming) {
+            LogPrintf("%s: error after the reply to %s was partly sent: %s\n", __func__, jreq.strMethod, objError.write());
+            req->EndChunkedReply();
+            return false;
+        }
         JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
+        if (streaming) {
+            LogPrintf("%s: error after the reply to %s was partly sent: %s\n", __func__, jreq.strMethod, e.what());
+            req->EndChunkedReply();
+            return false;
+        }
         JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
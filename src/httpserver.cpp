@@ -42,6 +42,9 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Bytes of a chunked reply that may wait to be sent before WriteReplyChunk blocks */
+static const size_t MAX_CHUNKED_REPLY_BACKLOG = 1024 * 1024;
+
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
 {
@@ -516,6 +519,11 @@ HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (chunkedReply && !replySent) {
+        // The body is already partly sent, all we can do is end it
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        EndChunkedReply();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -562,6 +570,22 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+/** Re-enable reading from the socket once a reply has been sent. This is the
+ * second part of the libevent workaround in http_request_cb.
+ */
+static void ReenableReading(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -580,17 +604,107 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
+        ReenableReading(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+/** How much of a chunked reply is still waiting to be sent to the client. */
+struct ChunkedReplyState
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    //! Bytes of chunks handed to the main http thread, not yet added to the connection's output
+    size_t queued{0};
+    //! Bytes in the connection's output buffer
+    size_t output{0};
+    //! Watch on the output buffer; only used from the main http thread
+    struct evbuffer_cb_entry* output_cb{nullptr};
+};
+
+static struct evbuffer* GetOutputBuffer(struct evhttp_request* req)
+{
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    bufferevent* bev = conn ? evhttp_connection_get_bufferevent(conn) : nullptr;
+    return bev ? bufferevent_get_output(bev) : nullptr;
+}
+
+/** Called by libevent in the main http thread whenever the output buffer grows or is drained. */
+static void ChunkedReplyOutputCallback(struct evbuffer* buffer, const struct evbuffer_cb_info*, void* arg)
+{
+    ChunkedReplyState* state = static_cast<ChunkedReplyState*>(arg);
+    {
+        std::lock_guard<std::mutex> lock(state->cs);
+        state->output = evbuffer_get_length(buffer);
+    }
+    state->cond.notify_all();
+}
+
+/* Chunks are sent from the main http thread like WriteReply. Events
+ * triggered from the same thread run in the order they were triggered, so
+ * the chunks go out in order.
+ */
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && !chunkedReply && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    chunkedReply = std::make_shared<ChunkedReplyState>();
+    auto req_copy = req;
+    auto state = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus, state]{
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+        struct evbuffer* output = GetOutputBuffer(req_copy);
+        if (output) state->output_cb = evbuffer_add_cb(output, ChunkedReplyOutputCallback, state.get());
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& chunk)
+{
+    assert(chunkedReply && !replySent && req);
+    if (chunk.empty()) {
+        return; // an empty chunk would terminate the body
+    }
+    auto state = chunkedReply;
+    {
+        std::unique_lock<std::mutex> lock(state->cs);
+        const std::chrono::seconds timeout(gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+        if (!state->cond.wait_for(lock, timeout, [&state]{ return state->queued + state->output < MAX_CHUNKED_REPLY_BACKLOG; })) {
+            throw std::runtime_error("Timed out waiting for the client to read the reply");
+        }
+        state->queued += chunk.size();
+    }
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    auto req_copy = req;
+    const size_t size = chunk.size();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, state, size]{
+        evhttp_send_reply_chunk(req_copy, evb);
+        evbuffer_free(evb);
+        {
+            std::lock_guard<std::mutex> lock(state->cs);
+            state->queued -= size;
         }
+        state->cond.notify_all();
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(chunkedReply && !replySent && req);
+    auto req_copy = req;
+    auto state = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, state]{
+        struct evbuffer* output = GetOutputBuffer(req_copy);
+        if (output && state->output_cb) evbuffer_remove_cb_entry(output, state->output_cb);
+        evhttp_send_reply_end(req_copy);
+        ReenableReading(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
@@ -8,6 +8,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -16,6 +17,7 @@ static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 struct evhttp_request;
 struct event_base;
 class CService;
+struct ChunkedReplyState;
 class HTTPRequest;
 
 /** Initialize HTTP server.
@@ -59,6 +61,8 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    //! Progress of a reply started with StartChunkedReply, null otherwise
+    std::shared_ptr<ChunkedReplyState> chunkedReply;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req);
@@ -114,6 +118,32 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, for bodies that are produced incrementally.
+     * The body is sent with WriteReplyChunk and the reply is completed with
+     * EndChunkedReply. The status cannot be changed once this is called.
+     *
+     * @note Use instead of WriteReply. Headers must be written before this.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Send the next part of a reply started with StartChunkedReply.
+     *
+     * Blocks while the client has not read most of the previous parts, so a
+     * slow client does not make the whole reply build up in memory. Throws
+     * std::runtime_error if it reads nothing for -rpcservertimeout seconds.
+     */
+    void WriteReplyChunk(const std::string& chunk);
+
+    /**
+     * Complete a reply started with StartChunkedReply.
+     *
+     * @note As this will give the request back to the main thread, do not
+     * call any other HTTPRequest methods after calling this.
+     */
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
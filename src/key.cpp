@@ -293,6 +293,49 @@ bool CExtKey::Derive(CExtKey &out, unsigned int _nChild) const {
     return key.Derive(out.key, out.chaincode, _nChild, chaincode);
 }
 
+bool CExtKey::DeriveMulti(std::vector<CExtKey>& out, const std::vector<unsigned int>& children) const {
+    assert(key.IsValid());
+    assert(key.IsCompressed());
+    out.resize(children.size());
+    if (children.empty()) return true;
+    const CPubKey pubkey = key.GetPubKey();
+    assert(pubkey.size() == CPubKey::COMPRESSED_PUBLIC_KEY_SIZE);
+    const CKeyID id = pubkey.GetID();
+    // Unhardened and hardened children commit to different parent data, so hash them in separate batches.
+    for (const bool hardened : {false, true}) {
+        std::vector<size_t> positions;
+        std::vector<unsigned int> batch;
+        for (size_t i = 0; i < children.size(); ++i) {
+            if ((children[i] >> 31) == hardened) {
+                positions.push_back(i);
+                batch.push_back(children[i]);
+            }
+        }
+        if (batch.empty()) continue;
+        std::vector<unsigned char, secure_allocator<unsigned char>> hashes(64 * batch.size());
+        if (hardened) {
+            BIP32HashMulti(chaincode, batch.data(), batch.size(), 0, key.begin(), hashes.data());
+        } else {
+            BIP32HashMulti(chaincode, batch.data(), batch.size(), *pubkey.begin(), pubkey.begin() + 1, hashes.data());
+        }
+        std::vector<unsigned char, secure_allocator<unsigned char>> tweaked(32);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const unsigned char* hash = hashes.data() + 64 * i;
+            CExtKey& child = out[positions[i]];
+            child.nDepth = nDepth + 1;
+            memcpy(&child.vchFingerprint[0], &id, 4);
+            child.nChild = batch[i];
+            memcpy(child.chaincode.begin(), hash + 32, 32);
+            memcpy(tweaked.data(), key.begin(), 32);
+            if (!secp256k1_ec_privkey_tweak_add(secp256k1_context_sign, tweaked.data(), hash)) {
+                return false;
+            }
+            child.key.Set(tweaked.begin(), tweaked.end(), true);
+        }
+    }
+    return true;
+}
+
 void CExtKey::SetSeed(const unsigned char *seed, unsigned int nSeedLen) {
     static const unsigned char hashkey[] = {'B','i','t','c','o','i','n',' ','s','e','e','d'};
     std::vector<unsigned char, secure_allocator<unsigned char>> vout(64);
@@ -157,6 +157,8 @@ struct CExtKey {
     void Encode(unsigned char code[BIP32_EXTKEY_SIZE]) const;
     void Decode(const unsigned char code[BIP32_EXTKEY_SIZE]);
     bool Derive(CExtKey& out, unsigned int nChild) const;
+    //! Derive several children at once, sharing the work on the parent and hashing in parallel lanes where possible.
+    bool DeriveMulti(std::vector<CExtKey>& out, const std::vector<unsigned int>& children) const;
     CExtPubKey Neuter() const;
     void SetSeed(const unsigned char* seed, unsigned int nSeedLen);
     template <typename Stream>
@@ -14,10 +14,14 @@
 #include <clientversion.h>
 #include <consensus/consensus.h>
 #include <crypto/common.h>
+#include <crypto/hkdf_sha256_32.h>
+#include <crypto/poly1305.h>
 #include <crypto/sha256.h>
 #include <primitives/transaction.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
 #include <scheduler.h>
+#include <support/cleanse.h>
 #include <ui_interface.h>
 #include <util/strencodings.h>
 
@@ -31,6 +35,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -70,6 +78,13 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+#ifdef USE_EPOLL
+/** Maximum number of ready sockets returned by one epoll_wait call; any others are returned by the next */
+static const int MAX_EPOLL_EVENTS = 256;
+/** Set in the data of the epoll events of listening sockets, whose data is the socket instead of a peer id */
+static const uint64_t EPOLL_LISTEN_SOCKET = uint64_t{1} << 63;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -85,6 +100,9 @@ std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(cs_mapLocalHost);
 static bool vfLimited[NET_MAX] GUARDED_BY(cs_mapLocalHost) = {};
 std::string strSubVersion;
 
+NetBufferPool<std::vector<unsigned char>> g_net_send_buffers;
+NetBufferPool<CSerializeData> g_net_recv_buffers;
+
 void CConnman::AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -278,6 +296,53 @@ bool IsLocal(const CService& addr)
     return mapLocalHost.count(addr) > 0;
 }
 
+/** -socketevents values supported by this build, the default first */
+static const std::vector<SocketEventsMode>& SupportedSocketEventsModes()
+{
+    static const std::vector<SocketEventsMode> modes{
+#ifdef USE_EPOLL
+        SocketEventsMode::EPOLL,
+#endif
+#ifdef USE_POLL
+        SocketEventsMode::POLL,
+#else
+        SocketEventsMode::SELECT,
+#endif
+    };
+    return modes;
+}
+
+std::string SocketEventsModeToString(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SocketEventsMode::SELECT: return "select";
+    case SocketEventsMode::POLL: return "poll";
+    case SocketEventsMode::EPOLL: return "epoll";
+    }
+    assert(false);
+}
+
+bool SocketEventsModeFromString(const std::string& str, SocketEventsMode& mode)
+{
+    for (SocketEventsMode supported : SupportedSocketEventsModes()) {
+        if (str == SocketEventsModeToString(supported)) {
+            mode = supported;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+    std::string modes;
+    for (SocketEventsMode mode : SupportedSocketEventsModes()) {
+        if (!modes.empty()) modes += ", ";
+        modes += SocketEventsModeToString(mode);
+    }
+    return modes;
+}
+
 CNode* CConnman::FindNode(const CNetAddr& ip)
 {
     LOCK(cs_vNodes);
@@ -513,6 +578,7 @@ void CNode::copyStats(CNodeStats &stats)
     }
     X(fInbound);
     X(m_manual_connection);
+    X(m_encrypted);
     X(nStartingHeight);
     {
         LOCK(cs_vSend);
@@ -559,22 +625,49 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     LOCK(cs_vRecv);
     nLastRecv = nTimeMicros / 1000000;
     nRecvBytes += nBytes;
+    if (m_key_exchange == KeyExchange::DETECT && m_key_exchange_buf.size() < CMessageHeader::MESSAGE_START_SIZE) {
+        const unsigned int nCopy = std::min<size_t>(CMessageHeader::MESSAGE_START_SIZE - m_key_exchange_buf.size(), nBytes);
+        m_key_exchange_buf.insert(m_key_exchange_buf.end(), pch, pch + nCopy);
+        pch += nCopy;
+        nBytes -= nCopy;
+        if (m_key_exchange_buf.size() < CMessageHeader::MESSAGE_START_SIZE)
+            return true;
+        if (memcmp(m_key_exchange_buf.data(), Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) == 0) {
+            // A plaintext peer: what we took for its key is the start of its first message.
+            m_key_exchange = KeyExchange::NONE;
+            std::vector<unsigned char> start;
+            start.swap(m_key_exchange_buf);
+            if (!ReceiveMsgFrames((const char*)start.data(), start.size(), nTimeMicros, complete))
+                return false;
+        }
+    }
+    if (m_key_exchange != KeyExchange::NONE) {
+        const int handled = ReceiveEncryptionKey(pch, nBytes);
+        if (handled < 0)
+            return false;
+        pch += handled;
+        nBytes -= handled;
+    }
+    bool frames_complete = false;
+    if (!ReceiveMsgFrames(pch, nBytes, nTimeMicros, frames_complete))
+        return false;
+    complete = complete || frames_complete;
+    return true;
+}
+
+bool CNode::ReceiveMsgFrames(const char* pch, unsigned int nBytes, int64_t nTimeMicros, bool& complete)
+{
     while (nBytes > 0) {
 
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
 
         CNetMessage& msg = vRecvMsg.back();
 
         // absorb network data
-        int handled;
-        if (!msg.in_data)
-            handled = msg.readHeader(pch, nBytes);
-        else
-            handled = msg.readData(pch, nBytes);
-
+        int handled = m_deserializer->Read(msg, pch, nBytes);
         if (handled < 0)
             return false;
 
@@ -603,6 +696,60 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+/** Derive the keys for one direction of an encrypted connection from the ECDH secret. */
+static void DeriveEncryptionKeys(const uint256& secret, bool from_initiator, unsigned char K_1[CHACHA20_POLY1305_AEAD_KEY_LEN], unsigned char K_2[CHACHA20_POLY1305_AEAD_KEY_LEN])
+{
+    CHKDF_HMAC_SHA256_L32 hkdf(secret.begin(), secret.size(), "bitcoinecdh");
+    hkdf.Expand32(from_initiator ? "BitcoinK1A" : "BitcoinK1B", K_1);
+    hkdf.Expand32(from_initiator ? "BitcoinK2A" : "BitcoinK2B", K_2);
+}
+
+static CKey MakeEncryptionKey()
+{
+    // Only the x coordinate is sent, so the public key must have an even y.
+    // Nor may it start like a plaintext message.
+    CKey key;
+    CPubKey pubkey;
+    do {
+        key.MakeNewKey(true);
+        pubkey = key.GetPubKey();
+    } while (pubkey[0] != 0x02 || memcmp(pubkey.begin() + 1, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) == 0);
+    return key;
+}
+
+int CNode::ReceiveEncryptionKey(const char* pch, unsigned int nBytes)
+{
+    const unsigned int nCopy = std::min<size_t>(ENCRYPTION_KEY_SIZE - m_key_exchange_buf.size(), nBytes);
+    m_key_exchange_buf.insert(m_key_exchange_buf.end(), pch, pch + nCopy);
+    if (m_key_exchange_buf.size() < ENCRYPTION_KEY_SIZE)
+        return nCopy;
+
+    const bool initiator = m_key_exchange == KeyExchange::AWAIT_KEY;
+    m_key_exchange = KeyExchange::NONE;
+    std::vector<unsigned char> peer_key_data(1, 0x02);
+    peer_key_data.insert(peer_key_data.end(), m_key_exchange_buf.begin(), m_key_exchange_buf.end());
+    m_key_exchange_buf.clear();
+    if (!initiator) {
+        m_encryption_key = MakeEncryptionKey();
+    }
+    const CPubKey peer_key(peer_key_data);
+    uint256 secret;
+    if (!peer_key.ComputeECDHSecret(m_encryption_key.begin(), secret)) {
+        LogPrint(BCLog::NET, "Invalid encryption key from peer=%d, disconnecting\n", GetId());
+        return -1;
+    }
+
+    unsigned char K_1[CHACHA20_POLY1305_AEAD_KEY_LEN], K_2[CHACHA20_POLY1305_AEAD_KEY_LEN];
+    DeriveEncryptionKeys(secret, /* from_initiator */ !initiator, K_1, K_2);
+    m_deserializer = MakeUnique<EncryptedTransportDeserializer>(K_1, K_2);
+    DeriveEncryptionKeys(secret, /* from_initiator */ initiator, K_1, K_2);
+    m_next_serializer = MakeUnique<EncryptedTransportSerializer>(K_1, K_2);
+    memory_cleanse(K_1, sizeof(K_1));
+    memory_cleanse(K_2, sizeof(K_2));
+    memory_cleanse(secret.begin(), secret.size());
+    return nCopy;
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -630,6 +777,30 @@ int CNode::GetSendVersion() const
 }
 
 
+CNetMessage::CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn)
+{
+    CSerializeData buf = g_net_recv_buffers.Take(CMessageHeader::HEADER_SIZE);
+    hdrbuf.SwapStorage(buf);
+    hdrbuf.resize(24);
+    in_data = false;
+    nHdrPos = 0;
+    nDataPos = 0;
+    nTime = 0;
+}
+
+static void GiveRecvBuffer(CDataStream& stream)
+{
+    CSerializeData buf;
+    stream.SwapStorage(buf);
+    g_net_recv_buffers.Give(std::move(buf));
+}
+
+CNetMessage::~CNetMessage()
+{
+    GiveRecvBuffer(hdrbuf);
+    GiveRecvBuffer(vRecv);
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -655,6 +826,12 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     if (hdr.nMessageSize > MAX_SIZE)
         return -1;
 
+    // The header buffer can be recycled right away; the payload goes into a
+    // pooled buffer of up to the size readData() will first grow it to.
+    GiveRecvBuffer(hdrbuf);
+    CSerializeData buf = g_net_recv_buffers.Take(std::min(hdr.nMessageSize, 256U * 1024));
+    vRecv.SwapStorage(buf);
+
     // switch state to reading message data
     in_data = true;
 
@@ -692,7 +869,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
+        auto &data = *it;
         assert(data.size() > pnode->nSendOffset);
         int nBytes = 0;
         {
@@ -710,6 +887,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
                 pnode->nSendOffset = 0;
                 pnode->nSendSize -= data.size();
                 pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                g_net_send_buffers.Give(std::move(data));
                 it++;
             } else {
                 // could not send full message; stop sending more
@@ -735,6 +913,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
         assert(pnode->nSendSize == 0);
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    UpdateSocketEvents(pnode);
     return nSentSize;
 }
 
@@ -962,6 +1141,8 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     pnode->AddRef();
     pnode->fWhitelisted = whitelisted;
     pnode->m_prefer_evict = bannedlevel > 0;
+    if (m_p2p_encryption)
+        pnode->m_key_exchange = CNode::KeyExchange::DETECT;
     m_msgproc->InitializeNode(pnode);
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
@@ -969,7 +1150,9 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        m_nodes_by_id.emplace(pnode->GetId(), pnode);
     }
+    UpdateSocketEvents(pnode);
 }
 
 void CConnman::DisconnectNodes()
@@ -995,6 +1178,17 @@ void CConnman::DisconnectNodes()
             {
                 // remove from vNodes
                 vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                m_nodes_by_id.erase(pnode->GetId());
+
+                // the peer did not set up encryption: next time, connect in plaintext
+                if (pnode->m_encryption_pending) {
+                    LOCK(m_plaintext_mutex);
+                    if (m_plaintext_peers.size() >= MAX_PLAINTEXT_PEERS)
+                        m_plaintext_peers.clear();
+                    m_plaintext_peers.insert(pnode->addr);
+                    if (pnode->m_manual_connection)
+                        m_plaintext_reconnections.push_back(pnode->GetAddrName());
+                }
 
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
@@ -1051,7 +1245,12 @@ void CConnman::NotifyNumConnectionsChanged()
 void CConnman::InactivityCheck(CNode *pnode)
 {
     int64_t nTime = GetSystemTimeInSeconds();
-    if (nTime - pnode->nTimeConnected > m_peer_connect_timeout)
+    if (pnode->m_encryption_pending && nTime - pnode->nTimeConnected > ENCRYPTION_HANDSHAKE_TIMEOUT)
+    {
+        LogPrint(BCLog::NET, "encryption setup timeout from %d\n", pnode->GetId());
+        pnode->fDisconnect = true;
+    }
+    else if (nTime - pnode->nTimeConnected > m_peer_connect_timeout)
     {
         if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
         {
@@ -1081,16 +1280,26 @@ void CConnman::InactivityCheck(CNode *pnode)
     }
 }
 
-bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+bool CConnman::IsSocketThreadNode(const CNode* pnode, int thread) const
 {
-    for (const ListenSocket& hListenSocket : vhListenSocket) {
-        recv_set.insert(hListenSocket.socket);
+    return pnode->GetId() % m_socket_threads == thread;
+}
+
+bool CConnman::GenerateSelectSet(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    if (thread == 0) {
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            recv_set.insert(hListenSocket.socket);
+        }
     }
 
     {
         LOCK(cs_vNodes);
         for (CNode* pnode : vNodes)
         {
+            if (!IsSocketThreadNode(pnode, thread))
+                continue;
+
             // Implement the following logic:
             // * If there is data to send, select() for sending data. As this only
             //   happens when optimistic write failed, we choose to first drain the
@@ -1127,11 +1336,151 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
+#ifdef USE_EPOLL
+static void CloseEpollFds(std::vector<int>& epoll_fds)
+{
+    for (int epoll_fd : epoll_fds) {
+        close(epoll_fd);
+    }
+    epoll_fds.clear();
+}
+
+bool CConnman::InitEpoll()
+{
+    for (int i = 0; i < m_socket_threads; i++) {
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd == -1) {
+            LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(errno));
+            CloseEpollFds(m_epoll_fds);
+            return false;
+        }
+        m_epoll_fds.push_back(epoll_fd);
+    }
+    // Listen sockets only need to be registered once, with the thread that accepts
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = EPOLL_LISTEN_SOCKET | static_cast<uint64_t>(hListenSocket.socket);
+        if (epoll_ctl(m_epoll_fds[0], EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+            LogPrintf("epoll_ctl failed to add listening socket: %s\n", NetworkErrorString(errno));
+            CloseEpollFds(m_epoll_fds);
+            return false;
+        }
+    }
+    m_epoll_sweep_times.assign(m_socket_threads, 0);
+    return true;
+}
+#endif
+
+void CConnman::UpdateSocketEvents(CNode* pnode) const
+{
+#ifdef USE_EPOLL
+    if (m_socket_events_mode != SocketEventsMode::EPOLL || m_epoll_fds.empty())
+        return;
+    const int epoll_fd = m_epoll_fds[pnode->GetId() % m_socket_threads];
+
+    LOCK(pnode->cs_vSend);
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+
+    // Same interest as GenerateSelectSet. fPauseRecv is cleared by the message
+    // handler without these locks, so it is read again after each change: the
+    // message handler either sees the registration made here, or this loop
+    // sees its new value.
+    while (true) {
+        // EPOLLERR is always reported; it is set so that the mask of a
+        // registered socket is never zero.
+        uint32_t events = EPOLLERR;
+        if (!pnode->vSendMsg.empty()) {
+            events |= EPOLLOUT;
+        } else if (!pnode->fPauseRecv) {
+            events |= EPOLLIN;
+        }
+        const uint32_t registered = pnode->m_epoll_events;
+        if (events == registered)
+            return;
+
+        struct epoll_event event = {};
+        event.events = events;
+        event.data.u64 = pnode->GetId();
+        int op = registered == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        if (epoll_ctl(epoll_fd, op, pnode->hSocket, &event) != 0) {
+            LogPrint(BCLog::NET, "epoll_ctl failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(errno));
+            return;
+        }
+        pnode->m_epoll_events = events;
+    }
+#endif
+}
+
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*> &nodes)
+{
+    // Sockets stay registered between iterations, their interest is updated
+    // where it changes (see UpdateSocketEvents), and the kernel removes them
+    // when they are closed. Each event carries the id of its peer, so only the
+    // peers that are ready are looked up and serviced.
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(m_epoll_fds[thread], events, MAX_EPOLL_EVENTS, SELECT_TIMEOUT_MILLISECONDS);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    // Idle peers have no events, so once a second all peers of the thread are
+    // serviced to run their inactivity checks.
+    const int64_t now = GetSystemTimeInSeconds();
+    const bool sweep = m_epoll_sweep_times[thread] != now;
+
+    LOCK(cs_vNodes);
+    for (int i = 0; i < nEvents; i++) {
+        const uint64_t data = events[i].data.u64;
+        if (data & EPOLL_LISTEN_SOCKET) {
+            recv_set.insert(static_cast<SOCKET>(data & ~EPOLL_LISTEN_SOCKET));
+            continue;
+        }
+        auto it = m_nodes_by_id.find(static_cast<NodeId>(data));
+        if (it == m_nodes_by_id.end())
+            continue;
+        CNode* pnode = it->second;
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            if (events[i].events & EPOLLIN)               recv_set.insert(pnode->hSocket);
+            if (events[i].events & EPOLLOUT)              send_set.insert(pnode->hSocket);
+            if (events[i].events & (EPOLLERR|EPOLLHUP))   error_set.insert(pnode->hSocket);
+        }
+        if (!sweep) {
+            pnode->AddRef();
+            nodes.push_back(pnode);
+        }
+    }
+
+    if (sweep) {
+        m_epoll_sweep_times[thread] = now;
+        for (CNode* pnode : vNodes) {
+            if (IsSocketThreadNode(pnode, thread)) {
+                pnode->AddRef();
+                nodes.push_back(pnode);
+            }
+        }
+    }
+}
+#endif
+
 #ifdef USE_POLL
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEventsPoll(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(thread, recv_select_set, send_select_set, error_select_set)) {
         interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1170,10 +1519,10 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
     }
 }
 #else
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEventsSelect(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(thread, recv_select_set, send_select_set, error_select_set)) {
         interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1245,34 +1594,55 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
-void CConnman::SocketHandler()
+void CConnman::SocketEvents(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*> &nodes)
+{
+#ifdef USE_EPOLL
+    if (m_socket_events_mode == SocketEventsMode::EPOLL) {
+        SocketEventsEpoll(thread, recv_set, send_set, error_set, nodes);
+        return;
+    }
+#endif
+#ifdef USE_POLL
+    SocketEventsPoll(thread, recv_set, send_set, error_set);
+#else
+    SocketEventsSelect(thread, recv_set, send_set, error_set);
+#endif
+
+    if (interruptNet) return;
+
+    LOCK(cs_vNodes);
+    for (CNode* pnode : vNodes) {
+        if (IsSocketThreadNode(pnode, thread)) {
+            pnode->AddRef();
+            nodes.push_back(pnode);
+        }
+    }
+}
+
+void CConnman::SocketHandler(int thread)
 {
     std::set<SOCKET> recv_set, send_set, error_set;
-    SocketEvents(recv_set, send_set, error_set);
+    std::vector<CNode*> vNodesCopy;
+    SocketEvents(thread, recv_set, send_set, error_set, vNodesCopy);
 
     if (interruptNet) return;
 
     //
     // Accept new connections
     //
-    for (const ListenSocket& hListenSocket : vhListenSocket)
-    {
-        if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket) > 0)
+    if (thread == 0) {
+        for (const ListenSocket& hListenSocket : vhListenSocket)
         {
-            AcceptConnection(hListenSocket);
+            if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket) > 0)
+            {
+                AcceptConnection(hListenSocket);
+            }
         }
     }
 
     //
-    // Service each socket
+    // Service each socket of this thread
     //
-    std::vector<CNode*> vNodesCopy;
-    {
-        LOCK(cs_vNodes);
-        vNodesCopy = vNodes;
-        for (CNode* pnode : vNodesCopy)
-            pnode->AddRef();
-    }
     for (CNode* pnode : vNodesCopy)
     {
         if (interruptNet)
@@ -1309,6 +1679,10 @@ void CConnman::SocketHandler()
                 if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
                     pnode->CloseSocketDisconnect();
                 RecordBytesRecv(nBytes);
+                // Before the peer's version message is processed and
+                // anything can be sent in answer to it
+                if (pnode->m_next_serializer)
+                    FinishEncryptionSetup(pnode);
                 if (notify) {
                     size_t nSizeAdded = 0;
                     auto it(pnode->vRecvMsg.begin());
@@ -1323,6 +1697,7 @@ void CConnman::SocketHandler()
                         pnode->nProcessQueueSize += nSizeAdded;
                         pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
                     }
+                    UpdateSocketEvents(pnode);
                     WakeMessageHandler();
                 }
             }
@@ -1368,13 +1743,17 @@ void CConnman::SocketHandler()
     }
 }
 
-void CConnman::ThreadSocketHandler()
+void CConnman::ThreadSocketHandler(int thread)
 {
     while (!interruptNet)
     {
-        DisconnectNodes();
-        NotifyNumConnectionsChanged();
-        SocketHandler();
+        // Nodes are deleted by a single thread; the others only hold
+        // references to them while servicing their sockets.
+        if (thread == 0) {
+            DisconnectNodes();
+            NotifyNumConnectionsChanged();
+        }
+        SocketHandler(thread);
     }
 }
 
@@ -1382,9 +1761,9 @@ void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        nMsgProcWakeCount++;
     }
-    condMsgProc.notify_one();
+    condMsgProc.notify_all();
 }
 
 
@@ -1896,9 +2275,14 @@ void CConnman::ThreadOpenAddedConnections()
                     return;
             }
         }
-        // Retry every 60 seconds if a connection was attempted, otherwise two seconds
-        if (!interruptNet.sleep_for(std::chrono::seconds(tried ? 60 : 2)))
-            return;
+        // Retry every 60 seconds if a connection was attempted, otherwise two
+        // seconds; connections that did not set up encryption are retried in
+        // plaintext every two seconds.
+        for (int i = 0; i < (tried ? 30 : 1); ++i) {
+            if (!interruptNet.sleep_for(std::chrono::seconds(2)))
+                return;
+            OpenPlaintextReconnections();
+        }
     }
 }
 
@@ -1935,22 +2319,35 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     if (manual_connection)
         pnode->m_manual_connection = true;
 
+    bool encrypt = m_p2p_encryption;
+    if (encrypt) {
+        LOCK(m_plaintext_mutex);
+        encrypt = m_plaintext_peers.count(pnode->addr) == 0;
+    }
+    if (encrypt)
+        SendEncryptionKey(pnode);
     m_msgproc->InitializeNode(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        m_nodes_by_id.emplace(pnode->GetId(), pnode);
     }
+    UpdateSocketEvents(pnode);
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int thread)
 {
+    uint64_t last_wake_count = 0;
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy) {
+            for (CNode* pnode : vNodes) {
+                // Each peer belongs to exactly one thread, which keeps the
+                // processing of its messages sequential.
+                if (pnode->GetId() % m_msg_handler_threads != thread) continue;
+                vNodesCopy.push_back(pnode);
                 pnode->AddRef();
             }
         }
@@ -1967,6 +2364,11 @@ void CConnman::ThreadMessageHandler()
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
             if (flagInterruptMsgProc)
                 return;
+#ifdef USE_EPOLL
+            // Receiving resumes once processing made room in the queue
+            if (!pnode->fPauseRecv && (pnode->m_epoll_events & (EPOLLIN|EPOLLOUT)) == 0)
+                UpdateSocketEvents(pnode);
+#endif
             // Send messages
             {
                 LOCK(pnode->cs_sendProcessing);
@@ -1985,9 +2387,9 @@ void CConnman::ThreadMessageHandler()
 
         WAIT_LOCK(mutexMsgProc, lock);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, last_wake_count]() EXCLUSIVE_LOCKS_REQUIRED(mutexMsgProc) { return nMsgProcWakeCount != last_wake_count; });
         }
-        fMsgProcWake = false;
+        last_wake_count = nMsgProcWakeCount;
     }
 }
 
@@ -2198,6 +2600,13 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (m_socket_events_mode == SocketEventsMode::EPOLL && !InitEpoll()) {
+        LogPrintf("Falling back to -socketevents=%s\n", SocketEventsModeToString(SocketEventsMode::POLL));
+        m_socket_events_mode = SocketEventsMode::POLL;
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2241,11 +2650,16 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = false;
+        nMsgProcWakeCount = 0;
     }
 
     // Send and receive from sockets, accept connections
-    threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
+    for (int i = 0; i < m_socket_threads; i++) {
+        const std::string name = i == 0 ? "net" : strprintf("net.%d", i);
+        threadSocketHandlers.emplace_back([this, i, name] {
+            TraceThread(name.c_str(), std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this, i)));
+        });
+    }
 
     if (!gArgs.GetBoolArg("-dnsseed", true))
         LogPrintf("DNS seeding disabled\n");
@@ -2267,7 +2681,12 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < m_msg_handler_threads; i++) {
+        const std::string name = i == 0 ? "msghand" : strprintf("msghand.%d", i);
+        threadMessageHandlers.emplace_back([this, i, name] {
+            TraceThread(name.c_str(), std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
+        });
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpAddresses, this), DUMP_PEERS_INTERVAL * 1000);
@@ -2316,16 +2735,22 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& thread : threadMessageHandlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
         threadOpenAddedConnections.join();
     if (threadDNSAddressSeed.joinable())
         threadDNSAddressSeed.join();
-    if (threadSocketHandler.joinable())
-        threadSocketHandler.join();
+    for (std::thread& thread : threadSocketHandlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadSocketHandlers.clear();
 
     if (fAddressesInitialized)
     {
@@ -2340,6 +2765,9 @@ void CConnman::Stop()
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+    CloseEpollFds(m_epoll_fds);
+#endif
 
     // clean up some globals (to help leak detection)
     for (CNode *pnode : vNodes) {
@@ -2349,6 +2777,7 @@ void CConnman::Stop()
         DeleteNode(pnode);
     }
     vNodes.clear();
+    m_nodes_by_id.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
     semOutbound.reset();
@@ -2630,6 +3059,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     hashContinue = uint256();
     filterInventoryKnown.reset();
     pfilter = MakeUnique<CBloomFilter>();
+    m_deserializer = MakeUnique<V1TransportDeserializer>();
 
     for (const std::string &msg : getAllNetMessageTypes())
         mapRecvBytesPerMsgCmd[msg] = 0;
@@ -2652,23 +3082,128 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
+void V1TransportSerializer::PrepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header)
+{
+    uint256 hash = Hash(msg.data.data(), msg.data.data() + msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, header, 0, hdr};
+}
+
+void EncryptedTransportSerializer::PrepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header)
+{
+    header.clear();
+    const size_t prefix_size = CHACHA20_POLY1305_AEAD_AAD_LEN + 1 + msg.command.size();
+    const size_t length = 1 + msg.command.size() + msg.data.size();
+    assert(msg.command.size() <= CMessageHeader::COMMAND_SIZE && length < (1 << 24));
+
+    std::vector<unsigned char> frame = g_net_send_buffers.Take(prefix_size + msg.data.size() + POLY1305_TAGLEN);
+    frame.resize(prefix_size + msg.data.size() + POLY1305_TAGLEN);
+    frame[0] = length & 0xff;
+    frame[1] = (length >> 8) & 0xff;
+    frame[2] = (length >> 16) & 0xff;
+    frame[CHACHA20_POLY1305_AEAD_AAD_LEN] = msg.command.size();
+    memcpy(frame.data() + CHACHA20_POLY1305_AEAD_AAD_LEN + 1, msg.command.data(), msg.command.size());
+    if (!msg.data.empty()) {
+        memcpy(frame.data() + prefix_size, msg.data.data(), msg.data.size());
+    }
+    bool ret = m_aead.Crypt(m_seqnr++, frame.data(), frame.size(), frame.data(), frame.size() - POLY1305_TAGLEN, /* is_encrypt */ true);
+    assert(ret);
+    g_net_send_buffers.Give(std::move(msg.data));
+    msg.data = std::move(frame);
+}
+
+int EncryptedTransportDeserializer::Read(CNetMessage& msg, const char* pch, unsigned int nBytes)
+{
+    // First the encrypted length, then the rest of the message
+    const size_t target = m_frame_size > 0 ? m_frame_size : CHACHA20_POLY1305_AEAD_AAD_LEN;
+    const unsigned int nCopy = std::min<size_t>(target - m_frame.size(), nBytes);
+    m_frame.insert(m_frame.end(), pch, pch + nCopy);
+    if (m_frame.size() < target)
+        return nCopy;
+
+    if (m_frame_size == 0) {
+        const uint32_t length = m_aead.GetLength(m_seqnr, (const unsigned char*)m_frame.data());
+        if (length < 2 || length > 1 + CMessageHeader::COMMAND_SIZE + MAX_PROTOCOL_MESSAGE_LENGTH)
+            return -1;
+        m_frame_size = CHACHA20_POLY1305_AEAD_AAD_LEN + length + POLY1305_TAGLEN;
+        CSerializeData buf = g_net_recv_buffers.Take(std::min<size_t>(m_frame_size, 256 * 1024));
+        buf.assign(m_frame.begin(), m_frame.end());
+        m_frame.swap(buf);
+        g_net_recv_buffers.Give(std::move(buf));
+        return nCopy;
+    }
+
+    unsigned char* frame = (unsigned char*)m_frame.data();
+    if (!m_aead.Crypt(m_seqnr++, frame, m_frame.size() - POLY1305_TAGLEN, frame, m_frame.size(), /* is_encrypt */ false))
+        return -1;
+    m_frame.resize(m_frame.size() - POLY1305_TAGLEN);
+    const size_t command_size = frame[CHACHA20_POLY1305_AEAD_AAD_LEN];
+    const size_t prefix_size = CHACHA20_POLY1305_AEAD_AAD_LEN + 1 + command_size;
+    if (command_size == 0 || command_size > CMessageHeader::COMMAND_SIZE || prefix_size > m_frame.size())
+        return -1;
+
+    memset(msg.hdr.pchCommand, 0, sizeof(msg.hdr.pchCommand));
+    memcpy(msg.hdr.pchCommand, frame + CHACHA20_POLY1305_AEAD_AAD_LEN + 1, command_size);
+    msg.hdr.nMessageSize = m_frame.size() - prefix_size;
+    msg.vRecv.SwapStorage(m_frame);
+    msg.vRecv.ignore(prefix_size);
+    msg.nDataPos = msg.hdr.nMessageSize;
+    msg.in_data = true;
+    msg.m_authenticated = true;
+    m_frame.clear();
+    m_frame_size = 0;
+    return nCopy;
+}
+
+CFramedNetMsg::CFramedNetMsg(CSerializedNetMsg&& msg)
+{
+    V1TransportSerializer().PrepareForTransport(msg, header);
+    data = std::move(msg.data);
+    command = std::move(msg.command);
+}
+
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
+    std::vector<unsigned char> serializedHeader = g_net_send_buffers.Take(CMessageHeader::HEADER_SIZE);
+    // Plaintext framing does not depend on the messages sent before, so the
+    // checksum is computed before taking cs_vSend.
+    if (!pnode->m_encrypted && !pnode->m_encryption_pending)
+        V1TransportSerializer().PrepareForTransport(msg, serializedHeader);
+    QueueMessage(pnode, std::move(msg), std::move(serializedHeader));
+}
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
-    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+void CConnman::PushMessage(CNode* pnode, const CFramedNetMsg& msg)
+{
+    CSerializedNetMsg copy;
+    copy.command = msg.command;
+    copy.data = g_net_send_buffers.Take(msg.data.size());
+    copy.data.assign(msg.data.begin(), msg.data.end());
+    std::vector<unsigned char> header = g_net_send_buffers.Take(msg.header.size());
+    if (!pnode->m_encrypted && !pnode->m_encryption_pending)
+        header.assign(msg.header.begin(), msg.header.end());
+    QueueMessage(pnode, std::move(copy), std::move(header));
+}
 
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+void CConnman::QueueMessage(CNode* pnode, CSerializedNetMsg&& msg, std::vector<unsigned char>&& header)
+{
+    size_t nMessageSize = msg.data.size();
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
 
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
+        if (pnode->m_encryption_pending) {
+            // Framed once encryption is set up, if it is
+            pnode->m_held_msgs.push_back(std::move(msg));
+            g_net_send_buffers.Give(std::move(header));
+            return;
+        }
+        // Encrypted messages are framed in the order they are sent in.
+        if (pnode->m_serializer)
+            pnode->m_serializer->PrepareForTransport(msg, header);
+        size_t nTotalSize = header.size() + msg.data.size();
         bool optimisticSend(pnode->vSendMsg.empty());
 
         //log total amount of bytes per command
@@ -2677,8 +3212,11 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
+        if (!header.empty())
+            pnode->vSendMsg.push_back(std::move(header));
+        else
+            g_net_send_buffers.Give(std::move(header));
+        if (!msg.data.empty())
             pnode->vSendMsg.push_back(std::move(msg.data));
 
         // If write queue empty, attempt "optimistic write"
@@ -2689,6 +3227,72 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         RecordBytesSent(nBytesSent);
 }
 
+void CConnman::SendEncryptionKey(CNode* pnode)
+{
+    pnode->m_encryption_key = MakeEncryptionKey();
+    pnode->m_key_exchange = CNode::KeyExchange::AWAIT_KEY;
+    const CPubKey pubkey = pnode->m_encryption_key.GetPubKey();
+    std::vector<unsigned char> key = g_net_send_buffers.Take(ENCRYPTION_KEY_SIZE);
+    key.assign(pubkey.begin() + 1, pubkey.end());
+
+    size_t nBytesSent = 0;
+    {
+        LOCK(pnode->cs_vSend);
+        pnode->m_encryption_pending = true;
+        pnode->nSendSize += key.size();
+        pnode->vSendMsg.push_back(std::move(key));
+        nBytesSent = SocketSendData(pnode);
+    }
+    if (nBytesSent)
+        RecordBytesSent(nBytesSent);
+}
+
+void CConnman::FinishEncryptionSetup(CNode* pnode)
+{
+    size_t nBytesSent = 0;
+    {
+        LOCK(pnode->cs_vSend);
+        if (!pnode->m_encryption_pending) {
+            // We answer the peer with our key
+            const CPubKey pubkey = pnode->m_encryption_key.GetPubKey();
+            std::vector<unsigned char> key = g_net_send_buffers.Take(ENCRYPTION_KEY_SIZE);
+            key.assign(pubkey.begin() + 1, pubkey.end());
+            pnode->nSendSize += key.size();
+            pnode->vSendMsg.push_back(std::move(key));
+        }
+        pnode->m_serializer = std::move(pnode->m_next_serializer);
+        pnode->m_encrypted = true;
+        pnode->m_encryption_pending = false;
+        pnode->m_encryption_key = CKey();
+        for (CSerializedNetMsg& msg : pnode->m_held_msgs) {
+            std::vector<unsigned char> header;
+            pnode->m_serializer->PrepareForTransport(msg, header);
+            pnode->mapSendBytesPerMsgCmd[msg.command] += msg.data.size();
+            pnode->nSendSize += msg.data.size();
+            pnode->vSendMsg.push_back(std::move(msg.data));
+        }
+        pnode->m_held_msgs.clear();
+        pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+        nBytesSent = SocketSendData(pnode);
+    }
+    if (nBytesSent)
+        RecordBytesSent(nBytesSent);
+    LogPrint(BCLog::NET, "encrypted connection to peer=%d\n", pnode->GetId());
+}
+
+void CConnman::OpenPlaintextReconnections()
+{
+    std::vector<std::string> reconnections;
+    {
+        LOCK(m_plaintext_mutex);
+        reconnections.swap(m_plaintext_reconnections);
+    }
+    for (const std::string& dest : reconnections) {
+        // Like addnode onetry, without a grant
+        OpenNetworkConnection(CAddress(CService(), NODE_NONE), false, nullptr, dest.c_str(), false, false, true);
+    }
+}
+
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
 {
     CNode* found = nullptr;
@@ -11,10 +11,13 @@
 #include <amount.h>
 #include <bloom.h>
 #include <compat.h>
+#include <crypto/chacha_poly_aead.h>
 #include <crypto/siphash.h>
 #include <hash.h>
+#include <key.h>
 #include <limitedmap.h>
 #include <netaddress.h>
+#include <netbufferpool.h>
 #include <policy/feerate.h>
 #include <protocol.h>
 #include <random.h>
@@ -28,6 +31,7 @@
 #include <stdint.h>
 #include <thread>
 #include <memory>
+#include <unordered_map>
 #include <condition_variable>
 
 #ifndef WIN32
@@ -81,6 +85,45 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -p2pencryption default */
+static const bool DEFAULT_P2P_ENCRYPTION = false;
+/** Seconds to wait for a peer's key before retrying the connection in plaintext */
+static const int64_t ENCRYPTION_HANDSHAKE_TIMEOUT = 10;
+/** Size of the (x-only) public keys exchanged to set up encryption */
+static const size_t ENCRYPTION_KEY_SIZE = 32;
+/** Peers remembered to not set up encryption */
+static const size_t MAX_PLAINTEXT_PEERS = 1000;
+
+/** How the socket handler thread waits for sockets to become ready */
+enum class SocketEventsMode {
+    SELECT, //!< select(), only where poll() is not usable
+    POLL,   //!< poll() on all sockets every iteration
+    EPOLL,  //!< epoll with registrations that persist between iterations (Linux)
+};
+
+/** -netthreads default */
+static const int DEFAULT_NET_THREADS = 1;
+/** Maximum number of socket handler threads */
+static const int MAX_NET_THREADS = 16;
+/** -msghandlerthreads default */
+static const int DEFAULT_MSG_HANDLER_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSG_HANDLER_THREADS = 16;
+
+/** -socketevents default */
+#if defined(USE_EPOLL)
+static const SocketEventsMode DEFAULT_SOCKET_EVENTS_MODE = SocketEventsMode::EPOLL;
+#elif defined(USE_POLL)
+static const SocketEventsMode DEFAULT_SOCKET_EVENTS_MODE = SocketEventsMode::POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKET_EVENTS_MODE = SocketEventsMode::SELECT;
+#endif
+
+/** Parse a -socketevents value. Only modes supported by this build are accepted. */
+bool SocketEventsModeFromString(const std::string& str, SocketEventsMode& mode);
+std::string SocketEventsModeToString(SocketEventsMode mode);
+/** Comma separated list of the -socketevents values supported by this build */
+std::string GetSupportedSocketEventsModes();
 
 typedef int64_t NodeId;
 
@@ -95,6 +138,11 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/** Storage of outgoing message payloads and headers */
+extern NetBufferPool<std::vector<unsigned char>> g_net_send_buffers;
+/** Storage of incoming message headers and payloads */
+extern NetBufferPool<CSerializeData> g_net_recv_buffers;
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -108,6 +156,51 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/** Turns messages into the bytes sent to a peer. */
+class TransportSerializer
+{
+public:
+    virtual ~TransportSerializer() {}
+    /** Make the header that is sent before the data of msg, and change its data in place if needed. */
+    virtual void PrepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) = 0;
+};
+
+/** Plaintext messages: a CMessageHeader with a double-SHA256 checksum of the data. */
+class V1TransportSerializer : public TransportSerializer
+{
+public:
+    void PrepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) override;
+};
+
+/**
+ * Encrypted messages (see ChaCha20Poly1305AEAD): the 3-byte length of the
+ * rest, a 1-byte command length, the command, the data, and a 16-byte tag.
+ * It all goes in the data; there is no separate header.
+ */
+class EncryptedTransportSerializer : public TransportSerializer
+{
+private:
+    ChaCha20Poly1305AEAD m_aead;
+    uint64_t m_seqnr{0};
+
+public:
+    EncryptedTransportSerializer(const unsigned char* K_1, const unsigned char* K_2) : m_aead(K_1, CHACHA20_POLY1305_AEAD_KEY_LEN, K_2, CHACHA20_POLY1305_AEAD_KEY_LEN) {}
+    void PrepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) override;
+};
+
+/**
+ * A message serialized and given its header once, to be sent to several
+ * peers without serializing and hashing it again for each of them.
+ */
+struct CFramedNetMsg
+{
+    explicit CFramedNetMsg(CSerializedNetMsg&& msg);
+
+    std::vector<unsigned char> header;
+    std::vector<unsigned char> data;
+    std::string command;
+};
+
 
 class NetEventsInterface;
 class CConnman
@@ -137,10 +230,14 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        SocketEventsMode m_socket_events_mode = DEFAULT_SOCKET_EVENTS_MODE;
+        int m_socket_threads = DEFAULT_NET_THREADS;
+        int m_msg_handler_threads = DEFAULT_MSG_HANDLER_THREADS;
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
         std::vector<CService> vBinds, vWhiteBinds;
         bool m_use_addrman_outgoing = true;
+        bool m_p2p_encryption = DEFAULT_P2P_ENCRYPTION;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
     };
@@ -150,6 +247,7 @@ public:
         nMaxConnections = connOptions.nMaxConnections;
         nMaxOutbound = std::min(connOptions.nMaxOutbound, connOptions.nMaxConnections);
         m_use_addrman_outgoing = connOptions.m_use_addrman_outgoing;
+        m_p2p_encryption = connOptions.m_p2p_encryption;
         nMaxAddnode = connOptions.nMaxAddnode;
         nMaxFeeler = connOptions.nMaxFeeler;
         nBestHeight = connOptions.nBestHeight;
@@ -159,6 +257,9 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_socket_events_mode = connOptions.m_socket_events_mode;
+        m_socket_threads = std::max(1, std::min(connOptions.m_socket_threads, MAX_NET_THREADS));
+        m_msg_handler_threads = std::max(1, std::min(connOptions.m_msg_handler_threads, MAX_MSG_HANDLER_THREADS));
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -196,6 +297,8 @@ public:
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    //! Send a copy of a message that was framed once for several peers
+    void PushMessage(CNode* pnode, const CFramedNetMsg& msg);
 
     template<typename Callable>
     void ForEachNode(Callable&& func)
@@ -327,15 +430,29 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int thread);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
-    bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
-    void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
-    void SocketHandler();
-    void ThreadSocketHandler();
+    /** Whether pnode's sockets are serviced by the given socket handler thread */
+    bool IsSocketThreadNode(const CNode* pnode, int thread) const;
+    bool GenerateSelectSet(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_EPOLL
+    bool InitEpoll();
+    void SocketEventsEpoll(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*> &nodes);
+#endif
+#ifdef USE_POLL
+    void SocketEventsPoll(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#else
+    void SocketEventsSelect(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+    /** Wait for socket events, and fill nodes with the peers to service, each with a reference held */
+    void SocketEvents(int thread, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*> &nodes);
+    /** Register the socket events pnode waits for with epoll, if they changed */
+    void UpdateSocketEvents(CNode* pnode) const;
+    void SocketHandler(int thread);
+    void ThreadSocketHandler(int thread);
     void ThreadDNSAddressSeed();
 
     uint64_t CalculateKeyedNetGroup(const CAddress& ad) const;
@@ -354,6 +471,13 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode) const;
+    void QueueMessage(CNode* pnode, CSerializedNetMsg&& msg, std::vector<unsigned char>&& header);
+    //! Start setting up encryption with a peer we connected to, and hold back messages until it answers
+    void SendEncryptionKey(CNode* pnode);
+    //! Once ReceiveMsgBytes has the peer's key: send ours if we did not yet, and encrypt everything from then on
+    void FinishEncryptionSetup(CNode* pnode);
+    //! Retry plaintext for the manual connections to peers that did not set up encryption
+    void OpenPlaintextReconnections();
     void DumpAddresses();
 
     // Network stats
@@ -386,6 +510,31 @@ private:
     unsigned int nReceiveFloodSize{0};
 
     std::vector<ListenSocket> vhListenSocket;
+    SocketEventsMode m_socket_events_mode{DEFAULT_SOCKET_EVENTS_MODE};
+    /**
+     * Number of socket handler threads. Peers are assigned to a thread by
+     * id; thread 0 also accepts connections and disconnects peers.
+     */
+    int m_socket_threads{DEFAULT_NET_THREADS};
+    /**
+     * Number of message handler threads. Like socket handler threads, each
+     * owns the peers whose id maps to it, so a peer's messages are still
+     * processed in order by a single thread.
+     */
+    int m_msg_handler_threads{DEFAULT_MSG_HANDLER_THREADS};
+    //! Whether to set up encrypted connections with peers that support them
+    bool m_p2p_encryption{DEFAULT_P2P_ENCRYPTION};
+    Mutex m_plaintext_mutex;
+    //! Peers that did not answer our encryption setup, to connect to in plaintext from now on
+    std::set<CService> m_plaintext_peers GUARDED_BY(m_plaintext_mutex);
+    //! Manual connections to retry in plaintext
+    std::vector<std::string> m_plaintext_reconnections GUARDED_BY(m_plaintext_mutex);
+#ifdef USE_EPOLL
+    //! Per socket handler thread, the epoll instance its sockets are registered with in SocketEventsMode::EPOLL
+    std::vector<int> m_epoll_fds;
+    //! Per socket handler thread, the second in which all its peers were last serviced in SocketEventsMode::EPOLL
+    std::vector<int64_t> m_epoll_sweep_times;
+#endif
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
     CAddrMan addrman;
@@ -394,6 +543,8 @@ private:
     std::vector<std::string> vAddedNodes GUARDED_BY(cs_vAddedNodes);
     CCriticalSection cs_vAddedNodes;
     std::vector<CNode*> vNodes GUARDED_BY(cs_vNodes);
+    //! The nodes of vNodes by id, to find the peers of epoll events
+    std::unordered_map<NodeId, CNode*> m_nodes_by_id GUARDED_BY(cs_vNodes);
     std::list<CNode*> vNodesDisconnected;
     mutable CCriticalSection cs_vNodes;
     std::atomic<NodeId> nLastNodeId{0};
@@ -417,8 +568,8 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** Bumped to wake the message processors. Each thread remembers the last value it has seen. */
+    uint64_t nMsgProcWakeCount GUARDED_BY(mutexMsgProc){0};
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
@@ -427,10 +578,10 @@ private:
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
-    std::thread threadSocketHandler;
+    std::vector<std::thread> threadSocketHandlers;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
@@ -550,6 +701,7 @@ public:
     std::string cleanSubVer;
     bool fInbound;
     bool m_manual_connection;
+    bool m_encrypted;
     int nStartingHeight;
     uint64_t nSendBytes;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -577,6 +729,7 @@ private:
     mutable uint256 data_hash;
 public:
     bool in_data;                   // parsing header (false) or data (true)
+    bool m_authenticated{false};    // authenticated by an encrypted transport, so there is no checksum to check
 
     CDataStream hdrbuf;             // partially received header
     CMessageHeader hdr;             // complete header
@@ -587,13 +740,13 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
-        in_data = false;
-        nHdrPos = 0;
-        nDataPos = 0;
-        nTime = 0;
-    }
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn);
+    //! Gives the buffers back to g_net_recv_buffers
+    ~CNetMessage();
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+    CNetMessage(const CNetMessage&) = delete;
+    CNetMessage& operator=(const CNetMessage&) = delete;
 
     bool complete() const
     {
@@ -614,6 +767,41 @@ public:
     int readData(const char *pch, unsigned int nBytes);
 };
 
+/** Turns the bytes received from a peer into messages. */
+class TransportDeserializer
+{
+public:
+    virtual ~TransportDeserializer() {}
+    /**
+     * Read bytes into msg, a new or incomplete message. Returns the number
+     * of bytes used, or -1 if they are not a valid message.
+     */
+    virtual int Read(CNetMessage& msg, const char* pch, unsigned int nBytes) = 0;
+};
+
+class V1TransportDeserializer : public TransportDeserializer
+{
+public:
+    int Read(CNetMessage& msg, const char* pch, unsigned int nBytes) override
+    {
+        return msg.in_data ? msg.readData(pch, nBytes) : msg.readHeader(pch, nBytes);
+    }
+};
+
+/** Reads the messages of an EncryptedTransportSerializer. */
+class EncryptedTransportDeserializer : public TransportDeserializer
+{
+private:
+    ChaCha20Poly1305AEAD m_aead;
+    uint64_t m_seqnr{0};
+    CSerializeData m_frame;     // the encrypted message being received
+    uint32_t m_frame_size{0};   // its total size, once its length has been decrypted
+
+public:
+    EncryptedTransportDeserializer(const unsigned char* K_1, const unsigned char* K_2) : m_aead(K_1, CHACHA20_POLY1305_AEAD_KEY_LEN, K_2, CHACHA20_POLY1305_AEAD_KEY_LEN) {}
+    int Read(CNetMessage& msg, const char* pch, unsigned int nBytes) override;
+};
+
 
 /** Information about a peer */
 class CNode
@@ -682,6 +870,10 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv{false};
     std::atomic_bool fPauseSend{false};
+    //! Whether messages are sent and received encrypted
+    std::atomic_bool m_encrypted{false};
+    //! Whether we sent our key to the peer and hold back messages until we have its key
+    std::atomic_bool m_encryption_pending{false};
 
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -692,8 +884,10 @@ public:
     std::atomic<int> nStartingHeight{-1};
 
     // flood relay
-    std::vector<CAddress> vAddrToSend;
-    CRollingBloomFilter addrKnown;
+    // Other peers' message handler threads push relayed addresses here.
+    std::vector<CAddress> vAddrToSend GUARDED_BY(cs_vAddrToSend);
+    CRollingBloomFilter addrKnown GUARDED_BY(cs_vAddrToSend);
+    CCriticalSection cs_vAddrToSend;
     bool fGetAddr{false};
     std::set<uint256> setKnown;
     int64_t nNextAddrSend GUARDED_BY(cs_sendProcessing){0};
@@ -701,9 +895,6 @@ public:
 
     // inventory based relay
     CRollingBloomFilter filterInventoryKnown GUARDED_BY(cs_inventory);
-    // Set of transaction ids we still have to announce.
-    // They are sorted by the mempool before relay, so the order is not important.
-    std::set<uint256> setInventoryTxToSend;
     // List of block ids we still have announce.
     // There is no final sorting before sending, as they are always sent immediately
     // and in the order requested.
@@ -753,7 +944,42 @@ private:
     const ServiceFlags nLocalServices;
     const int nMyStartingHeight;
     int nSendVersion{0};
-    std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
+    std::list<CNetMessage> vRecvMsg;  // Used only by this node's SocketHandler thread
+
+    /**
+     * Setting up encryption. There are no messages for it: the connecting
+     * side sends the x coordinate of an ephemeral public key, and nothing
+     * else until the other side has answered with its own. Both are 32
+     * bytes that look random, and everything after them is encrypted.
+     */
+    enum class KeyExchange {
+        NONE,      //!< Not (or no longer) setting up encryption
+        DETECT,    //!< Inbound: the peer's first bytes are either a network magic (plaintext) or its key
+        AWAIT_KEY, //!< Outbound: we sent our key and wait for the peer's
+    };
+
+    // Framing of messages, and setting up encryption. The deserializer, key
+    // and key exchange state are used only by this node's SocketHandler thread.
+    std::unique_ptr<TransportDeserializer> m_deserializer;
+    //! Replaces the plaintext framing of sent messages once encryption is set up
+    std::unique_ptr<TransportSerializer> m_serializer GUARDED_BY(cs_vSend);
+    //! Replaces m_serializer once we have the peer's key (see CConnman::FinishEncryptionSetup)
+    std::unique_ptr<TransportSerializer> m_next_serializer;
+    //! Messages held back while m_encryption_pending
+    std::vector<CSerializedNetMsg> m_held_msgs GUARDED_BY(cs_vSend);
+    //! Our ephemeral key, while encryption is being set up
+    CKey m_encryption_key;
+    KeyExchange m_key_exchange{KeyExchange::NONE};
+    //! Bytes of the peer's key (or network magic) received so far
+    std::vector<unsigned char> m_key_exchange_buf;
+
+    //! Read the peer's key from pch; returns the number of bytes used, or -1 if the peer should be disconnected
+    int ReceiveEncryptionKey(const char* pch, unsigned int nBytes);
+    //! Read messages from pch, with the framing set up
+    bool ReceiveMsgFrames(const char* pch, unsigned int nBytes, int64_t nTimeMicros, bool& complete) EXCLUSIVE_LOCKS_REQUIRED(cs_vRecv);
+#ifdef USE_EPOLL
+    std::atomic<uint32_t> m_epoll_events{0};  // Events registered with epoll, 0 if none. Changed under cs_vSend and cs_hSocket
+#endif
 
     mutable CCriticalSection cs_addrName;
     std::string addrName GUARDED_BY(cs_addrName);
@@ -813,11 +1039,13 @@ public:
 
     void AddAddressKnown(const CAddress& _addr)
     {
+        LOCK(cs_vAddrToSend);
         addrKnown.insert(_addr.GetKey());
     }
 
     void PushAddress(const CAddress& _addr, FastRandomContext &insecure_rand)
     {
+        LOCK(cs_vAddrToSend);
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
@@ -839,14 +1067,11 @@ public:
         }
     }
 
+    //! Queue a block to be announced. Transactions are announced to all peers at once, see RelayTransaction().
     void PushInventory(const CInv& inv)
     {
         LOCK(cs_inventory);
-        if (inv.type == MSG_TX) {
-            if (!filterInventoryKnown.contains(inv.hash)) {
-                setInventoryTxToSend.insert(inv.hash);
-            }
-        } else if (inv.type == MSG_BLOCK) {
+        if (inv.type == MSG_BLOCK) {
             vInventoryBlockToSend.push_back(inv.hash);
         }
     }
@@ -16,6 +16,9 @@
 #include <merkleblock.h>
 #include <netmessagemaker.h>
 #include <netbase.h>
+#include <node/relaycache.h>
+#include <node/txannouncequeue.h>
+#include <node/txreconciliation.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
@@ -116,13 +119,23 @@ namespace {
     /** Number of nodes with fSyncStarted. */
     int nSyncStarted GUARDED_BY(cs_main) = 0;
 
+    /** Where and when a block was received from, see mapBlockSource. */
+    struct BlockSource {
+        NodeId node;
+        //! Whether the node should be punished if the block is invalid
+        bool punish;
+        //! Time (in microseconds) the message that completed the block was received
+        int64_t time_received;
+    };
+
     /**
      * Sources of received blocks, saved to be able to send them reject
-     * messages or ban them when processing happens afterwards.
-     * Set mapBlockSource[hash].second to false if the node should not be
+     * messages or ban them when processing happens afterwards, and to
+     * measure how long relaying them takes.
+     * Set mapBlockSource[hash].punish to false if the node should not be
      * punished if the block is invalid.
      */
-    std::map<uint256, std::pair<NodeId, bool>> mapBlockSource GUARDED_BY(cs_main);
+    std::map<uint256, BlockSource> mapBlockSource GUARDED_BY(cs_main);
 
     /**
      * Filter for transactions that were recently rejected by
@@ -170,11 +183,11 @@ namespace {
     /** When our tip was last updated. */
     std::atomic<int64_t> g_last_tip_update(0);
 
-    /** Relay map */
-    typedef std::map<uint256, CTransactionRef> MapRelay;
-    MapRelay mapRelay GUARDED_BY(cs_main);
-    /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
-    std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
+    /** Transactions to announce, shared by all peers. Each peer's position is in CNodeState. */
+    TxAnnouncementQueue g_tx_announcements(mempool);
+
+    /** Transactions announced to peers, to answer their getdata requests from. */
+    RelayCache g_relay_cache;
 
     struct IteratorComparator
     {
@@ -351,6 +364,14 @@ struct CNodeState {
 
     TxDownloadState m_tx_download;
 
+    //! Position in g_tx_announcements up to which transactions were considered for announcement
+    uint64_t m_tx_announcement_cursor;
+
+    //! Salt we sent in sendrecon, or 0 if we did not offer reconciliation
+    uint64_t m_recon_salt{0};
+    //! Transaction relay by set reconciliation, if both sides offered it
+    std::unique_ptr<TxReconciliationState> m_tx_reconciliation;
+
     CNodeState(CAddress addrIn, std::string addrNameIn) : address(addrIn), name(addrNameIn) {
         fCurrentlyConnected = false;
         nMisbehavior = 0;
@@ -375,6 +396,7 @@ struct CNodeState {
         fSupportsDesiredCmpctVersion = false;
         m_chain_sync = { 0, nullptr, false, false };
         m_last_block_announcement = 0;
+        m_tx_announcement_cursor = g_tx_announcements.End();
     }
 };
 
@@ -800,6 +822,7 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->nHeight);
     }
+    stats.m_tx_reconciliation = state->m_tx_reconciliation != nullptr;
     return true;
 }
 
@@ -1038,6 +1061,8 @@ void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pb
 static CCriticalSection cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
+//! most_recent_compact_block serialized with witnesses, as it is sent to peers
+static std::shared_ptr<const CFramedNetMsg> most_recent_compact_block_msg GUARDED_BY(cs_most_recent_block);
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
 
@@ -1059,18 +1084,23 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
     bool fWitnessEnabled = IsWitnessEnabled(pindex->pprev, Params().GetConsensus());
     uint256 hashBlock(pblock->GetHash());
 
+    // Serialized once, for all high-bandwidth peers it is announced to here
+    // and the ones that are sent it later from SendMessages.
+    std::shared_ptr<const CFramedNetMsg> pcmpctblock_msg = std::make_shared<const CFramedNetMsg>(msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+
     {
         LOCK(cs_most_recent_block);
         most_recent_block_hash = hashBlock;
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
+        most_recent_compact_block_msg = pcmpctblock_msg;
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    const auto source = mapBlockSource.find(hashBlock);
+    connman->ForEachNode([this, &pcmpctblock_msg, pindex, fWitnessEnabled, &hashBlock, &source](CNode* pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1082,8 +1112,12 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            connman->PushMessage(pnode, *pcmpctblock_msg);
             state.pindexBestHeaderSent = pindex;
+            if (source != mapBlockSource.end()) {
+                LogPrint(BCLog::CMPCTBLOCK, "Relayed block %s from peer=%d to peer=%d in %dus\n",
+                    hashBlock.ToString(), source->second.node, pnode->GetId(), GetTimeMicros() - source->second.time_received);
+            }
         }
     });
 }
@@ -1130,16 +1164,16 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
     LOCK(cs_main);
 
     const uint256 hash(block.GetHash());
-    std::map<uint256, std::pair<NodeId, bool>>::iterator it = mapBlockSource.find(hash);
+    std::map<uint256, BlockSource>::iterator it = mapBlockSource.find(hash);
 
     int nDoS = 0;
     if (state.IsInvalid(nDoS)) {
         // Don't send reject message with code 0 or an internal reject code.
-        if (it != mapBlockSource.end() && State(it->second.first) && state.GetRejectCode() > 0 && state.GetRejectCode() < REJECT_INTERNAL) {
+        if (it != mapBlockSource.end() && State(it->second.node) && state.GetRejectCode() > 0 && state.GetRejectCode() < REJECT_INTERNAL) {
             CBlockReject reject = {(unsigned char)state.GetRejectCode(), state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), hash};
-            State(it->second.first)->rejects.push_back(reject);
-            if (nDoS > 0 && it->second.second)
-                Misbehaving(it->second.first, nDoS);
+            State(it->second.node)->rejects.push_back(reject);
+            if (nDoS > 0 && it->second.punish)
+                Misbehaving(it->second.node, nDoS);
         }
     }
     // Check that:
@@ -1152,7 +1186,7 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
              !IsInitialBlockDownload() &&
              mapBlocksInFlight.count(hash) == mapBlocksInFlight.size()) {
         if (it != mapBlockSource.end()) {
-            MaybeSetPeerAsAnnouncingHeaderAndIDs(it->second.first, connman);
+            MaybeSetPeerAsAnnouncingHeaderAndIDs(it->second.node, connman);
         }
     }
     if (it != mapBlockSource.end())
@@ -1201,13 +1235,9 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     return true;
 }
 
-static void RelayTransaction(const CTransaction& tx, CConnman* connman)
+void RelayTransaction(const uint256& txid)
 {
-    CInv inv(MSG_TX, tx.GetHash());
-    connman->ForEachNode([&inv](CNode* pnode)
-    {
-        pnode->PushInventory(inv);
-    });
+    g_tx_announcements.Add(txid, GetTimeMicros());
 }
 
 static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connman)
@@ -1408,40 +1438,36 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
     std::vector<CInv> vNotFound;
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
-    {
-        LOCK(cs_main);
-
-        while (it != pfrom->vRecvGetData.end() && (it->type == MSG_TX || it->type == MSG_WITNESS_TX)) {
-            if (interruptMsgProc)
-                return;
-            // Don't bother if send buffer is too full to respond anyway
-            if (pfrom->fPauseSend)
-                break;
-
-            const CInv &inv = *it;
-            it++;
+    // Transactions are served from the relay cache or the mempool, neither of which needs cs_main.
+    while (it != pfrom->vRecvGetData.end() && (it->type == MSG_TX || it->type == MSG_WITNESS_TX)) {
+        if (interruptMsgProc)
+            return;
+        // Don't bother if send buffer is too full to respond anyway
+        if (pfrom->fPauseSend)
+            break;
 
-            // Send stream from relay memory
-            bool push = false;
-            auto mi = mapRelay.find(inv.hash);
-            int nSendFlags = (inv.type == MSG_TX ? SERIALIZE_TRANSACTION_NO_WITNESS : 0);
-            if (mi != mapRelay.end()) {
-                connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *mi->second));
+        const CInv &inv = *it;
+        it++;
+
+        // Send stream from relay memory
+        bool push = false;
+        int nSendFlags = (inv.type == MSG_TX ? SERIALIZE_TRANSACTION_NO_WITNESS : 0);
+        if (CTransactionRef tx = g_relay_cache.Find(inv.hash)) {
+            connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *tx));
+            push = true;
+        } else if (pfrom->timeLastMempoolReq) {
+            auto txinfo = mempool.info(inv.hash);
+            // To protect privacy, do not answer getdata using the mempool when
+            // that TX couldn't have been INVed in reply to a MEMPOOL request.
+            if (txinfo.tx && txinfo.nTime <= pfrom->timeLastMempoolReq) {
+                connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *txinfo.tx));
                 push = true;
-            } else if (pfrom->timeLastMempoolReq) {
-                auto txinfo = mempool.info(inv.hash);
-                // To protect privacy, do not answer getdata using the mempool when
-                // that TX couldn't have been INVed in reply to a MEMPOOL request.
-                if (txinfo.tx && txinfo.nTime <= pfrom->timeLastMempoolReq) {
-                    connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *txinfo.tx));
-                    push = true;
-                }
-            }
-            if (!push) {
-                vNotFound.push_back(inv);
             }
         }
-    } // release cs_main
+        if (!push) {
+            vNotFound.push_back(inv);
+        }
+    }
 
     if (it != pfrom->vRecvGetData.end() && !pfrom->fPauseSend) {
         const CInv &inv = *it;
@@ -1735,7 +1761,7 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
         if (setMisbehaving.count(fromPeer)) continue;
         if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, &fMissingInputs2, &removed_txn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
             LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
-            RelayTransaction(orphanTx, connman);
+            RelayTransaction(orphanTx.GetHash());
             for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
                 auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(orphanHash, i));
                 if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
@@ -1771,6 +1797,26 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
     }
 }
 
+/** Announce the transactions a reconciliation with pto found it to be missing, if they are still in the mempool. */
+static void AnnounceReconciledTransactions(CNode* pto, const std::vector<uint256>& txids, CConnman* connman, const CNetMsgMaker& msgMaker)
+{
+    const int64_t now = GetTimeMicros();
+    std::vector<CInv> vInv;
+    LOCK(pto->cs_inventory);
+    for (const uint256& txid : txids) {
+        CTransactionRef tx = mempool.get(txid);
+        if (!tx) continue;
+        g_relay_cache.Add(tx, now);
+        pto->filterInventoryKnown.insert(txid);
+        vInv.emplace_back(MSG_TX, txid);
+        if (vInv.size() == MAX_INV_SZ) {
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+            vInv.clear();
+        }
+    }
+    if (!vInv.empty()) connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
@@ -1902,6 +1948,17 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (pfrom->fInbound)
             PushNodeVersion(pfrom, connman, GetAdjustedTime());
 
+        // Offer transaction relay by set reconciliation before verack, so that
+        // both sides know whether it is used by the end of the handshake.
+        if (nVersion >= TXRECONCILIATION_VERSION && fRelay && ::fRelayTxes && gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION)) {
+            const uint64_t salt = GetRand(std::numeric_limits<uint64_t>::max()) + 1;
+            {
+                LOCK(cs_main);
+                State(pfrom->GetId())->m_recon_salt = salt;
+            }
+            connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::SENDRECON, TXRECONCILIATION_PROTOCOL_VERSION, salt));
+        }
+
         connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::VERACK));
 
         pfrom->nServices = nServices;
@@ -2040,6 +2097,24 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return true;
     }
 
+    if (strCommand == NetMsgType::SENDRECON) {
+        uint32_t recon_version;
+        uint64_t remote_salt;
+        vRecv >> recon_version >> remote_salt;
+        LOCK(cs_main);
+        CNodeState* nodestate = State(pfrom->GetId());
+        // Only negotiated during the handshake, and only used if we offered it too
+        if (pfrom->fSuccessfullyConnected || nodestate->m_tx_reconciliation) {
+            LogPrint(BCLog::NET, "ignoring sendrecon after handshake from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        if (nodestate->m_recon_salt != 0 && recon_version >= TXRECONCILIATION_PROTOCOL_VERSION) {
+            nodestate->m_tx_reconciliation = MakeUnique<TxReconciliationState>(/* we_initiate */ !pfrom->fInbound, nodestate->m_recon_salt, remote_salt);
+            LogPrint(BCLog::NET, "relaying transactions by reconciliation with peer=%d\n", pfrom->GetId());
+        }
+        return true;
+    }
+
     if (!pfrom->fSuccessfullyConnected) {
         // Must have a verack message before anything else
         LOCK(cs_main);
@@ -2098,6 +2173,76 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return true;
     }
 
+    if (strCommand == NetMsgType::REQRECON) {
+        uint32_t remote_size;
+        vRecv >> remote_size;
+        std::vector<unsigned char> sketch;
+        std::vector<uint256> abandoned;
+        {
+            LOCK(cs_main);
+            CNodeState* nodestate = State(pfrom->GetId());
+            if (!nodestate->m_tx_reconciliation || nodestate->m_tx_reconciliation->WeInitiate()) {
+                LogPrint(BCLog::NET, "unexpected reqrecon from peer=%d\n", pfrom->GetId());
+                return true;
+            }
+            nodestate->m_tx_reconciliation->HandleRequest(remote_size, sketch, abandoned);
+        }
+        AnnounceReconciledTransactions(pfrom, abandoned, connman, msgMaker);
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SKETCH, sketch));
+        return true;
+    }
+
+    if (strCommand == NetMsgType::SKETCH) {
+        std::vector<unsigned char> sketch;
+        vRecv >> sketch;
+        LOCK(cs_main);
+        CNodeState* nodestate = State(pfrom->GetId());
+        if (!nodestate->m_tx_reconciliation || !nodestate->m_tx_reconciliation->WeInitiate()) {
+            LogPrint(BCLog::NET, "unexpected sketch from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        if (nodestate->m_tx_reconciliation->SkipStaleSketch()) {
+            LogPrint(BCLog::NET, "ignoring sketch of an abandoned reconciliation from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        if (!nodestate->m_tx_reconciliation->IsInProgress()) {
+            LogPrint(BCLog::NET, "unexpected sketch from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        if (!TxReconciliationState::IsValidSketch(sketch)) {
+            Misbehaving(pfrom->GetId(), 20, strprintf("sketch size() = %u", sketch.size()));
+            return false;
+        }
+        std::vector<uint256> announce;
+        std::vector<uint32_t> request;
+        const bool success = nodestate->m_tx_reconciliation->HandleSketch(sketch, announce, request);
+        LogPrint(BCLog::NET, "reconciliation with peer=%d %s: announcing %u, requesting %u\n",
+                 pfrom->GetId(), success ? "succeeded" : "failed", announce.size(), request.size());
+        AnnounceReconciledTransactions(pfrom, announce, connman, msgMaker);
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, success, request));
+        return true;
+    }
+
+    if (strCommand == NetMsgType::RECONCILDIFF) {
+        bool success;
+        std::vector<uint32_t> requested;
+        vRecv >> success >> requested;
+        LOCK(cs_main);
+        CNodeState* nodestate = State(pfrom->GetId());
+        if (!nodestate->m_tx_reconciliation || nodestate->m_tx_reconciliation->WeInitiate() || !nodestate->m_tx_reconciliation->IsInProgress()) {
+            LogPrint(BCLog::NET, "unexpected reconcildiff from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        if (requested.size() > TxReconciliationState::MAX_SKETCH_CAPACITY) {
+            Misbehaving(pfrom->GetId(), 20, strprintf("reconcildiff size() = %u", requested.size()));
+            return false;
+        }
+        std::vector<uint256> announce;
+        nodestate->m_tx_reconciliation->HandleDiff(success, requested, announce);
+        AnnounceReconciledTransactions(pfrom, announce, connman, msgMaker);
+        return true;
+    }
+
     if (strCommand == NetMsgType::SENDHEADERS) {
         LOCK(cs_main);
         State(pfrom->GetId())->fPreferHeaders = true;
@@ -2175,6 +2320,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             else
             {
                 pfrom->AddInventoryKnown(inv);
+                // No need to reconcile what the peer just announced to us.
+                if (State(pfrom->GetId())->m_tx_reconciliation) State(pfrom->GetId())->m_tx_reconciliation->Remove(inv.hash);
                 if (fBlocksOnly) {
                     LogPrint(BCLog::NET, "transaction (%s) inv sent in violation of protocol peer=%d\n", inv.hash.ToString(), pfrom->GetId());
                 } else if (!fAlreadyHave && !fImporting && !fReindex && !IsInitialBlockDownload()) {
@@ -2415,13 +2562,14 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         nodestate->m_tx_download.m_tx_announced.erase(inv.hash);
         nodestate->m_tx_download.m_tx_in_flight.erase(inv.hash);
         EraseTxRequest(inv.hash);
+        if (nodestate->m_tx_reconciliation) nodestate->m_tx_reconciliation->Remove(inv.hash);
 
         std::list<CTransactionRef> lRemovedTxn;
 
         if (!AlreadyHave(inv) &&
             AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
             mempool.check(pcoinsTip.get());
-            RelayTransaction(tx, connman);
+            RelayTransaction(tx.GetHash());
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
                 auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(inv.hash, i));
                 if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
@@ -2499,7 +2647,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 int nDoS = 0;
                 if (!state.IsInvalid(nDoS) || nDoS == 0) {
                     LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->GetId());
-                    RelayTransaction(tx, connman);
+                    RelayTransaction(tx.GetHash());
                 } else {
                     LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s)\n", tx.GetHash().ToString(), pfrom->GetId(), FormatStateMessage(state));
                 }
@@ -2739,7 +2887,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // block that is in flight from some other peer.
             {
                 LOCK(cs_main);
-                mapBlockSource.emplace(pblock->GetHash(), std::make_pair(pfrom->GetId(), false));
+                mapBlockSource.emplace(pblock->GetHash(), BlockSource{pfrom->GetId(), false, nTimeReceived});
             }
             bool fNewBlock = false;
             // Setting fForceProcessing to true means that we bypass some of
@@ -2824,12 +2972,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // updated, reject messages go out, etc.
                 MarkBlockAsReceived(resp.blockhash); // it is now an empty pointer
                 fBlockRead = true;
-                // mapBlockSource is only used for sending reject messages and DoS scores,
+                // mapBlockSource is only used for sending reject messages, DoS scores and relay timing,
                 // so the race between here and cs_main in ProcessNewBlock is fine.
                 // BIP 152 permits peers to relay compact blocks after validating
                 // the header only; we should not punish peers if the block turns
                 // out to be invalid.
-                mapBlockSource.emplace(resp.blockhash, std::make_pair(pfrom->GetId(), false));
+                mapBlockSource.emplace(resp.blockhash, BlockSource{pfrom->GetId(), false, nTimeReceived});
             }
         } // Don't hold cs_main when we call into ProcessNewBlock
         if (fBlockRead) {
@@ -2902,9 +3050,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // Also always process if we requested the block explicitly, as we may
             // need it even though it is not a candidate for a new best tip.
             forceProcessing |= MarkBlockAsReceived(hash);
-            // mapBlockSource is only used for sending reject messages and DoS scores,
+            // mapBlockSource is only used for sending reject messages, DoS scores and relay timing,
             // so the race between here and cs_main in ProcessNewBlock is fine.
-            mapBlockSource.emplace(hash, std::make_pair(pfrom->GetId(), true));
+            mapBlockSource.emplace(hash, BlockSource{pfrom->GetId(), true, nTimeReceived});
         }
         bool fNewBlock = false;
         ProcessNewBlock(chainparams, pblock, forceProcessing, &fNewBlock);
@@ -2936,7 +3084,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
         pfrom->fSentAddr = true;
 
-        pfrom->vAddrToSend.clear();
+        WITH_LOCK(pfrom->cs_vAddrToSend, pfrom->vAddrToSend.clear());
         std::vector<CAddress> vAddr = connman->GetAddresses();
         FastRandomContext insecure_rand;
         for (const CAddress &addr : vAddr) {
@@ -3121,6 +3269,16 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     return true;
 }
 
+/**
+ * Messages that are processed without cs_main as long as they are well formed,
+ * so they can be handled concurrently by several message handler threads.
+ */
+static bool IsChainStateFreeCommand(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::PING || strCommand == NetMsgType::PONG ||
+           strCommand == NetMsgType::FEEFILTER || strCommand == NetMsgType::ADDR;
+}
+
 bool PeerLogicValidation::SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_bip61) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
@@ -3226,8 +3384,9 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // Checksum
     CDataStream& vRecv = msg.vRecv;
-    const uint256& hash = msg.GetMessageHash();
-    if (memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0)
+    const uint256& hash = msg.m_authenticated ? uint256() : msg.GetMessageHash();
+    // (encrypted messages are authenticated by the transport instead)
+    if (!msg.m_authenticated && memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0)
     {
         LogPrint(BCLog::NET, "%s(%s, %u bytes): CHECKSUM ERROR expected %s was %s\n", __func__,
            SanitizeString(strCommand), nMessageSize,
@@ -3281,6 +3440,13 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
     }
 
+    // Messages that were handled without touching chain state cannot have
+    // queued a reject or a ban, so skip cs_main for them. SendMessages, which
+    // runs next for this peer, checks again anyway.
+    if (fRet && IsChainStateFreeCommand(strCommand)) {
+        return fMoreWork;
+    }
+
     LOCK(cs_main);
     SendRejectsAndCheckIfBanned(pfrom, m_enable_bip61);
 
@@ -3420,25 +3586,6 @@ void PeerLogicValidation::CheckForStaleTipAndEvictPeers(const Consensus::Params
     }
 }
 
-namespace {
-class CompareInvMempoolOrder
-{
-    CTxMemPool *mp;
-public:
-    explicit CompareInvMempoolOrder(CTxMemPool *_mempool)
-    {
-        mp = _mempool;
-    }
-
-    bool operator()(std::set<uint256>::iterator a, std::set<uint256>::iterator b)
-    {
-        /* As std::make_heap produces a max-heap, we want the entries with the
-         * fewest ancestors/highest fee to sort later. */
-        return mp->CompareDepthAndScore(*b, *a);
-    }
-};
-}
-
 bool PeerLogicValidation::SendMessages(CNode* pto)
 {
     const Consensus::Params& consensusParams = Params().GetConsensus();
@@ -3499,27 +3646,27 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
         if (pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
             std::vector<CAddress> vAddr;
-            vAddr.reserve(pto->vAddrToSend.size());
-            for (const CAddress& addr : pto->vAddrToSend)
             {
-                if (!pto->addrKnown.contains(addr.GetKey()))
+                LOCK(pto->cs_vAddrToSend);
+                vAddr.reserve(pto->vAddrToSend.size());
+                for (const CAddress& addr : pto->vAddrToSend)
                 {
-                    pto->addrKnown.insert(addr.GetKey());
-                    vAddr.push_back(addr);
-                    // receiver rejects addr messages larger than 1000
-                    if (vAddr.size() >= 1000)
+                    if (!pto->addrKnown.contains(addr.GetKey()))
                     {
-                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::ADDR, vAddr));
-                        vAddr.clear();
+                        pto->addrKnown.insert(addr.GetKey());
+                        vAddr.push_back(addr);
                     }
                 }
+                pto->vAddrToSend.clear();
+                // we only send the big addr message once
+                if (pto->vAddrToSend.capacity() > 40)
+                    pto->vAddrToSend.shrink_to_fit();
+            }
+            // receiver rejects addr messages larger than 1000
+            for (size_t i = 0; i < vAddr.size(); i += 1000) {
+                const size_t end = std::min(vAddr.size(), i + 1000);
+                connman->PushMessage(pto, msgMaker.Make(NetMsgType::ADDR, std::vector<CAddress>(vAddr.begin() + i, vAddr.begin() + end)));
             }
-            pto->vAddrToSend.clear();
-            if (!vAddr.empty())
-                connman->PushMessage(pto, msgMaker.Make(NetMsgType::ADDR, vAddr));
-            // we only send the big addr message once
-            if (pto->vAddrToSend.capacity() > 40)
-                pto->vAddrToSend.shrink_to_fit();
         }
 
         // Start block sync
@@ -3626,7 +3773,9 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
+                            if (state.fWantsCmpctWitness)
+                                connman->PushMessage(pto, *most_recent_compact_block_msg);
+                            else if (!fWitnessesPresentInMostRecentCompactBlock)
                                 connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
                             else {
                                 CBlockHeaderAndShortTxIDs cmpctblock(*most_recent_block, state.fWantsCmpctWitness);
@@ -3719,7 +3868,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
             // Time to send but the peer has requested we not relay transactions.
             if (fSendTrickle) {
                 LOCK(pto->cs_filter);
-                if (!pto->fRelayTxes) pto->setInventoryTxToSend.clear();
+                if (!pto->fRelayTxes) state.m_tx_announcement_cursor = g_tx_announcements.End();
             }
 
             // Respond to BIP35 mempool requests
@@ -3737,7 +3886,6 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                 for (const auto& txinfo : vtxinfo) {
                     const uint256& hash = txinfo.tx->GetHash();
                     CInv inv(MSG_TX, hash);
-                    pto->setInventoryTxToSend.erase(hash);
                     if (filterrate) {
                         if (txinfo.feeRate.GetFeePerK() < filterrate)
                             continue;
@@ -3757,73 +3905,67 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
 
             // Determine transactions to relay
             if (fSendTrickle) {
-                // Produce a vector with all candidates for sending
-                std::vector<std::set<uint256>::iterator> vInvTx;
-                vInvTx.reserve(pto->setInventoryTxToSend.size());
-                for (std::set<uint256>::iterator it = pto->setInventoryTxToSend.begin(); it != pto->setInventoryTxToSend.end(); it++) {
-                    vInvTx.push_back(it);
-                }
                 CAmount filterrate = 0;
                 {
                     LOCK(pto->cs_feeFilter);
                     filterrate = pto->minFeeFilter;
                 }
-                // Topologically and fee-rate sort the inventory we send for privacy and priority reasons.
-                // A heap is used so that not all items need sorting if only a few are being sent.
-                CompareInvMempoolOrder compareInvMempoolOrder(&mempool);
-                std::make_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
+                // The shared queue hands out transactions topologically and
+                // fee-rate sorted, for privacy and priority reasons.
                 // No reason to drain out at many times the network's capacity,
                 // especially since we have many peers and some will draw much shorter delays.
                 unsigned int nRelayedTransactions = 0;
                 LOCK(pto->cs_filter);
-                while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
-                    // Fetch the top element from the heap
-                    std::pop_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
-                    std::set<uint256>::iterator it = vInvTx.back();
-                    vInvTx.pop_back();
-                    uint256 hash = *it;
-                    // Remove it from the to-be-sent set
-                    pto->setInventoryTxToSend.erase(it);
+                g_tx_announcements.ForEach(state.m_tx_announcement_cursor, nNow, [&](const TxMempoolInfo& txinfo) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pto->cs_inventory, pto->cs_filter) {
+                    if (nRelayedTransactions >= INVENTORY_BROADCAST_MAX) {
+                        return false;
+                    }
+                    const uint256& hash = txinfo.tx->GetHash();
                     // Check if not in the filter already
                     if (pto->filterInventoryKnown.contains(hash)) {
-                        continue;
-                    }
-                    // Not in the mempool anymore? don't bother sending it.
-                    auto txinfo = mempool.info(hash);
-                    if (!txinfo.tx) {
-                        continue;
+                        return true;
                     }
                     if (filterrate && txinfo.feeRate.GetFeePerK() < filterrate) {
-                        continue;
+                        return true;
                     }
-                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                    // The queue was sorted a while ago; skip what has been mined,
+                    // replaced or evicted since.
+                    const TxMempoolInfo current = mempool.info(hash);
+                    if (!current.tx) return true;
+                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) return true;
+                    // Leave it to the next reconciliation, if the set has room
+                    if (state.m_tx_reconciliation && state.m_tx_reconciliation->Add(hash)) return true;
                     // Send
                     vInv.push_back(CInv(MSG_TX, hash));
                     nRelayedTransactions++;
-                    {
-                        // Expire old relay messages
-                        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < nNow)
-                        {
-                            mapRelay.erase(vRelayExpiration.front().second);
-                            vRelayExpiration.pop_front();
-                        }
-
-                        auto ret = mapRelay.insert(std::make_pair(hash, std::move(txinfo.tx)));
-                        if (ret.second) {
-                            vRelayExpiration.push_back(std::make_pair(nNow + 15 * 60 * 1000000, ret.first));
-                        }
-                    }
+                    g_relay_cache.Add(current.tx, nNow);
                     if (vInv.size() == MAX_INV_SZ) {
                         connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
                         vInv.clear();
                     }
                     pto->filterInventoryKnown.insert(hash);
-                }
+                    return true;
+                });
             }
         }
         if (!vInv.empty())
             connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
+        // Announce the transactions of a reconciliation the peer did not answer in time
+        if (state.m_tx_reconciliation && state.m_tx_reconciliation->IsRequestExpired(nNow)) {
+            std::vector<uint256> abandoned;
+            state.m_tx_reconciliation->AbandonRequest(abandoned);
+            LogPrint(BCLog::NET, "reconciliation with peer=%d timed out: announcing %u\n", pto->GetId(), abandoned.size());
+            AnnounceReconciledTransactions(pto, abandoned, connman, msgMaker);
+        }
+
+        // Start reconciling the transactions that were not announced
+        if (state.m_tx_reconciliation && state.m_tx_reconciliation->IsRequestDue(nNow)) {
+            const uint32_t set_size = state.m_tx_reconciliation->StartRequest(PoissonNextSend(nNow, TxReconciliationState::REQUEST_INTERVAL),
+                                                                              nNow + TxReconciliationState::REQUEST_TIMEOUT * 1000000LL);
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, set_size));
+        }
+
         // Detect whether we're stalling
         nNow = GetTimeMicros();
         if (state.nStallingSince && state.nStallingSince < nNow - 1000000 * BLOCK_STALLING_TIMEOUT) {
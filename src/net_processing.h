@@ -84,9 +84,13 @@ struct CNodeStateStats {
     int nSyncHeight = -1;
     int nCommonHeight = -1;
     std::vector<int> vHeightInFlight;
+    bool m_tx_reconciliation = false;
 };
 
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 
+/** Queue a transaction to be announced to every peer. */
+void RelayTransaction(const uint256& txid);
+
 #endif // BITCOIN_NET_PROCESSING_H
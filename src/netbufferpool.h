@@ -0,0 +1,113 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NETBUFFERPOOL_H
+#define BITCOIN_NETBUFFERPOOL_H
+
+#include <crypto/common.h>
+#include <sync.h>
+
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+/** Default limit on the capacity kept by each network buffer pool */
+static const size_t DEFAULT_NET_BUFFER_POOL_SIZE = 16 * 1024 * 1024;
+
+/** Counters of a NetBufferPool */
+struct NetBufferPoolStats
+{
+    uint64_t allocated{0};  //!< buffers handed out that had to be allocated
+    uint64_t reused{0};     //!< buffers handed out from the pool
+    uint64_t discarded{0};  //!< buffers given back that were freed instead of pooled
+    size_t pooled{0};       //!< buffers currently in the pool
+    size_t pooled_bytes{0}; //!< total capacity of the buffers currently in the pool
+};
+
+/**
+ * Free lists of byte buffers, so that the storage of sent and received
+ * network messages is reused instead of being allocated and freed for every
+ * message.
+ *
+ * Buffers are kept in classes by the power of two of their capacity, so that
+ * Take() hands out a buffer that does not need to grow for the requested
+ * size. Buffers that are larger than MAX_BUFFER_SIZE (such as the ones blocks
+ * are received into), or that would exceed the total capacity limit, are
+ * freed when given back.
+ */
+template <typename Buffer>
+class NetBufferPool
+{
+public:
+    static constexpr size_t MIN_BUFFER_SIZE = 32;
+    static constexpr size_t MAX_BUFFER_SIZE = 1024 * 1024;
+
+    explicit NetBufferPool(size_t max_pooled_bytes = DEFAULT_NET_BUFFER_POOL_SIZE) : m_max_pooled_bytes(max_pooled_bytes) {}
+
+    /** Get an empty buffer with a capacity of at least size bytes. */
+    Buffer Take(size_t size)
+    {
+        {
+            LOCK(m_mutex);
+            // Smallest class whose buffers are all large enough
+            const size_t min_class = CountBits((std::max(size, MIN_BUFFER_SIZE) - 1) / MIN_BUFFER_SIZE);
+            for (size_t c = min_class; c < NUM_CLASSES; c++) {
+                if (m_free[c].empty()) continue;
+                Buffer buf = std::move(m_free[c].back());
+                m_free[c].pop_back();
+                m_stats.reused++;
+                m_stats.pooled--;
+                m_stats.pooled_bytes -= buf.capacity();
+                return buf;
+            }
+            m_stats.allocated++;
+        }
+        Buffer buf;
+        buf.reserve(std::max(size, MIN_BUFFER_SIZE));
+        return buf;
+    }
+
+    /** Give back a buffer that is no longer needed. */
+    void Give(Buffer&& buf)
+    {
+        const size_t capacity = buf.capacity();
+        if (capacity == 0) return;
+        LOCK(m_mutex);
+        if (capacity < MIN_BUFFER_SIZE || capacity > MAX_BUFFER_SIZE || m_stats.pooled_bytes + capacity > m_max_pooled_bytes) {
+            m_stats.discarded++;
+            return;
+        }
+        buf.clear();
+        m_free[SizeClass(capacity)].push_back(std::move(buf));
+        m_stats.pooled++;
+        m_stats.pooled_bytes += capacity;
+    }
+
+    NetBufferPoolStats GetStats() const
+    {
+        LOCK(m_mutex);
+        return m_stats;
+    }
+
+private:
+    static constexpr size_t NUM_CLASSES = 16; // MIN_BUFFER_SIZE << 15 == MAX_BUFFER_SIZE
+
+    //! Class of a capacity: buffers in class c hold at least MIN_BUFFER_SIZE << c bytes
+    static size_t SizeClass(size_t capacity)
+    {
+        return std::min<size_t>(CountBits(capacity / MIN_BUFFER_SIZE) - 1, NUM_CLASSES - 1);
+    }
+
+    const size_t m_max_pooled_bytes;
+    mutable Mutex m_mutex;
+    std::array<std::vector<Buffer>, NUM_CLASSES> m_free GUARDED_BY(m_mutex);
+    NetBufferPoolStats m_stats GUARDED_BY(m_mutex);
+};
+
+template <typename Buffer> constexpr size_t NetBufferPool<Buffer>::MIN_BUFFER_SIZE;
+template <typename Buffer> constexpr size_t NetBufferPool<Buffer>::MAX_BUFFER_SIZE;
+template <typename Buffer> constexpr size_t NetBufferPool<Buffer>::NUM_CLASSES;
+
+#endif // BITCOIN_NETBUFFERPOOL_H
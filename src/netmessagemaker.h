@@ -19,6 +19,10 @@ public:
     {
         CSerializedNetMsg msg;
         msg.command = std::move(sCommand);
+        // Size the pooled buffer up front so serializing never reallocates it
+        CSizeComputer size(nFlags | nVersion, SER_NETWORK);
+        SerializeMany(size, args...);
+        msg.data = g_net_send_buffers.Take(size.size());
         CVectorWriter{ SER_NETWORK, nFlags | nVersion, msg.data, 0, std::forward<Args>(args)... };
         return msg;
     }
@@ -0,0 +1,194 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/mempool_journal.h>
+
+#include <clientversion.h>
+#include <logging.h>
+#include <random.h>
+#include <streams.h>
+#include <txmempool.h>
+#include <util/system.h>
+#include <util/time.h>
+
+static const uint64_t MEMPOOL_JOURNAL_VERSION = 1;
+
+//! Journal record types
+static const uint8_t RECORD_ADD = 1;
+static const uint8_t RECORD_REMOVE = 2;
+
+static fs::path PreviousJournalPath(const fs::path& path)
+{
+    return path.string() + ".old";
+}
+
+MempoolJournal::MempoolJournal(const fs::path& path) : m_path(path) {}
+
+MempoolJournal::~MempoolJournal()
+{
+    Detach();
+    Commit();
+    LOCK(m_file_mutex);
+    if (m_file) fclose(m_file);
+}
+
+void MempoolJournal::Attach(CTxMemPool& pool)
+{
+    m_pool = &pool;
+    m_added_conn = pool.NotifyEntryAdded.connect([this](CTransactionRef tx) {
+        TransactionAdded(tx, GetTime());
+    });
+    m_removed_conn = pool.NotifyEntryRemoved.connect([this](CTransactionRef tx, MemPoolRemovalReason) {
+        TransactionRemoved(tx->GetHash());
+    });
+}
+
+void MempoolJournal::Detach()
+{
+    m_added_conn.disconnect();
+    m_removed_conn.disconnect();
+}
+
+uint64_t MempoolJournal::Rotate()
+{
+    // Zero is reserved to mean "no journal" in mempool.dat.
+    uint64_t id = 0;
+    while (id == 0) id = GetRand(std::numeric_limits<uint64_t>::max());
+
+    CDataStream header(SER_DISK, CLIENT_VERSION);
+    header << MEMPOOL_JOURNAL_VERSION << id;
+    LOCK(m_pending_mutex);
+    // A journal rotated away before its file was created only has records
+    // that the dump of the newer one includes.
+    if (m_rotate_id == 0) m_rotate_tail = std::move(m_pending);
+    m_rotate_id = id;
+    m_pending.assign(header.begin(), header.end());
+    return id;
+}
+
+void MempoolJournal::DiscardPrevious()
+{
+    try {
+        fs::remove(PreviousJournalPath(m_path));
+    } catch (const fs::filesystem_error& e) {
+        LogPrintf("Failed to remove old mempool journal: %s\n", fsbridge::get_filesystem_error_message(e));
+    }
+}
+
+void MempoolJournal::Write(const std::vector<unsigned char>& records)
+{
+    if (!m_file || m_write_failed || records.empty()) return;
+    if (fwrite(records.data(), 1, records.size(), m_file) != records.size() || fflush(m_file) != 0) {
+        // Replay stops at the first unreadable record, so there is no point
+        // in appending after a failed write. The next dump starts over.
+        LogPrintf("Failed to write to mempool journal %s\n", m_path.string());
+        m_write_failed = true;
+        return;
+    }
+    m_size += records.size();
+}
+
+void MempoolJournal::Append(const CDataStream& record)
+{
+    LOCK(m_pending_mutex);
+    m_pending.insert(m_pending.end(), record.begin(), record.end());
+}
+
+void MempoolJournal::TransactionAdded(const CTransactionRef& tx, int64_t time)
+{
+    CDataStream record(SER_DISK, CLIENT_VERSION);
+    record << RECORD_ADD << *tx << time;
+    Append(record);
+}
+
+void MempoolJournal::TransactionRemoved(const uint256& txid)
+{
+    CDataStream record(SER_DISK, CLIENT_VERSION);
+    record << RECORD_REMOVE << txid;
+    Append(record);
+}
+
+uint64_t MempoolJournal::Commit()
+{
+    LOCK(m_file_mutex);
+    std::vector<unsigned char> records, rotate_tail;
+    uint64_t rotate_id;
+    {
+        LOCK(m_pending_mutex);
+        records.swap(m_pending);
+        rotate_tail.swap(m_rotate_tail);
+        rotate_id = m_rotate_id;
+        m_rotate_id = 0;
+    }
+
+    if (rotate_id != 0) {
+        if (m_file) {
+            Write(rotate_tail);
+            if (!m_write_failed) FileCommit(m_file);
+            fclose(m_file);
+            m_file = nullptr;
+            RenameOver(m_path, PreviousJournalPath(m_path));
+        }
+        m_size = 0;
+        m_write_failed = false;
+        m_file = fsbridge::fopen(m_path, "wb");
+        if (!m_file) {
+            LogPrintf("Failed to open mempool journal %s. Continuing without it.\n", m_path.string());
+        }
+    }
+
+    Write(records);
+    if (m_file && !m_write_failed) FileCommit(m_file);
+    return m_size;
+}
+
+static bool ReplayFile(const fs::path& path, uint64_t id,
+                       const std::function<void(const CTransactionRef&, int64_t)>& added,
+                       const std::function<void(const uint256&)>& removed)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) return false;
+
+    try {
+        uint64_t version, file_id;
+        file >> version >> file_id;
+        if (version != MEMPOOL_JOURNAL_VERSION || file_id != id) return false;
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    int64_t records = 0;
+    try {
+        while (true) {
+            uint8_t type;
+            file >> type;
+            if (type == RECORD_ADD) {
+                CTransactionRef tx;
+                int64_t time;
+                file >> tx >> time;
+                added(tx, time);
+            } else if (type == RECORD_REMOVE) {
+                uint256 txid;
+                file >> txid;
+                removed(txid);
+            } else {
+                LogPrintf("Unknown record type in mempool journal, ignoring the rest of it\n");
+                break;
+            }
+            ++records;
+        }
+    } catch (const std::exception&) {
+        // End of file, or the last record was torn by an unclean shutdown.
+    }
+    LogPrintf("Replayed %i records from mempool journal %s\n", records, path.filename().string());
+    return true;
+}
+
+bool MempoolJournal::Replay(const fs::path& path, uint64_t id,
+                            const std::function<void(const CTransactionRef&, int64_t)>& added,
+                            const std::function<void(const uint256&)>& removed)
+{
+    if (id == 0) return false;
+    return ReplayFile(path, id, added, removed) || ReplayFile(PreviousJournalPath(path), id, added, removed);
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_MEMPOOL_JOURNAL_H
+#define BITCOIN_NODE_MEMPOOL_JOURNAL_H
+
+#include <fs.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+
+#include <vector>
+
+#include <functional>
+#include <stdint.h>
+
+#include <boost/signals2/connection.hpp>
+
+class CDataStream;
+class CTxMemPool;
+
+/**
+ * Append-only log of the mempool additions and removals since the last
+ * mempool.dat dump. Together with the dump it allows the mempool to be
+ * reconstructed after an unclean shutdown, and it lets the dump itself be
+ * rewritten only occasionally instead of on every change.
+ *
+ * Each journal starts with a random id which is also written to the
+ * mempool.dat it extends, so a journal is never replayed on top of a dump it
+ * does not belong to. Records are buffered in memory as they happen and
+ * written and synced to disk by Commit(), which mempool notifications never
+ * wait for; a record torn by a crash is ignored on replay.
+ */
+class MempoolJournal
+{
+public:
+    explicit MempoolJournal(const fs::path& path);
+    ~MempoolJournal();
+
+    /** Record additions and removals of pool until Detach() or destruction. */
+    void Attach(CTxMemPool& pool);
+    /** Stop recording. Call with the pool's lock held, so no notification is still running. */
+    void Detach();
+    const CTxMemPool* GetAttachedPool() const { return m_pool; }
+
+    /**
+     * Start a new, empty journal with a fresh id and return that id. Changes
+     * recorded from here on go to the new journal; its file is only created by
+     * the next Commit(). The previous file is kept until DiscardPrevious() is
+     * called, so it can still be replayed if writing the matching mempool.dat
+     * fails. Does no I/O, so it can be called under the pool's lock.
+     */
+    uint64_t Rotate();
+    /** Remove the journal file superseded by the last Rotate(). */
+    void DiscardPrevious();
+
+    void TransactionAdded(const CTransactionRef& tx, int64_t time);
+    void TransactionRemoved(const uint256& txid);
+
+    /** Write the buffered records and sync the journal to disk. Returns the size of the current journal in bytes. */
+    uint64_t Commit();
+
+    /**
+     * Replay the journal written with the given id from path (or from its
+     * previous-generation file), invoking the callbacks in the order the
+     * changes happened. Returns false if no journal with that id exists.
+     */
+    static bool Replay(const fs::path& path, uint64_t id,
+                       const std::function<void(const CTransactionRef&, int64_t)>& added,
+                       const std::function<void(const uint256&)>& removed);
+
+private:
+    void Append(const CDataStream& record);
+    void Write(const std::vector<unsigned char>& records) EXCLUSIVE_LOCKS_REQUIRED(m_file_mutex);
+
+    const fs::path m_path;
+
+    //! Guards the file. Taken before m_pending_mutex, and never by mempool notifications.
+    Mutex m_file_mutex;
+    FILE* m_file GUARDED_BY(m_file_mutex){nullptr};
+    uint64_t m_size GUARDED_BY(m_file_mutex){0};
+    bool m_write_failed GUARDED_BY(m_file_mutex){false};
+
+    Mutex m_pending_mutex;
+    //! Records not written to the file yet
+    std::vector<unsigned char> m_pending GUARDED_BY(m_pending_mutex);
+    //! Id of the journal started by Rotate() whose file is not created yet, or zero
+    uint64_t m_rotate_id GUARDED_BY(m_pending_mutex){0};
+    //! Records of the journal that m_rotate_id replaces, not written to its file yet
+    std::vector<unsigned char> m_rotate_tail GUARDED_BY(m_pending_mutex);
+
+    const CTxMemPool* m_pool{nullptr};
+    boost::signals2::scoped_connection m_added_conn;
+    boost::signals2::scoped_connection m_removed_conn;
+};
+
+#endif // BITCOIN_NODE_MEMPOOL_JOURNAL_H
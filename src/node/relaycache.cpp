@@ -0,0 +1,51 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/relaycache.h>
+
+#include <core_memusage.h>
+
+constexpr int64_t RelayCache::EXPIRY;
+
+void RelayCache::Add(const CTransactionRef& tx, int64_t now)
+{
+    const size_t usage = RecursiveDynamicUsage(tx);
+    LOCK(m_mutex);
+    Evict(now);
+    if (!m_txs.emplace(tx->GetHash(), std::make_pair(tx, usage)).second) return;
+    m_expiry.emplace_back(now + EXPIRY, tx->GetHash());
+    m_usage += usage;
+    Evict(now);
+}
+
+void RelayCache::Evict(int64_t now)
+{
+    // Entries expire in the order they were added, so evicting the oldest
+    // ones first also takes care of expiry.
+    while (!m_expiry.empty() && (m_expiry.front().first < now || m_usage > m_max_usage)) {
+        auto it = m_txs.find(m_expiry.front().second);
+        m_usage -= it->second.second;
+        m_txs.erase(it);
+        m_expiry.pop_front();
+    }
+}
+
+CTransactionRef RelayCache::Find(const uint256& txid) const
+{
+    LOCK(m_mutex);
+    auto it = m_txs.find(txid);
+    return it != m_txs.end() ? it->second.first : nullptr;
+}
+
+size_t RelayCache::Size() const
+{
+    LOCK(m_mutex);
+    return m_txs.size();
+}
+
+size_t RelayCache::DynamicMemoryUsage() const
+{
+    LOCK(m_mutex);
+    return m_usage;
+}
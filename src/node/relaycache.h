@@ -0,0 +1,59 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_RELAYCACHE_H
+#define BITCOIN_NODE_RELAYCACHE_H
+
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <txmempool.h>
+#include <uint256.h>
+
+#include <deque>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+
+/** Default limit on the memory used by the transactions in the relay cache */
+static const size_t DEFAULT_MAX_RELAY_CACHE_USAGE = 64 * 1024 * 1024;
+
+/**
+ * Transactions recently announced to peers, kept so that their getdata
+ * requests can be answered even if the transactions have left the mempool
+ * in the meantime.
+ *
+ * Entries expire EXPIRY after they were added, and the oldest ones are
+ * evicted early to keep the memory used by the transactions within a limit.
+ * The cache has a lock of its own, so getdata requests for transactions are
+ * served without cs_main.
+ */
+class RelayCache
+{
+public:
+    //! Time transactions are kept for, in microseconds
+    static constexpr int64_t EXPIRY = 15 * 60 * 1000000LL;
+
+    explicit RelayCache(size_t max_usage = DEFAULT_MAX_RELAY_CACHE_USAGE) : m_max_usage(max_usage) {}
+
+    /** Keep tx until EXPIRY after now. Adding a transaction that is already cached does not extend its expiry. */
+    void Add(const CTransactionRef& tx, int64_t now);
+
+    /** The cached transaction with the given txid, or nullptr. */
+    CTransactionRef Find(const uint256& txid) const;
+
+    size_t Size() const;
+    size_t DynamicMemoryUsage() const;
+
+private:
+    void Evict(int64_t now) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    const size_t m_max_usage;
+    mutable Mutex m_mutex;
+    std::unordered_map<uint256, std::pair<CTransactionRef, size_t>, SaltedTxidHasher> m_txs GUARDED_BY(m_mutex);
+    //! (expiry time, txid) in the order transactions were added
+    std::deque<std::pair<int64_t, uint256>> m_expiry GUARDED_BY(m_mutex);
+    size_t m_usage GUARDED_BY(m_mutex){0};
+};
+
+#endif // BITCOIN_NODE_RELAYCACHE_H
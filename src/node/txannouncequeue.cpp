@@ -0,0 +1,114 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txannouncequeue.h>
+
+#include <algorithm>
+
+constexpr int64_t TxAnnouncementQueue::BUCKET_DURATION;
+constexpr int64_t TxAnnouncementQueue::MAX_AGE;
+constexpr size_t TxAnnouncementQueue::MAX_QUEUED;
+constexpr size_t TxAnnouncementQueue::BATCH_SIZE;
+
+void TxAnnouncementQueue::Add(const uint256& txid, int64_t now)
+{
+    LOCK(m_mutex);
+    Expire(now);
+    if (m_buckets.empty() || m_buckets.back().sorted || m_buckets.back().start + BUCKET_DURATION <= now) {
+        m_buckets.emplace_back();
+        Bucket& bucket = m_buckets.back();
+        bucket.first = bucket.end = m_end;
+        bucket.start = now;
+    }
+    m_buckets.back().txids.push_back(txid);
+    m_buckets.back().end = ++m_end;
+    ++m_queued;
+}
+
+uint64_t TxAnnouncementQueue::End() const
+{
+    LOCK(m_mutex);
+    return m_end;
+}
+
+size_t TxAnnouncementQueue::Size() const
+{
+    LOCK(m_mutex);
+    return m_queued;
+}
+
+void TxAnnouncementQueue::Sort(Bucket& bucket)
+{
+    // The same transaction may have been queued more than once.
+    std::sort(bucket.txids.begin(), bucket.txids.end());
+    bucket.txids.erase(std::unique(bucket.txids.begin(), bucket.txids.end()), bucket.txids.end());
+
+    m_queued -= bucket.end - bucket.first;
+    {
+        LOCK(m_pool.cs);
+        bucket.txs.reserve(bucket.txids.size());
+        for (const uint256& txid : bucket.txids) {
+            TxMempoolInfo info = m_pool.info(txid);
+            if (info.tx) bucket.txs.push_back(std::move(info));
+        }
+        std::sort(bucket.txs.begin(), bucket.txs.end(), [this](const TxMempoolInfo& a, const TxMempoolInfo& b) {
+            return m_pool.CompareDepthAndScore(a.tx->GetHash(), b.tx->GetHash());
+        });
+    }
+    m_queued += bucket.txs.size();
+    bucket.txids.clear();
+    bucket.txids.shrink_to_fit();
+    bucket.sorted = true;
+}
+
+void TxAnnouncementQueue::Expire(int64_t now)
+{
+    while (!m_buckets.empty() && (m_buckets.front().start + MAX_AGE < now || m_queued > MAX_QUEUED)) {
+        const Bucket& bucket = m_buckets.front();
+        m_queued -= bucket.sorted ? bucket.txs.size() : bucket.txids.size();
+        m_buckets.pop_front();
+    }
+}
+
+void TxAnnouncementQueue::ForEach(uint64_t& cursor, int64_t now, const std::function<bool(const TxMempoolInfo&)>& fn)
+{
+    // Transactions are copied out in batches, so that fn runs without m_mutex
+    // held; next[i] is where the cursor goes once batch[i] is done with.
+    std::vector<TxMempoolInfo> batch;
+    std::vector<uint64_t> next;
+    while (true) {
+        uint64_t end = cursor;
+        bool more = false;
+        {
+            LOCK(m_mutex);
+            Expire(now);
+            for (Bucket& bucket : m_buckets) {
+                if (bucket.end <= end) continue;
+                // Buckets close in order, so none after an open one is closed either.
+                if (!bucket.sorted && bucket.start + BUCKET_DURATION > now) break;
+                if (!bucket.sorted) Sort(bucket);
+                // Skip what expired before this peer got to it.
+                end = std::max(end, bucket.first);
+                while (end - bucket.first < bucket.txs.size() && batch.size() < BATCH_SIZE) {
+                    batch.push_back(bucket.txs[end - bucket.first]);
+                    ++end;
+                    next.push_back(end == bucket.first + bucket.txs.size() ? bucket.end : end);
+                }
+                if (batch.size() == BATCH_SIZE) {
+                    more = true;
+                    break;
+                }
+                end = bucket.end;
+            }
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!fn(batch[i])) return;
+            cursor = next[i];
+        }
+        cursor = std::max(cursor, end);
+        if (!more) return;
+        batch.clear();
+        next.clear();
+    }
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXANNOUNCEQUEUE_H
+#define BITCOIN_NODE_TXANNOUNCEQUEUE_H
+
+#include <sync.h>
+#include <txmempool.h>
+#include <uint256.h>
+
+#include <deque>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Transactions to be announced to peers, shared by all of them.
+ *
+ * Relayed transactions are collected in buckets by the time they were
+ * queued. Once a bucket is closed, the first peer to announce from it looks
+ * its transactions up in the mempool and sorts them (fewest ancestors
+ * first, then by ancestor fee rate), and every peer then walks the sorted
+ * buckets with a cursor of its own. Compared to each peer keeping and sorting
+ * a set of everything it has yet to announce, the lookups and the sorting
+ * are done once per transaction instead of once per transaction and peer.
+ *
+ * Within a bucket transactions are announced in mempool order, so the order
+ * in which they arrived is not revealed; across buckets they are announced
+ * in the order the buckets were closed.
+ */
+class TxAnnouncementQueue
+{
+public:
+    //! Time a bucket stays open for new transactions, in microseconds
+    static constexpr int64_t BUCKET_DURATION = 1000000;
+    //! Buckets are dropped after this long, in microseconds, whether all peers got to them or not
+    static constexpr int64_t MAX_AGE = 10 * 60 * 1000000LL;
+    //! Oldest buckets are dropped when more transactions than this are queued
+    static constexpr size_t MAX_QUEUED = 100000;
+
+    explicit TxAnnouncementQueue(CTxMemPool& pool) : m_pool(pool) {}
+
+    /** Queue txid to be announced to every peer. */
+    void Add(const uint256& txid, int64_t now);
+
+    /** Cursor of a peer that is to announce transactions queued from now on. */
+    uint64_t End() const;
+
+    /**
+     * Visit the transactions after cursor, from buckets closed by now, in the
+     * order they are to be announced, until fn returns false. The cursor is
+     * moved past every transaction fn returned true for. Transactions that
+     * were no longer in the mempool when their bucket was sorted are skipped,
+     * but those that left it since are not: fn has to check for that.
+     * fn is called without the queue locked.
+     */
+    void ForEach(uint64_t& cursor, int64_t now, const std::function<bool(const TxMempoolInfo&)>& fn);
+
+    /** Number of transactions in the queue. */
+    size_t Size() const;
+
+private:
+    //! Transactions copied out of the queue at a time by ForEach
+    static constexpr size_t BATCH_SIZE = 1000;
+
+    struct Bucket
+    {
+        uint64_t first; //!< cursor position of the first transaction
+        uint64_t end;   //!< cursor position after the last transaction
+        int64_t start;  //!< time the bucket was opened
+        bool sorted{false};
+        std::vector<uint256> txids;     //!< queued transactions, until sorted
+        std::vector<TxMempoolInfo> txs; //!< transactions to announce, once sorted
+    };
+
+    void Sort(Bucket& bucket) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void Expire(int64_t now) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    CTxMemPool& m_pool;
+    mutable Mutex m_mutex;
+    std::deque<Bucket> m_buckets GUARDED_BY(m_mutex);
+    uint64_t m_end GUARDED_BY(m_mutex){0};
+    size_t m_queued GUARDED_BY(m_mutex){0};
+};
+
+#endif // BITCOIN_NODE_TXANNOUNCEQUEUE_H
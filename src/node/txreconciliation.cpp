@@ -0,0 +1,174 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+
+#include <crypto/siphash.h>
+#include <hash.h>
+#include <pinsketch.h>
+
+#include <algorithm>
+#include <assert.h>
+
+constexpr int TxReconciliationState::REQUEST_INTERVAL;
+constexpr int TxReconciliationState::REQUEST_TIMEOUT;
+constexpr size_t TxReconciliationState::MAX_SET_SIZE;
+constexpr size_t TxReconciliationState::MAX_SKETCH_CAPACITY;
+constexpr size_t TxReconciliationState::SKETCH_CHECK_CAPACITY;
+
+TxReconciliationState::TxReconciliationState(bool we_initiate, uint64_t local_salt, uint64_t remote_salt) : m_we_initiate(we_initiate)
+{
+    // Both sides derive the same short id keys, whatever the order of the salts.
+    const uint256 key = (CHashWriter(SER_GETHASH, 0) << std::min(local_salt, remote_salt) << std::max(local_salt, remote_salt)).GetHash();
+    m_k0 = key.GetUint64(0);
+    m_k1 = key.GetUint64(1);
+}
+
+bool TxReconciliationState::Add(const uint256& txid)
+{
+    if (m_set.size() >= MAX_SET_SIZE) return false;
+    m_set.insert(txid);
+    return true;
+}
+
+void TxReconciliationState::Remove(const uint256& txid)
+{
+    m_set.erase(txid);
+}
+
+uint32_t TxReconciliationState::ShortId(const uint256& txid) const
+{
+    const uint32_t id = SipHashUint256(m_k0, m_k1, txid);
+    return id == 0 ? 1 : id;
+}
+
+size_t TxReconciliationState::EstimateCapacity(size_t local_size, size_t remote_size)
+{
+    // Beyond the difference in size, assume a quarter of the smaller set is
+    // not in the other one, plus one for a difference to begin with.
+    const size_t difference = std::max(local_size, remote_size) - std::min(local_size, remote_size);
+    return std::min(difference + std::min(local_size, remote_size) / 4 + 1, MAX_SKETCH_CAPACITY);
+}
+
+bool TxReconciliationState::IsValidSketch(const std::vector<unsigned char>& sketch)
+{
+    const size_t capacity = sketch.size() / PinSketch::ELEMENT_SIZE;
+    return sketch.size() % PinSketch::ELEMENT_SIZE == 0 && capacity > SKETCH_CHECK_CAPACITY && capacity <= MAX_SKETCH_CAPACITY + SKETCH_CHECK_CAPACITY;
+}
+
+bool TxReconciliationState::IsRequestDue(int64_t now) const
+{
+    return m_we_initiate && !m_in_progress && m_next_request <= now;
+}
+
+uint32_t TxReconciliationState::StartRequest(int64_t next_request, int64_t deadline)
+{
+    assert(m_we_initiate && !m_in_progress);
+    m_next_request = next_request;
+    m_request_deadline = deadline;
+    Snapshot();
+    return m_snapshot.size();
+}
+
+bool TxReconciliationState::IsRequestExpired(int64_t now) const
+{
+    return m_we_initiate && m_in_progress && m_request_deadline <= now;
+}
+
+void TxReconciliationState::AbandonRequest(std::vector<uint256>& announce)
+{
+    assert(m_we_initiate && m_in_progress);
+    // As when the difference is too large, both sides announce their whole
+    // set: the responder does on our next request.
+    announce.clear();
+    for (const auto& entry : m_snapshot) announce.push_back(entry.second);
+    m_snapshot.clear();
+    m_in_progress = false;
+    ++m_stale_sketches;
+}
+
+bool TxReconciliationState::SkipStaleSketch()
+{
+    assert(m_we_initiate);
+    if (m_stale_sketches == 0) return false;
+    --m_stale_sketches;
+    return true;
+}
+
+bool TxReconciliationState::HandleSketch(const std::vector<unsigned char>& sketch, std::vector<uint256>& announce, std::vector<uint32_t>& request)
+{
+    assert(m_we_initiate && m_in_progress && IsValidSketch(sketch));
+    announce.clear();
+    request.clear();
+
+    PinSketch difference = PinSketch::Deserialize(sketch);
+    PinSketch local(difference.GetCapacity());
+    for (const auto& entry : m_snapshot) local.Add(entry.first);
+    difference.Merge(local);
+
+    std::vector<uint32_t> ids;
+    const bool success = difference.Decode(ids, difference.GetCapacity() - SKETCH_CHECK_CAPACITY);
+    if (success) {
+        for (uint32_t id : ids) {
+            auto it = m_snapshot.find(id);
+            if (it != m_snapshot.end()) {
+                announce.push_back(it->second);
+            } else {
+                request.push_back(id);
+            }
+        }
+    } else {
+        for (const auto& entry : m_snapshot) announce.push_back(entry.second);
+    }
+    m_snapshot.clear();
+    m_in_progress = false;
+    return success;
+}
+
+void TxReconciliationState::HandleRequest(uint32_t remote_size, std::vector<unsigned char>& sketch, std::vector<uint256>& announce)
+{
+    assert(!m_we_initiate);
+    announce.clear();
+    if (m_in_progress) {
+        // The initiator only sends a request once the previous one is finished
+        // or abandoned, and it did not finish this one.
+        for (const auto& entry : m_snapshot) announce.push_back(entry.second);
+        m_snapshot.clear();
+        m_in_progress = false;
+    }
+    Snapshot();
+    PinSketch local(EstimateCapacity(m_snapshot.size(), remote_size) + SKETCH_CHECK_CAPACITY);
+    for (const auto& entry : m_snapshot) local.Add(entry.first);
+    sketch = local.Serialize();
+}
+
+void TxReconciliationState::HandleDiff(bool success, const std::vector<uint32_t>& requested, std::vector<uint256>& announce)
+{
+    assert(!m_we_initiate && m_in_progress);
+    announce.clear();
+    if (success) {
+        for (uint32_t id : requested) {
+            auto it = m_snapshot.find(id);
+            if (it != m_snapshot.end()) announce.push_back(it->second);
+        }
+    } else {
+        for (const auto& entry : m_snapshot) announce.push_back(entry.second);
+    }
+    m_snapshot.clear();
+    m_in_progress = false;
+}
+
+void TxReconciliationState::Snapshot()
+{
+    assert(m_snapshot.empty());
+    for (auto it = m_set.begin(); it != m_set.end();) {
+        // A transaction whose short id collides with another one waits for the next round.
+        if (m_snapshot.emplace(ShortId(*it), *it).second) {
+            it = m_set.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_in_progress = true;
+}
@@ -0,0 +1,147 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXRECONCILIATION_H
+#define BITCOIN_NODE_TXRECONCILIATION_H
+
+#include <uint256.h>
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION = false;
+/** Version of the reconciliation protocol sent in sendrecon */
+static const uint32_t TXRECONCILIATION_PROTOCOL_VERSION = 1;
+
+/**
+ * Transaction relay with one peer by set reconciliation, as an alternative to
+ * announcing every transaction on every connection.
+ *
+ * Instead of being announced right away, transactions go into a set per
+ * peer. Periodically, the side that made the connection (the initiator)
+ * sends the size of its set; the other side (the responder) answers with a
+ * PinSketch of the short ids of its own set, sized for the expected
+ * difference. The initiator merges in the sketch of its set and decodes
+ * their symmetric difference: it announces what the responder is missing
+ * and asks for what it is missing itself. If the difference turns out to be
+ * larger than the sketch, both sides announce their whole set instead.
+ *
+ * Transactions that both sides learned about in time cancel out and are not
+ * announced on this connection at all, so each transaction costs about the
+ * 4 bytes of a sketch element per connection instead of a 36 byte inv.
+ *
+ * Not thread-safe; net_processing keeps it in the peer's CNodeState.
+ */
+class TxReconciliationState
+{
+public:
+    //! Average time between reconciliations with a peer, in seconds
+    static constexpr int REQUEST_INTERVAL = 2;
+    //! Time the responder has to answer a request before the reconciliation is abandoned, in seconds
+    static constexpr int REQUEST_TIMEOUT = 10;
+    //! Transactions beyond this many per peer are announced instead of reconciled
+    static constexpr size_t MAX_SET_SIZE = 3000;
+    //! Most differences a reconciliation can find
+    static constexpr size_t MAX_SKETCH_CAPACITY = 128;
+    //! Capacity a sketch has beyond the differences it is decoded for, to detect larger ones
+    static constexpr size_t SKETCH_CHECK_CAPACITY = 1;
+
+    TxReconciliationState(bool we_initiate, uint64_t local_salt, uint64_t remote_salt);
+
+    bool WeInitiate() const { return m_we_initiate; }
+
+    /** Add a transaction to reconcile. Returns false if the set is full, in which case it is to be announced instead. */
+    bool Add(const uint256& txid);
+
+    /** Forget a transaction the peer is known to have. */
+    void Remove(const uint256& txid);
+
+    size_t GetSetSize() const { return m_set.size(); }
+
+    /** 32-bit short id of a transaction on this connection; never zero. */
+    uint32_t ShortId(const uint256& txid) const;
+
+    /** Differences a responder sizes its sketch for, from the sizes of both sets. */
+    static size_t EstimateCapacity(size_t local_size, size_t remote_size);
+
+    /** Whether a serialized sketch has a size a responder may send. */
+    static bool IsValidSketch(const std::vector<unsigned char>& sketch);
+
+    //! @name Initiator
+    //! @{
+
+    /** Whether a reconciliation is to be started now. */
+    bool IsRequestDue(int64_t now) const;
+
+    /**
+     * Start a reconciliation that the responder is to answer by deadline, and
+     * the next one at next_request; returns the set size to send with the request.
+     */
+    uint32_t StartRequest(int64_t next_request, int64_t deadline);
+
+    /** Whether the responder did not answer the reconciliation in progress by its deadline. */
+    bool IsRequestExpired(int64_t now) const;
+
+    /**
+     * Abandon the reconciliation in progress; announce holds its transactions.
+     * The sketch that may still answer it is to be skipped with SkipStaleSketch().
+     */
+    void AbandonRequest(std::vector<uint256>& announce);
+
+    /** Whether a sketch answers an abandoned reconciliation, in which case it is to be ignored. */
+    bool SkipStaleSketch();
+
+    /**
+     * Reconcile with the responder's sketch. Returns whether the difference
+     * could be decoded; if so, announce holds the transactions the peer is
+     * missing and request the short ids of the ones we are missing,
+     * otherwise announce holds the whole set and request is empty.
+     * Only while IsInProgress(), and with a valid sketch.
+     */
+    bool HandleSketch(const std::vector<unsigned char>& sketch, std::vector<uint256>& announce, std::vector<uint32_t>& request);
+
+    //! @}
+
+    //! @name Responder
+    //! @{
+
+    /**
+     * Answer a request with the sketch of our set. A reconciliation still in
+     * progress was abandoned by the initiator, and announce holds its
+     * transactions; otherwise announce is empty.
+     */
+    void HandleRequest(uint32_t remote_size, std::vector<unsigned char>& sketch, std::vector<uint256>& announce);
+
+    /**
+     * Finish a reconciliation with the initiator's result: the transactions
+     * to announce are the requested ones if it succeeded, and the whole set
+     * otherwise. Only while IsInProgress().
+     */
+    void HandleDiff(bool success, const std::vector<uint32_t>& requested, std::vector<uint256>& announce);
+
+    //! @}
+
+    bool IsInProgress() const { return m_in_progress; }
+
+private:
+    /** Move the set into the snapshot of a reconciliation in progress. */
+    void Snapshot();
+
+    const bool m_we_initiate;
+    uint64_t m_k0, m_k1;
+    //! Transactions to reconcile in the next round
+    std::set<uint256> m_set;
+    //! Transactions of the round in progress, by short id
+    std::map<uint32_t, uint256> m_snapshot;
+    bool m_in_progress{false};
+    int64_t m_next_request{0};
+    int64_t m_request_deadline{0};
+    //! Abandoned reconciliations whose sketch may still arrive; sketches arrive in the order of the requests
+    uint32_t m_stale_sketches{0};
+};
+
+#endif // BITCOIN_NODE_TXRECONCILIATION_H
@@ -0,0 +1,249 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pinsketch.h>
+
+#include <crypto/common.h>
+#include <random.h>
+
+#include <assert.h>
+
+constexpr size_t PinSketch::ELEMENT_SIZE;
+
+namespace {
+
+//! Polynomial over GF(2^32), lowest degree coefficient first and without leading zeros
+typedef std::vector<uint32_t> Poly;
+
+//! Multiplication in GF(2^32), modulo the irreducible x^32 + x^7 + x^3 + x^2 + 1
+uint32_t Mul(uint32_t a, uint32_t b)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < 32; ++i) {
+        r ^= ((uint64_t)a << i) & -(uint64_t)((b >> i) & 1);
+    }
+    // The first round of reduction can carry past bit 32 again.
+    for (int i = 0; i < 2; ++i) {
+        const uint64_t hi = r >> 32;
+        r = (r & 0xffffffff) ^ hi ^ (hi << 2) ^ (hi << 3) ^ (hi << 7);
+    }
+    return r;
+}
+
+uint32_t Inv(uint32_t a)
+{
+    // a^(2^32 - 2), with 2^32 - 2 = 2 + 4 + ... + 2^31
+    uint32_t r = 1;
+    for (int i = 1; i < 32; ++i) {
+        a = Mul(a, a);
+        r = Mul(r, a);
+    }
+    return r;
+}
+
+void Trim(Poly& p)
+{
+    while (!p.empty() && p.back() == 0) p.pop_back();
+}
+
+//! Reduce p modulo a monic m of degree at least one.
+void Mod(Poly& p, const Poly& m)
+{
+    const size_t deg = m.size() - 1;
+    for (size_t i = p.size(); i-- > deg;) {
+        const uint32_t c = p[i];
+        if (c == 0) continue;
+        for (size_t j = 0; j <= deg; ++j) {
+            p[i - deg + j] ^= Mul(c, m[j]);
+        }
+    }
+    if (p.size() > deg) p.resize(deg);
+    Trim(p);
+}
+
+//! Quotient of a by a monic b that divides it.
+Poly Div(Poly a, const Poly& b)
+{
+    const size_t deg = b.size() - 1;
+    Poly q(a.size() - deg);
+    for (size_t i = a.size(); i-- > deg;) {
+        const uint32_t c = a[i];
+        q[i - deg] = c;
+        if (c == 0) continue;
+        for (size_t j = 0; j <= deg; ++j) {
+            a[i - deg + j] ^= Mul(c, b[j]);
+        }
+    }
+    return q;
+}
+
+//! Square p modulo m; squaring is linear in characteristic 2.
+Poly SqrMod(const Poly& p, const Poly& m)
+{
+    Poly r(p.empty() ? 0 : 2 * p.size() - 1);
+    for (size_t i = 0; i < p.size(); ++i) {
+        r[2 * i] = Mul(p[i], p[i]);
+    }
+    Mod(r, m);
+    return r;
+}
+
+void MakeMonic(Poly& p)
+{
+    const uint32_t inv = Inv(p.back());
+    for (uint32_t& c : p) c = Mul(c, inv);
+}
+
+//! Monic greatest common divisor of a non-zero a and b.
+Poly Gcd(Poly a, Poly b)
+{
+    while (!b.empty()) {
+        MakeMonic(b);
+        Mod(a, b);
+        std::swap(a, b);
+    }
+    MakeMonic(a);
+    return a;
+}
+
+/**
+ * Find the roots of a monic f whose roots are all distinct and in GF(2^32),
+ * by splitting it with gcd(f, Tr(beta * x)) for random beta (Berlekamp's trace
+ * algorithm).
+ */
+bool FindRoots(const Poly& f, std::vector<uint32_t>& roots, FastRandomContext& rng)
+{
+    if (f.size() == 1) return true;
+    if (f.size() == 2) {
+        roots.push_back(f[0]);
+        return true;
+    }
+    // Each attempt splits f with probability at least a half.
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        const uint32_t beta = rng.rand32();
+        if (beta == 0) continue;
+        Poly t{0, beta};
+        Poly trace = t;
+        for (int i = 1; i < 32; ++i) {
+            t = SqrMod(t, f);
+            if (trace.size() < t.size()) trace.resize(t.size());
+            for (size_t j = 0; j < t.size(); ++j) trace[j] ^= t[j];
+        }
+        Trim(trace);
+        if (trace.empty()) continue;
+        const Poly g = Gcd(f, trace);
+        if (g.size() == 1 || g.size() == f.size()) continue;
+        return FindRoots(g, roots, rng) && FindRoots(Div(f, g), roots, rng);
+    }
+    return false;
+}
+
+} // namespace
+
+void PinSketch::Add(uint32_t element)
+{
+    assert(element != 0);
+    const uint32_t square = Mul(element, element);
+    uint32_t power = element;
+    for (uint32_t& syndrome : m_syndromes) {
+        syndrome ^= power;
+        power = Mul(power, square);
+    }
+}
+
+void PinSketch::Merge(const PinSketch& other)
+{
+    assert(other.m_syndromes.size() == m_syndromes.size());
+    for (size_t i = 0; i < m_syndromes.size(); ++i) {
+        m_syndromes[i] ^= other.m_syndromes[i];
+    }
+}
+
+std::vector<unsigned char> PinSketch::Serialize() const
+{
+    std::vector<unsigned char> data(m_syndromes.size() * ELEMENT_SIZE);
+    for (size_t i = 0; i < m_syndromes.size(); ++i) {
+        WriteLE32(data.data() + i * ELEMENT_SIZE, m_syndromes[i]);
+    }
+    return data;
+}
+
+PinSketch PinSketch::Deserialize(const std::vector<unsigned char>& data)
+{
+    assert(data.size() % ELEMENT_SIZE == 0);
+    PinSketch sketch(data.size() / ELEMENT_SIZE);
+    for (size_t i = 0; i < sketch.m_syndromes.size(); ++i) {
+        sketch.m_syndromes[i] = ReadLE32(data.data() + i * ELEMENT_SIZE);
+    }
+    return sketch;
+}
+
+bool PinSketch::Decode(std::vector<uint32_t>& elements, size_t max_elements) const
+{
+    assert(max_elements <= m_syndromes.size());
+    elements.clear();
+
+    // Power sums s_1 .. s_2m; the even ones follow from s_2k = s_k^2.
+    std::vector<uint32_t> sums(2 * max_elements);
+    for (size_t i = 0; i < sums.size(); ++i) {
+        sums[i] = (i % 2 == 0) ? m_syndromes[i / 2] : Mul(sums[i / 2], sums[i / 2]);
+    }
+
+    // Berlekamp-Massey gives the connection polynomial of the power sums,
+    // which is the product of (1 - e * x) over the elements e.
+    Poly conn{1}, prev{1};
+    size_t len = 0, shift = 1;
+    uint32_t prev_discrepancy = 1;
+    for (size_t n = 0; n < sums.size(); ++n) {
+        uint32_t discrepancy = sums[n];
+        for (size_t i = 1; i <= len && i < conn.size(); ++i) {
+            discrepancy ^= Mul(conn[i], sums[n - i]);
+        }
+        if (discrepancy == 0) {
+            ++shift;
+            continue;
+        }
+        const uint32_t coef = Mul(discrepancy, Inv(prev_discrepancy));
+        const Poly old = conn;
+        if (conn.size() < prev.size() + shift) conn.resize(prev.size() + shift);
+        for (size_t i = 0; i < prev.size(); ++i) {
+            conn[i + shift] ^= Mul(coef, prev[i]);
+        }
+        if (2 * len <= n) {
+            len = n + 1 - len;
+            prev = old;
+            prev_discrepancy = discrepancy;
+            shift = 1;
+        } else {
+            ++shift;
+        }
+    }
+    Trim(conn);
+    if (len > max_elements || conn.size() != len + 1) return false;
+    if (len == 0) return true;
+
+    // Its reverse is monic and has the elements themselves as roots.
+    const Poly locator(conn.rbegin(), conn.rend());
+    if (locator.size() > 2) {
+        // All roots are distinct and in the field iff the locator divides x^(2^32) - x.
+        Poly t{0, 1};
+        for (int i = 0; i < 32; ++i) t = SqrMod(t, locator);
+        if (t != Poly{0, 1}) return false;
+    }
+    FastRandomContext rng;
+    std::vector<uint32_t> roots;
+    if (!FindRoots(locator, roots, rng) || roots.size() != len) return false;
+
+    // The roots reproduce the power sums they were found from; the syndromes
+    // beyond those tell whether there were more elements than that.
+    PinSketch check(m_syndromes.size());
+    for (uint32_t root : roots) {
+        if (root == 0) return false;
+        check.Add(root);
+    }
+    if (check.m_syndromes != m_syndromes) return false;
+
+    elements = std::move(roots);
+    return true;
+}
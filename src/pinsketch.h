@@ -0,0 +1,61 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PINSKETCH_H
+#define BITCOIN_PINSKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * A set sketch over 32-bit elements (the PinSketch construction, as used by
+ * the minisketch library).
+ *
+ * A sketch of capacity c holds the odd power sums x, x^3, ..., x^(2c-1) of its
+ * elements in GF(2^32), which takes 4 bytes per unit of capacity regardless of
+ * the size of the set. Adding an element that is already in the sketch removes
+ * it again, so merging the sketches of two sets gives the sketch of their
+ * symmetric difference, and that can be decoded as long as it has no more
+ * than c elements.
+ */
+class PinSketch
+{
+public:
+    //! Bytes a serialized sketch takes per unit of capacity
+    static constexpr size_t ELEMENT_SIZE = 4;
+
+    explicit PinSketch(size_t capacity) : m_syndromes(capacity) {}
+
+    size_t GetCapacity() const { return m_syndromes.size(); }
+
+    /** Add (or remove, if it is already in the sketch) a non-zero element. */
+    void Add(uint32_t element);
+
+    /** Merge in another sketch of the same capacity. */
+    void Merge(const PinSketch& other);
+
+    std::vector<unsigned char> Serialize() const;
+
+    /** Read a sketch back; its capacity follows from the size of data, which must be a multiple of ELEMENT_SIZE. */
+    static PinSketch Deserialize(const std::vector<unsigned char>& data);
+
+    /**
+     * Recover the elements of the sketch, if there are at most max_elements
+     * (no more than the capacity) of them; otherwise return false and leave
+     * elements empty.
+     *
+     * More elements than max_elements are not always detected: a sketch with
+     * more elements than its capacity may decode to a different, smaller
+     * set. Each unit of capacity beyond max_elements is used to check the
+     * result instead, and makes that about 2^32 times less likely.
+     */
+    bool Decode(std::vector<uint32_t>& elements, size_t max_elements) const;
+    bool Decode(std::vector<uint32_t>& elements) const { return Decode(elements, GetCapacity()); }
+
+private:
+    std::vector<uint32_t> m_syndromes;
+};
+
+#endif // BITCOIN_PINSKETCH_H
@@ -8,6 +8,7 @@
 
 #include <clientversion.h>
 #include <primitives/transaction.h>
+#include <scheduler.h>
 #include <streams.h>
 #include <txmempool.h>
 #include <util/system.h>
@@ -196,14 +197,15 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
 
 void TxConfirmStats::UpdateMovingAverages()
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay;
-        for (unsigned int i = 0; i < failAvg.size(); i++)
-            failAvg[i][j] = failAvg[i][j] * decay;
-        avg[j] = avg[j] * decay;
-        txCtAvg[j] = txCtAvg[j] * decay;
+    // Walk each vector contiguously so the compiler can vectorize the loops.
+    for (std::vector<double>& row : confAvg) {
+        for (double& val : row) val *= decay;
+    }
+    for (std::vector<double>& row : failAvg) {
+        for (double& val : row) val *= decay;
     }
+    for (double& val : avg) val *= decay;
+    for (double& val : txCtAvg) val *= decay;
 }
 
 // returns -1 on error conditions
@@ -475,9 +477,13 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
 // tracked. Txs that were part of a block have already been removed in
 // processBlockTx to ensure they are never double tracked, but it is
 // of no harm to try to remove them again.
-bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
+void CBlockPolicyEstimator::removeTx(const uint256& hash, bool inBlock)
+{
+    QueueUpdate({QueuedUpdate::Type::TX_REMOVED, 0, inBlock, {{hash, 0, CFeeRate()}}});
+}
+
+bool CBlockPolicyEstimator::RemoveTx(const uint256& hash, bool inBlock)
 {
-    LOCK(m_cs_fee_estimator);
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
@@ -512,11 +518,72 @@ CBlockPolicyEstimator::~CBlockPolicyEstimator()
 {
 }
 
-void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate)
+void CBlockPolicyEstimator::StartBackgroundUpdates(CScheduler& scheduler)
+{
+    LOCK(m_cs_queue);
+    m_scheduler = &scheduler;
+}
+
+void CBlockPolicyEstimator::QueueUpdate(QueuedUpdate&& update)
+{
+    {
+        LOCK(m_cs_queue);
+        m_queue.push_back(std::move(update));
+        if (m_scheduler) {
+            if (!m_apply_scheduled) {
+                m_apply_scheduled = true;
+                m_scheduler->schedule([this] { ApplyQueuedUpdates(); });
+            }
+            return;
+        }
+    }
+    ApplyQueuedUpdates();
+}
+
+void CBlockPolicyEstimator::ApplyQueuedUpdates()
 {
     LOCK(m_cs_fee_estimator);
-    unsigned int txHeight = entry.GetHeight();
-    uint256 hash = entry.GetTx().GetHash();
+    while (true) {
+        QueuedUpdate update;
+        {
+            LOCK(m_cs_queue);
+            if (m_queue.empty()) {
+                m_apply_scheduled = false;
+                return;
+            }
+            update = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        switch (update.type) {
+        case QueuedUpdate::Type::TX_ADDED:
+            ProcessTransaction(update.txs[0], update.flag);
+            break;
+        case QueuedUpdate::Type::TX_REMOVED:
+            RemoveTx(update.txs[0].hash, update.flag);
+            break;
+        case QueuedUpdate::Type::BLOCK:
+            ProcessBlock(update.blockHeight, update.txs);
+            break;
+        }
+    }
+}
+
+void CBlockPolicyEstimator::FlushQueuedUpdates()
+{
+    ApplyQueuedUpdates();
+}
+
+void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate)
+{
+    // Feerates are stored and reported as BTC-per-kb:
+    QueueUpdate({QueuedUpdate::Type::TX_ADDED, 0, validFeeEstimate,
+                 {{entry.GetTx().GetHash(), entry.GetHeight(), CFeeRate(entry.GetFee(), entry.GetTxSize())}}});
+}
+
+void CBlockPolicyEstimator::ProcessTransaction(const QueuedTx& tx, bool validFeeEstimate)
+{
+    unsigned int txHeight = tx.height;
+    const uint256& hash = tx.hash;
     if (mapMemPoolTxs.count(hash)) {
         LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error mempool tx %s already being tracked\n",
                  hash.ToString().c_str());
@@ -539,8 +606,7 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     }
     trackedTxs++;
 
-    // Feerates are stored and reported as BTC-per-kb:
-    CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
+    const CFeeRate& feeRate = tx.feeRate;
 
     mapMemPoolTxs[hash].blockHeight = txHeight;
     unsigned int bucketIndex = feeStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
@@ -551,9 +617,9 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     assert(bucketIndex == bucketIndex3);
 }
 
-bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
+bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const QueuedTx& tx)
 {
-    if (!removeTx(entry->GetTx().GetHash(), true)) {
+    if (!RemoveTx(tx.hash, true)) {
         // This transaction wasn't being tracked for fee estimation
         return false;
     }
@@ -561,7 +627,7 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     // How many blocks did it take for miners to include this transaction?
     // blocksToConfirm is 1-based, so a transaction included in the earliest
     // possible block has confirmation count of 1
-    int blocksToConfirm = nBlockHeight - entry->GetHeight();
+    int blocksToConfirm = nBlockHeight - tx.height;
     if (blocksToConfirm <= 0) {
         // This can't happen because we don't process transactions from a block with a height
         // lower than our greatest seen height
@@ -569,8 +635,7 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
-    // Feerates are stored and reported as BTC-per-kb:
-    CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
+    const CFeeRate& feeRate = tx.feeRate;
 
     feeStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     shortStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
@@ -581,7 +646,17 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
 void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
                                          std::vector<const CTxMemPoolEntry*>& entries)
 {
-    LOCK(m_cs_fee_estimator);
+    QueuedUpdate update{QueuedUpdate::Type::BLOCK, nBlockHeight, false, {}};
+    update.txs.reserve(entries.size());
+    for (const CTxMemPoolEntry* entry : entries) {
+        // Feerates are stored and reported as BTC-per-kb:
+        update.txs.push_back({entry->GetTx().GetHash(), entry->GetHeight(), CFeeRate(entry->GetFee(), entry->GetTxSize())});
+    }
+    QueueUpdate(std::move(update));
+}
+
+void CBlockPolicyEstimator::ProcessBlock(unsigned int nBlockHeight, const std::vector<QueuedTx>& txs)
+{
     if (nBlockHeight <= nBestSeenHeight) {
         // Ignore side chains and re-orgs; assuming they are random
         // they don't affect the estimate.
@@ -608,8 +683,8 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     unsigned int countedTxs = 0;
     // Update averages with data points from current block
-    for (const auto& entry : entries) {
-        if (processBlockTx(nBlockHeight, entry))
+    for (const QueuedTx& tx : txs) {
+        if (processBlockTx(nBlockHeight, tx))
             countedTxs++;
     }
 
@@ -620,7 +695,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
 
     LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy estimates updated by %u of %u block txs, since last block %u of %u tracked, mempool map size %u, max target %u from %s\n",
-             countedTxs, entries.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size(),
+             countedTxs, txs.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size(),
              MaxUsableEstimate(), HistoricalBlockSpan() > BlockSpan() ? "historical" : "current");
 
     trackedTxs = 0;
@@ -950,12 +1025,19 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
 
 void CBlockPolicyEstimator::FlushUnconfirmed() {
     int64_t startclear = GetTimeMicros();
+    {
+        // Called on shutdown, after the scheduler has stopped: apply what is
+        // left in the queue here and anything queued later right away.
+        LOCK(m_cs_queue);
+        m_scheduler = nullptr;
+    }
     LOCK(m_cs_fee_estimator);
+    ApplyQueuedUpdates();
     size_t num_entries = mapMemPoolTxs.size();
     // Remove every entry in mapMemPoolTxs
     while (!mapMemPoolTxs.empty()) {
         auto mi = mapMemPoolTxs.begin();
-        removeTx(mi->first, false); // this calls erase() on mapMemPoolTxs
+        RemoveTx(mi->first, false); // this calls erase() on mapMemPoolTxs
     }
     int64_t endclear = GetTimeMicros();
     LogPrint(BCLog::ESTIMATEFEE, "Recorded %u unconfirmed txs from mempool in %gs\n", num_entries, (endclear - startclear)*0.000001);
@@ -11,12 +11,14 @@
 #include <random.h>
 #include <sync.h>
 
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 class CAutoFile;
+class CScheduler;
 class CFeeRate;
 class CTxMemPoolEntry;
 class CTxMemPool;
@@ -185,6 +187,17 @@ public:
     CBlockPolicyEstimator();
     ~CBlockPolicyEstimator();
 
+    /**
+     * Apply updates in the background on the given scheduler from now on.
+     * processBlock, processTransaction and removeTx then only queue their
+     * update, so callers holding the mempool lock are not charged for the
+     * bookkeeping. Estimates lag behind by the updates still queued.
+     */
+    void StartBackgroundUpdates(CScheduler& scheduler);
+
+    /** Apply all queued updates now, e.g. before the estimates are saved */
+    void FlushQueuedUpdates();
+
     /** Process all the transactions that have been included in a block */
     void processBlock(unsigned int nBlockHeight,
                       std::vector<const CTxMemPoolEntry*>& entries);
@@ -193,7 +206,7 @@ public:
     void processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate);
 
     /** Remove a transaction from the mempool tracking stats*/
-    bool removeTx(uint256 hash, bool inBlock);
+    void removeTx(const uint256& hash, bool inBlock);
 
     /** DEPRECATED. Return a feerate estimate */
     CFeeRate estimateFee(int confTarget) const;
@@ -224,6 +237,37 @@ public:
     unsigned int HighestTargetTracked(FeeEstimateHorizon horizon) const;
 
 private:
+    /** The parts of a mempool entry the estimator needs, copied when an update is queued */
+    struct QueuedTx
+    {
+        uint256 hash;
+        unsigned int height;
+        CFeeRate feeRate;
+    };
+
+    /** A processTransaction, removeTx or processBlock call waiting to be applied */
+    struct QueuedUpdate
+    {
+        enum class Type { TX_ADDED, TX_REMOVED, BLOCK } type;
+        //! Block height for BLOCK updates
+        unsigned int blockHeight;
+        //! validFeeEstimate for TX_ADDED, inBlock for TX_REMOVED
+        bool flag;
+        //! The transaction for TX_ADDED and TX_REMOVED (only its hash), the block's for BLOCK
+        std::vector<QueuedTx> txs;
+    };
+
+    /** Queue an update and apply it now, or later in the background if started */
+    void QueueUpdate(QueuedUpdate&& update);
+    void ApplyQueuedUpdates();
+
+    //! Updates are always applied in the order they were queued: appending
+    //! only needs m_cs_queue, applying holds m_cs_fee_estimator throughout.
+    Mutex m_cs_queue;
+    std::deque<QueuedUpdate> m_queue GUARDED_BY(m_cs_queue);
+    CScheduler* m_scheduler GUARDED_BY(m_cs_queue){nullptr};
+    bool m_apply_scheduled GUARDED_BY(m_cs_queue){false};
+
     mutable CCriticalSection m_cs_fee_estimator;
 
     unsigned int nBestSeenHeight GUARDED_BY(m_cs_fee_estimator);
@@ -252,8 +296,14 @@ private:
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
 
+    /** Process a transaction accepted to the mempool*/
+    void ProcessTransaction(const QueuedTx& tx, bool validFeeEstimate) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Remove a transaction from the mempool tracking stats, returns whether it was tracked*/
+    bool RemoveTx(const uint256& hash, bool inBlock) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Process all the transactions that have been included in a block */
+    void ProcessBlock(unsigned int nBlockHeight, const std::vector<QueuedTx>& txs) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Process a transaction confirmed in a block*/
-    bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    bool processBlockTx(unsigned int nBlockHeight, const QueuedTx& tx) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
@@ -94,7 +94,14 @@ public:
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
         READWRITEAS(CBlockHeader, *this);
-        READWRITE(vtx);
+        if (ser_action.ForRead()) {
+            // Hash all transactions at once rather than as each is read.
+            std::vector<CMutableTransaction> txs;
+            READWRITE(txs);
+            vtx = MakeTransactionRefs(std::move(txs));
+        } else {
+            READWRITE(vtx);
+        }
     }
 
     void SetNull()
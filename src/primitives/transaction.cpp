@@ -5,7 +5,9 @@
 
 #include <primitives/transaction.h>
 
+#include <crypto/sha256.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
@@ -79,6 +81,55 @@ uint256 CTransaction::ComputeWitnessHash() const
 CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash{}, m_witness_hash{} {}
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const uint256& hash_in, const uint256& witness_hash) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{hash_in}, m_witness_hash{witness_hash} {}
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs)
+{
+    std::vector<CTransactionRef> ret;
+    ret.reserve(txs.size());
+    if (txs.size() < 2 || SHA256MultiLanes() < 4) {
+        // Two lanes (with SHA-NI) save less than serializing everything into
+        // a buffer first costs.
+        for (CMutableTransaction& tx : txs) {
+            ret.push_back(MakeTransactionRef(std::move(tx)));
+        }
+        return ret;
+    }
+
+    // Serialize all transactions, and those with witnesses once more with
+    // them, one after the other.
+    std::vector<unsigned char> data;
+    std::vector<size_t> ends;
+    std::vector<size_t> witness_index(txs.size());
+    ends.reserve(txs.size());
+    for (const CMutableTransaction& tx : txs) {
+        CVectorWriter(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, data, data.size(), tx);
+        ends.push_back(data.size());
+    }
+    for (size_t i = 0; i < txs.size(); ++i) {
+        witness_index[i] = i;
+        if (txs[i].HasWitness()) {
+            CVectorWriter(SER_GETHASH, 0, data, data.size(), txs[i]);
+            witness_index[i] = ends.size();
+            ends.push_back(data.size());
+        }
+    }
+
+    std::vector<const unsigned char*> inputs(ends.size());
+    std::vector<size_t> lengths(ends.size());
+    for (size_t i = 0; i < ends.size(); ++i) {
+        const size_t begin = i == 0 ? 0 : ends[i - 1];
+        inputs[i] = data.data() + begin;
+        lengths[i] = ends[i] - begin;
+    }
+    std::vector<uint256> hashes(ends.size());
+    SHA256DMulti(hashes.data()->begin(), inputs.data(), lengths.data(), hashes.size());
+
+    for (size_t i = 0; i < txs.size(); ++i) {
+        ret.push_back(std::make_shared<const CTransaction>(std::move(txs[i]), hashes[i], hashes[witness_index[i]]));
+    }
+    return ret;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -304,6 +304,8 @@ public:
     /** Convert a CMutableTransaction into a CTransaction. */
     explicit CTransaction(const CMutableTransaction &tx);
     CTransaction(CMutableTransaction &&tx);
+    /** Convert a CMutableTransaction whose txid and wtxid have already been computed (see MakeTransactionRefs). */
+    CTransaction(CMutableTransaction &&tx, const uint256& hash, const uint256& witness_hash);
 
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -409,4 +411,11 @@ typedef std::shared_ptr<const CTransaction> CTransactionRef;
 static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/**
+ * Convert the transactions of a block (or any batch of them) into
+ * CTransactionRefs, computing their txids and wtxids together in parallel
+ * SHA256 lanes where the CPU has enough of them.
+ */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
@@ -238,6 +238,33 @@ extern const char *GETBLOCKTXN;
  * @since protocol version 70014 as described by BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * Contains a 4-byte reconciliation protocol version and an 8-byte salt.
+ * Sent between version and verack to offer transaction relay by set
+ * reconciliation; it is used on the connection if both sides send it.
+ * @since protocol version 70016
+ */
+extern const char *SENDRECON;
+/**
+ * Contains the 4-byte size of the sender's reconciliation set.
+ * Sent by the side that made the connection to start a reconciliation.
+ * Peer should respond with "sketch" message.
+ * @since protocol version 70016
+ */
+extern const char *REQRECON;
+/**
+ * Contains a serialized sketch of the sender's reconciliation set.
+ * Sent in response to a "reqrecon" message.
+ * @since protocol version 70016
+ */
+extern const char *SKETCH;
+/**
+ * Contains a 1-byte success flag and the short ids of the transactions the
+ * sender is missing. Sent after decoding a "sketch"; peer should announce
+ * the requested transactions, or its whole set if decoding failed.
+ * @since protocol version 70016
+ */
+extern const char *RECONCILDIFF;
 };
 
 /* Get a vector of all valid message types (see above) */
@@ -245,6 +245,24 @@ bool CPubKey::Derive(CPubKey& pubkeyChild, ChainCode &ccChild, unsigned int nChi
     return true;
 }
 
+bool CPubKey::ComputeECDHSecret(const unsigned char* seckey, uint256& secret) const {
+    if (!IsValid()) {
+        return false;
+    }
+    secp256k1_pubkey pubkey;
+    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
+        return false;
+    }
+    if (!secp256k1_ec_pubkey_tweak_mul(secp256k1_context_verify, &pubkey, seckey)) {
+        return false;
+    }
+    unsigned char point[COMPRESSED_PUBLIC_KEY_SIZE];
+    size_t pointlen = COMPRESSED_PUBLIC_KEY_SIZE;
+    secp256k1_ec_pubkey_serialize(secp256k1_context_verify, point, &pointlen, &pubkey, SECP256K1_EC_COMPRESSED);
+    CSHA256().Write(point, pointlen).Finalize(secret.begin());
+    return true;
+}
+
 void CExtPubKey::Encode(unsigned char code[BIP32_EXTKEY_SIZE]) const {
     code[0] = nDepth;
     memcpy(code+1, vchFingerprint, 4);
@@ -271,6 +289,40 @@ bool CExtPubKey::Derive(CExtPubKey &out, unsigned int _nChild) const {
     return pubkey.Derive(out.pubkey, out.chaincode, _nChild, chaincode);
 }
 
+bool CExtPubKey::DeriveMulti(std::vector<CExtPubKey>& out, const std::vector<unsigned int>& children) const {
+    assert(pubkey.IsValid());
+    assert(pubkey.size() == CPubKey::COMPRESSED_PUBLIC_KEY_SIZE);
+    out.resize(children.size());
+    if (children.empty()) return true;
+    for (unsigned int child : children) {
+        assert((child >> 31) == 0);
+    }
+    std::vector<unsigned char> hashes(64 * children.size());
+    BIP32HashMulti(chaincode, children.data(), children.size(), *pubkey.begin(), pubkey.begin() + 1, hashes.data());
+    secp256k1_pubkey parent;
+    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parent, pubkey.begin(), pubkey.size())) {
+        return false;
+    }
+    const CKeyID id = pubkey.GetID();
+    for (size_t i = 0; i < children.size(); ++i) {
+        const unsigned char* hash = hashes.data() + 64 * i;
+        CExtPubKey& child = out[i];
+        child.nDepth = nDepth + 1;
+        memcpy(&child.vchFingerprint[0], &id, 4);
+        child.nChild = children[i];
+        memcpy(child.chaincode.begin(), hash + 32, 32);
+        secp256k1_pubkey point = parent;
+        if (!secp256k1_ec_pubkey_tweak_add(secp256k1_context_verify, &point, hash)) {
+            return false;
+        }
+        unsigned char pub[CPubKey::COMPRESSED_PUBLIC_KEY_SIZE];
+        size_t publen = CPubKey::COMPRESSED_PUBLIC_KEY_SIZE;
+        secp256k1_ec_pubkey_serialize(secp256k1_context_verify, pub, &publen, &point, SECP256K1_EC_COMPRESSED);
+        child.pubkey.Set(pub, pub + publen);
+    }
+    return true;
+}
+
 /* static */ bool CPubKey::CheckLowS(const std::vector<unsigned char>& vchSig) {
     secp256k1_ecdsa_signature sig;
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
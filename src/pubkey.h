@@ -201,6 +201,14 @@ public:
 
     //! Derive BIP32 child pubkey.
     bool Derive(CPubKey& pubkeyChild, ChainCode &ccChild, unsigned int nChild, const ChainCode& cc) const;
+
+    /**
+     * Elliptic curve Diffie-Hellman: the SHA256 of the compressed encoding of
+     * this key's point multiplied by the 32-byte private key seckey. Both
+     * sides get the same secret from their own private key and the public
+     * key of the other.
+     */
+    bool ComputeECDHSecret(const unsigned char* seckey, uint256& secret) const;
 };
 
 struct CExtPubKey {
@@ -222,6 +230,8 @@ struct CExtPubKey {
     void Encode(unsigned char code[BIP32_EXTKEY_SIZE]) const;
     void Decode(const unsigned char code[BIP32_EXTKEY_SIZE]);
     bool Derive(CExtPubKey& out, unsigned int nChild) const;
+    //! Derive several (unhardened) children at once, sharing the work on the parent and hashing in parallel lanes where possible.
+    bool DeriveMulti(std::vector<CExtPubKey>& out, const std::vector<unsigned int>& children) const;
 
     void Serialize(CSizeComputer& s) const
     {
@@ -21,9 +21,11 @@
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <script/sigcache.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -53,6 +55,9 @@ struct CUpdatedBlock
     int height;
 };
 
+//! Mempool entries described per lock of the pool when streaming getrawmempool
+static const size_t MEMPOOL_STREAM_BATCH_SIZE = 1000;
+
 static Mutex cs_blockchange;
 static std::condition_variable cond_blockchange;
 static CUpdatedBlock latestblock;
@@ -117,6 +122,29 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
+void blockToJSON(const CBlock& block, const UniValue& summary, JSONStreamWriter& stream)
+{
+    // Take the other fields from the summary so both variants stay in sync;
+    // only the transactions are large enough to be worth streaming.
+    const std::vector<std::string>& keys = summary.getKeys();
+    stream.BeginObject();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] != "tx") {
+            stream.KeyValue(keys[i], summary[i]);
+            continue;
+        }
+        stream.Key("tx");
+        stream.BeginArray();
+        for (const auto& tx : block.vtx) {
+            UniValue objTx(UniValue::VOBJ);
+            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
+            stream.Value(objTx);
+        }
+        stream.EndArray();
+    }
+    stream.EndObject();
+}
+
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
 {
     UniValue result(UniValue::VOBJ);
@@ -451,9 +479,8 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
 
     UniValue spent(UniValue::VARR);
     const CTxMemPool::txiter& it = pool.mapTx.find(tx.GetHash());
-    const CTxMemPool::setEntries& setChildren = pool.GetMemPoolChildren(it);
-    for (CTxMemPool::txiter childiter : setChildren) {
-        spent.push_back(childiter->GetTx().GetHash().ToString());
+    for (const CTxMemPoolEntry* child : pool.GetMemPoolChildren(it)) {
+        spent.push_back(child->GetTx().GetHash().ToString());
     }
 
     info.pushKV("spentby", spent);
@@ -494,6 +521,34 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
     }
 }
 
+void MempoolToJSON(const CTxMemPool& pool, JSONStreamWriter& stream)
+{
+    // Writing to the stream waits for the client, so it must not hold
+    // pool.cs: describe the entries in batches under the lock, and write each
+    // batch after releasing it. Entries removed in between are left out.
+    std::vector<uint256> txids;
+    pool.queryHashes(txids);
+    std::vector<std::pair<std::string, UniValue>> batch;
+    stream.BeginObject();
+    for (size_t start = 0; start < txids.size(); start += MEMPOOL_STREAM_BATCH_SIZE) {
+        const size_t end = std::min(txids.size(), start + MEMPOOL_STREAM_BATCH_SIZE);
+        batch.clear();
+        {
+            LOCK(pool.cs);
+            for (size_t i = start; i < end; ++i) {
+                const auto it = pool.mapTx.find(txids[i]);
+                if (it == pool.mapTx.end()) continue;
+                batch.emplace_back(txids[i].ToString(), UniValue(UniValue::VOBJ));
+                entryToJSON(pool, batch.back().second, *it);
+            }
+        }
+        for (const auto& entry : batch) {
+            stream.KeyValue(entry.first, entry.second);
+        }
+    }
+    stream.EndObject();
+}
+
 static UniValue getrawmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -526,6 +581,10 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
+    if (fVerbose && request.resultStream) {
+        MempoolToJSON(::mempool, *request.resultStream);
+        return NullUniValue;
+    }
     return MempoolToJSON(::mempool, fVerbose);
 }
 
@@ -880,8 +939,6 @@ static UniValue getblock(const JSONRPCRequest& request)
                 },
             }.ToString());
 
-    LOCK(cs_main);
-
     uint256 hash(ParseHashV(request.params[0], "blockhash"));
 
     int verbosity = 1;
@@ -892,22 +949,35 @@ static UniValue getblock(const JSONRPCRequest& request)
             verbosity = request.params[1].get_bool() ? 1 : 0;
     }
 
-    const CBlockIndex* pblockindex = LookupBlockIndex(hash);
-    if (!pblockindex) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-    }
+    CBlock block;
+    UniValue summary;
+    {
+        LOCK(cs_main);
 
-    const CBlock block = GetBlockChecked(pblockindex);
+        const CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
 
-    if (verbosity <= 0)
-    {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        block = GetBlockChecked(pblockindex);
+
+        if (verbosity <= 0)
+        {
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+            ssBlock << block;
+            std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+            return strHex;
+        }
+
+        if (verbosity < 2 || !request.resultStream) {
+            return blockToJSON(block, chainActive.Tip(), pblockindex, verbosity >= 2);
+        }
+        summary = blockToJSON(block, chainActive.Tip(), pblockindex, false);
     }
 
-    return blockToJSON(block, chainActive.Tip(), pblockindex, verbosity >= 2);
+    // Writing to the stream waits for the client, so do it without cs_main.
+    blockToJSON(block, summary, *request.resultStream);
+    return NullUniValue;
 }
 
 struct CCoinsStats
@@ -2246,12 +2316,12 @@ UniValue scantxoutset(const JSONRPCRequest& request)
                 range.first = 0;
                 range.second = 0;
             }
-            for (int i = range.first; i <= range.second; ++i) {
-                std::vector<CScript> scripts;
-                if (!desc->Expand(i, provider, scripts, provider)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys: '%s'", desc_str));
-                }
-                for (const auto& script : scripts) {
+            std::vector<std::vector<CScript>> range_scripts;
+            if (!desc->ExpandRange(range.first, range.second + 1, provider, range_scripts, provider)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys: '%s'", desc_str));
+            }
+            for (auto& scripts : range_scripts) {
+                for (auto& script : scripts) {
                     std::string inferred = InferDescriptor(script, provider)->ToString();
                     needles.emplace(script);
                     descriptors.emplace(std::move(script), std::move(inferred));
@@ -2277,6 +2347,14 @@ UniValue scantxoutset(const JSONRPCRequest& request)
         result.pushKV("success", res);
         result.pushKV("searched_items", count);
 
+        JSONStreamWriter* stream = request.resultStream;
+        if (stream) {
+            stream->BeginObject();
+            stream->KeyValue("success", res);
+            stream->KeyValue("searched_items", count);
+            stream->Key("unspents");
+            stream->BeginArray();
+        }
         for (const auto& it : coins) {
             const COutPoint& outpoint = it.first;
             const Coin& coin = it.second;
@@ -2292,7 +2370,17 @@ UniValue scantxoutset(const JSONRPCRequest& request)
             unspent.pushKV("amount", ValueFromAmount(txo.nValue));
             unspent.pushKV("height", (int32_t)coin.nHeight);
 
-            unspents.push_back(unspent);
+            if (stream) {
+                stream->Value(unspent);
+            } else {
+                unspents.push_back(unspent);
+            }
+        }
+        if (stream) {
+            stream->EndArray();
+            stream->KeyValue("total_amount", ValueFromAmount(total_in));
+            stream->EndObject();
+            return NullUniValue;
         }
         result.pushKV("unspents", unspents);
         result.pushKV("total_amount", ValueFromAmount(total_in));
@@ -2381,6 +2469,55 @@ static UniValue getblockfilter(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue ValidityCacheStatsToJSON(const ValidityCacheStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("hits", stats.hits);
+    ret.pushKV("misses", stats.misses);
+    ret.pushKV("inserts", stats.inserts);
+    ret.pushKV("evictions", stats.evictions);
+    ret.pushKV("shards", (uint64_t)stats.shards);
+    ret.pushKV("max_elements", (uint64_t)stats.max_elements);
+    ret.pushKV("bytes", (uint64_t)stats.bytes);
+    return ret;
+}
+
+static UniValue getvalidationcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            RPCHelpMan{"getvalidationcacheinfo",
+                "\nReturns the sizing and usage counters of the signature cache and the script execution cache.\n"
+                "Counters start at zero when the node starts.\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"signature\": {                  (json object) The signature cache\n"
+            "    \"hits\": xxxxx,                (numeric) Lookups that found their entry\n"
+            "    \"misses\": xxxxx,              (numeric) Lookups that did not\n"
+            "    \"inserts\": xxxxx,             (numeric) Entries added\n"
+            "    \"evictions\": xxxxx,           (numeric) Entries dropped to make room for new ones\n"
+            "    \"shards\": xxxxx,              (numeric) Number of independently locked shards (-sigcacheshards)\n"
+            "    \"max_elements\": xxxxx,        (numeric) Number of entries the cache can hold\n"
+            "    \"bytes\": xxxxx                (numeric) Memory used by the table\n"
+            "  },\n"
+            "  \"script_execution\": {           (json object) The script execution cache, with the same fields\n"
+            "    ...\n"
+            "  }\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getvalidationcacheinfo", "")
+            + HelpExampleRpc("getvalidationcacheinfo", "")
+                },
+            }.ToString());
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("signature", ValidityCacheStatsToJSON(GetSignatureCacheStats()));
+    ret.pushKV("script_execution", ValidityCacheStatsToJSON(GetScriptExecutionCacheStats()));
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2402,6 +2539,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "getvalidationcacheinfo", &getvalidationcacheinfo, {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
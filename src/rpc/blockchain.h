@@ -12,6 +12,7 @@
 class CBlock;
 class CBlockIndex;
 class CTxMemPool;
+class JSONStreamWriter;
 class UniValue;
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
@@ -30,12 +31,26 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails = false);
 
+/**
+ * Block description with transaction details, written to a stream. summary
+ * is the description without them, as returned by blockToJSON; unlike that
+ * one, this needs no lock.
+ */
+void blockToJSON(const CBlock& block, const UniValue& summary, JSONStreamWriter& stream);
+
 /** Mempool information to JSON */
 UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false);
 
+/**
+ * Verbose mempool contents, written to a stream. The pool is only locked
+ * while a batch of entries is described, not while they are written, so the
+ * result is not a snapshot of one moment.
+ */
+void MempoolToJSON(const CTxMemPool& pool, JSONStreamWriter& stream);
+
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex);
 
@@ -0,0 +1,85 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <univalue.h>
+
+#include <assert.h>
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t flush_size) : m_sink(std::move(sink)), m_flush_size(flush_size)
+{
+    m_buffer.reserve(m_flush_size);
+}
+
+void JSONStreamWriter::BeginValue()
+{
+    m_used = true;
+    if (m_after_key) {
+        m_after_key = false;
+        return;
+    }
+    if (!m_empty.empty()) {
+        if (!m_empty.back()) m_buffer += ',';
+        m_empty.back() = false;
+    }
+}
+
+void JSONStreamWriter::EndValue()
+{
+    if (m_buffer.size() >= m_flush_size) Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    BeginValue();
+    m_buffer += '{';
+    m_empty.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_empty.empty() && !m_after_key);
+    m_empty.pop_back();
+    m_buffer += '}';
+    EndValue();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    BeginValue();
+    m_buffer += '[';
+    m_empty.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_empty.empty() && !m_after_key);
+    m_empty.pop_back();
+    m_buffer += ']';
+    EndValue();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_empty.empty() && !m_after_key);
+    BeginValue();
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    BeginValue();
+    m_buffer += value.write();
+    EndValue();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (m_buffer.empty()) return;
+    m_sink(m_buffer);
+    m_buffer.clear();
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/**
+ * Writes a JSON document incrementally, handing it to a sink in chunks of
+ * roughly flush_size bytes. RPC methods with very large results use this to
+ * avoid building the complete UniValue tree (and its string form) in memory.
+ *
+ * The output is the same as UniValue::write() without indentation would
+ * produce for the equivalent tree. Nesting is not validated beyond what is
+ * needed to place separators; callers must balance Begin/End calls and
+ * write a Key before each value inside an object.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+    static const size_t DEFAULT_FLUSH_SIZE = 64 * 1024;
+
+    explicit JSONStreamWriter(Sink sink, size_t flush_size = DEFAULT_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const std::string& key);
+    void Value(const UniValue& value);
+    void KeyValue(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+
+    /** Pass any buffered output to the sink. */
+    void Flush();
+
+    /** Whether anything has been written to this stream. */
+    bool IsUsed() const { return m_used; }
+
+private:
+    void BeginValue();
+    void EndValue();
+
+    const Sink m_sink;
+    const size_t m_flush_size;
+    std::string m_buffer;
+    //! For each open object or array, whether it has no elements yet
+    std::vector<bool> m_empty;
+    bool m_after_key{false};
+    bool m_used{false};
+};
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
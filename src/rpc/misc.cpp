@@ -245,13 +245,13 @@ UniValue deriveaddresses(const JSONRPCRequest& request)
 
     UniValue addresses(UniValue::VARR);
 
-    for (int i = range_begin; i <= range_end; ++i) {
-        FlatSigningProvider provider;
-        std::vector<CScript> scripts;
-        if (!desc->Expand(i, key_provider, scripts, provider)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys"));
-        }
+    FlatSigningProvider provider;
+    std::vector<std::vector<CScript>> range_scripts;
+    if (!desc->ExpandRange(range_begin, range_end + 1, key_provider, range_scripts, provider)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys"));
+    }
 
+    for (const std::vector<CScript>& scripts : range_scripts) {
         for (const CScript &script : scripts) {
             CTxDestination dest;
             if (!ExtractDestination(script, dest)) {
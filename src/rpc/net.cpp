@@ -103,6 +103,7 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"subver\": \"/Satoshi:0.8.5/\",  (string) The string version\n"
             "    \"inbound\": true|false,     (boolean) Inbound (true) or Outbound (false)\n"
             "    \"addnode\": true|false,     (boolean) Whether connection was due to addnode/-connect or if it was an automatic/inbound connection\n"
+            "    \"encrypted\": true|false,   (boolean) Whether the connection is encrypted\n"
             "    \"startingheight\": n,       (numeric) The starting height (block) of the peer\n"
             "    \"banscore\": n,             (numeric) The ban score\n"
             "    \"synced_headers\": n,       (numeric) The last header we have in common with this peer\n"
@@ -111,6 +112,7 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
             "    ],\n"
+            "    \"txreconciliation\": true|false, (boolean) Whether transactions are relayed to and from this peer by set reconciliation\n"
             "    \"whitelisted\": true|false, (boolean) Whether the peer is whitelisted\n"
             "    \"minfeefilter\": n,         (numeric) The minimum fee rate for transactions this peer accepts\n"
             "    \"bytessent_per_msg\": {\n"
@@ -174,6 +176,7 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
         obj.pushKV("subver", stats.cleanSubVer);
         obj.pushKV("inbound", stats.fInbound);
         obj.pushKV("addnode", stats.m_manual_connection);
+        obj.pushKV("encrypted", stats.m_encrypted);
         obj.pushKV("startingheight", stats.nStartingHeight);
         if (fStateStats) {
             obj.pushKV("banscore", statestats.nMisbehavior);
@@ -184,6 +187,7 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
                 heights.push_back(height);
             }
             obj.pushKV("inflight", heights);
+            obj.pushKV("txreconciliation", statestats.m_tx_reconciliation);
         }
         obj.pushKV("whitelisted", stats.fWhitelisted);
         obj.pushKV("minfeefilter", ValueFromAmount(stats.minFeeFilter));
@@ -443,6 +447,17 @@ static UniValue GetNetworksInfo()
     return networks;
 }
 
+static UniValue NetBufferPoolStatsToJSON(const NetBufferPoolStats& stats)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("allocated", stats.allocated);
+    obj.pushKV("reused", stats.reused);
+    obj.pushKV("discarded", stats.discarded);
+    obj.pushKV("pooled", (uint64_t)stats.pooled);
+    obj.pushKV("pooled_bytes", (uint64_t)stats.pooled_bytes);
+    return obj;
+}
+
 static UniValue getnetworkinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -481,6 +496,15 @@ static UniValue getnetworkinfo(const JSONRPCRequest& request)
             "  ,...\n"
             "  ]\n"
             "  \"warnings\": \"...\"                    (string) any network and blockchain warnings\n"
+            "  \"buffers\": {                          (json object) reuse of the buffers messages are sent and received in\n"
+            "    \"send\"|\"receive\": {\n"
+            "      \"allocated\": xxxxx,                (numeric) buffers that had to be allocated\n"
+            "      \"reused\": xxxxx,                   (numeric) buffers that were reused\n"
+            "      \"discarded\": xxxxx,                (numeric) buffers that were freed instead of being kept for reuse\n"
+            "      \"pooled\": xxxxx,                   (numeric) buffers currently kept for reuse\n"
+            "      \"pooled_bytes\": xxxxx              (numeric) capacity of the buffers currently kept for reuse\n"
+            "    }\n"
+            "  }\n"
             "}\n"
                 },
                 RPCExamples{
@@ -519,6 +543,10 @@ static UniValue getnetworkinfo(const JSONRPCRequest& request)
     }
     obj.pushKV("localaddresses", localAddresses);
     obj.pushKV("warnings",       GetWarnings("statusbar"));
+    UniValue buffers(UniValue::VOBJ);
+    buffers.pushKV("send", NetBufferPoolStatsToJSON(g_net_send_buffers.GetStats()));
+    buffers.pushKV("receive", NetBufferPoolStatsToJSON(g_net_recv_buffers.GetStats()));
+    obj.pushKV("buffers", buffers);
     return obj;
 }
 
@@ -20,6 +20,7 @@
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
 
 class CRPCCommand;
+class JSONStreamWriter;
 
 namespace RPCServer
 {
@@ -37,8 +38,14 @@ public:
     std::string URI;
     std::string authUser;
     std::string peerAddr;
+    /**
+     * If set, a method with a very large result may write it to this stream
+     * and return NullUniValue instead of returning it. Only provided for
+     * single (non-batch) requests over HTTP.
+     */
+    JSONStreamWriter* resultStream;
 
-    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false) {}
+    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false), resultStream(nullptr) {}
     void parse(const UniValue& valRequest);
 };
 
@@ -4,6 +4,7 @@
 
 #include <script/descriptor.h>
 
+#include <hash.h>
 #include <key_io.h>
 #include <pubkey.h>
 #include <script/script.h>
@@ -314,6 +315,29 @@ public:
     }
 };
 
+/** Public keys with their origins, as derived when expanding a descriptor. */
+typedef std::vector<std::pair<CPubKey, KeyOriginInfo>> KeyEntries;
+
+/** The key IDs of entries, hashed in parallel where the CPU supports it. */
+std::vector<CKeyID> GetKeyIDs(const KeyEntries& entries)
+{
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    inputs.reserve(entries.size());
+    lengths.reserve(entries.size());
+    for (const auto& entry : entries) {
+        inputs.push_back(entry.first.begin());
+        lengths.push_back(entry.first.size());
+    }
+    std::vector<unsigned char> hashes(CHash160::OUTPUT_SIZE * entries.size());
+    Hash160Multi(hashes.data(), inputs.data(), lengths.data(), entries.size());
+    std::vector<CKeyID> ids(entries.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        std::copy(hashes.begin() + CHash160::OUTPUT_SIZE * i, hashes.begin() + CHash160::OUTPUT_SIZE * (i + 1), ids[i].begin());
+    }
+    return ids;
+}
+
 /** Base class for all Descriptor implementations. */
 class DescriptorImpl : public Descriptor
 {
@@ -334,12 +358,13 @@ protected:
      *  m_script_arg, or just once in case m_script_arg is nullptr.
 
      *  @param pubkeys The evaluations of the m_pubkey_args field.
+     *  @param ids The key IDs of pubkeys.
      *  @param script The evaluation of m_script_arg (or nullptr when m_script_arg is nullptr).
      *  @param out A FlatSigningProvider to put scripts or public keys in that are necessary to the solver.
      *             The script arguments to this function are automatically added, as is the origin info of the provided pubkeys.
      *  @return A vector with scriptPubKeys for this descriptor.
      */
-    virtual std::vector<CScript> MakeScripts(const std::vector<CPubKey>& pubkeys, const CScript* script, FlatSigningProvider& out) const = 0;
+    virtual std::vector<CScript> MakeScripts(const std::vector<CPubKey>& pubkeys, const std::vector<CKeyID>& ids, const CScript* script, FlatSigningProvider& out) const = 0;
 
 public:
     DescriptorImpl(std::vector<std::unique_ptr<PubkeyProvider>> pubkeys, std::unique_ptr<DescriptorImpl> script, const std::string& name) : m_pubkey_args(std::move(pubkeys)), m_script_arg(std::move(script)), m_name(name) {}
@@ -402,12 +427,13 @@ public:
         return ret;
     }
 
-    bool ExpandHelper(int pos, const SigningProvider& arg, Span<const unsigned char>* cache_read, std::vector<CScript>& output_scripts, FlatSigningProvider& out, std::vector<unsigned char>* cache_write) const
+    /**
+     * Get the public keys of a position with their origins: those of
+     * m_pubkey_args, followed by those of m_script_arg. This is the
+     * derivation; nothing is hashed or output yet.
+     */
+    bool GetPubKeys(int pos, const SigningProvider& arg, Span<const unsigned char>* cache_read, KeyEntries& entries, std::vector<unsigned char>* cache_write) const
     {
-        std::vector<std::pair<CPubKey, KeyOriginInfo>> entries;
-        entries.reserve(m_pubkey_args.size());
-
-        // Construct temporary data in `entries` and `subscripts`, to avoid producing output in case of failure.
         for (const auto& p : m_pubkey_args) {
             entries.emplace_back();
             if (!p->GetPubKey(pos, arg, cache_read ? nullptr : &entries.back().first, entries.back().second)) return false;
@@ -425,30 +451,50 @@ public:
                 cache_write->insert(cache_write->end(), entries.back().first.begin(), entries.back().first.end());
             }
         }
+        if (m_script_arg) return m_script_arg->GetPubKeys(pos, arg, cache_read, entries, cache_write);
+        return true;
+    }
+
+    /**
+     * Construct the scripts of a position from the entries GetPubKeys()
+     * returned for it, starting at entries[next], and ids their key IDs.
+     * next is advanced past the entries used.
+     */
+    void MakeOutput(KeyEntries& entries, const CKeyID* ids, size_t& next, std::vector<CScript>& output_scripts, FlatSigningProvider& out) const
+    {
+        const size_t first = next;
+        next += m_pubkey_args.size();
         std::vector<CScript> subscripts;
-        if (m_script_arg) {
-            FlatSigningProvider subprovider;
-            if (!m_script_arg->ExpandHelper(pos, arg, cache_read, subscripts, subprovider, cache_write)) return false;
-            out = Merge(out, subprovider);
-        }
+        if (m_script_arg) m_script_arg->MakeOutput(entries, ids, next, subscripts, out);
 
         std::vector<CPubKey> pubkeys;
-        pubkeys.reserve(entries.size());
-        for (auto& entry : entries) {
-            pubkeys.push_back(entry.first);
-            out.origins.emplace(entry.first.GetID(), std::make_pair<CPubKey, KeyOriginInfo>(CPubKey(entry.first), std::move(entry.second)));
+        pubkeys.reserve(m_pubkey_args.size());
+        for (size_t i = first; i < first + m_pubkey_args.size(); ++i) {
+            pubkeys.push_back(entries[i].first);
+            out.origins.emplace(ids[i], std::make_pair<CPubKey, KeyOriginInfo>(CPubKey(entries[i].first), std::move(entries[i].second)));
         }
+        const std::vector<CKeyID> pubkey_ids(ids + first, ids + first + m_pubkey_args.size());
         if (m_script_arg) {
             for (const auto& subscript : subscripts) {
                 out.scripts.emplace(CScriptID(subscript), subscript);
-                std::vector<CScript> addscripts = MakeScripts(pubkeys, &subscript, out);
+                std::vector<CScript> addscripts = MakeScripts(pubkeys, pubkey_ids, &subscript, out);
                 for (auto& addscript : addscripts) {
                     output_scripts.push_back(std::move(addscript));
                 }
             }
         } else {
-            output_scripts = MakeScripts(pubkeys, nullptr, out);
+            output_scripts = MakeScripts(pubkeys, pubkey_ids, nullptr, out);
         }
+    }
+
+    bool ExpandHelper(int pos, const SigningProvider& arg, Span<const unsigned char>* cache_read, std::vector<CScript>& output_scripts, FlatSigningProvider& out, std::vector<unsigned char>* cache_write) const
+    {
+        // Derive everything before producing output, so there is none in case of failure.
+        KeyEntries entries;
+        if (!GetPubKeys(pos, arg, cache_read, entries, cache_write)) return false;
+        const std::vector<CKeyID> ids = GetKeyIDs(entries);
+        size_t next = 0;
+        MakeOutput(entries, ids.data(), next, output_scripts, out);
         return true;
     }
 
@@ -462,6 +508,22 @@ public:
         Span<const unsigned char> span = MakeSpan(cache);
         return ExpandHelper(pos, DUMMY_SIGNING_PROVIDER, &span, output_scripts, out, nullptr) && span.size() == 0;
     }
+
+    bool ExpandRange(int begin, int end, const SigningProvider& provider, std::vector<std::vector<CScript>>& output_scripts, FlatSigningProvider& out) const final
+    {
+        // Derive the keys of every position, then hash them all at once.
+        KeyEntries entries;
+        for (int pos = begin; pos < end; ++pos) {
+            if (!GetPubKeys(pos, provider, nullptr, entries, nullptr)) return false;
+        }
+        const std::vector<CKeyID> ids = GetKeyIDs(entries);
+        size_t next = 0;
+        output_scripts.assign(std::max(end - begin, 0), {});
+        for (auto& scripts : output_scripts) {
+            MakeOutput(entries, ids.data(), next, scripts, out);
+        }
+        return true;
+    }
 };
 
 /** Construct a vector with one element, which is moved into it. */
@@ -479,7 +541,7 @@ class AddressDescriptor final : public DescriptorImpl
     const CTxDestination m_destination;
 protected:
     std::string ToStringExtra() const override { return EncodeDestination(m_destination); }
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const CScript*, FlatSigningProvider&) const override { return Singleton(GetScriptForDestination(m_destination)); }
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const std::vector<CKeyID>&, const CScript*, FlatSigningProvider&) const override { return Singleton(GetScriptForDestination(m_destination)); }
 public:
     AddressDescriptor(CTxDestination destination) : DescriptorImpl({}, {}, "addr"), m_destination(std::move(destination)) {}
     bool IsSolvable() const final { return false; }
@@ -491,7 +553,7 @@ class RawDescriptor final : public DescriptorImpl
     const CScript m_script;
 protected:
     std::string ToStringExtra() const override { return HexStr(m_script.begin(), m_script.end()); }
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const CScript*, FlatSigningProvider&) const override { return Singleton(m_script); }
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const std::vector<CKeyID>&, const CScript*, FlatSigningProvider&) const override { return Singleton(m_script); }
 public:
     RawDescriptor(CScript script) : DescriptorImpl({}, {}, "raw"), m_script(std::move(script)) {}
     bool IsSolvable() const final { return false; }
@@ -501,7 +563,7 @@ public:
 class PKDescriptor final : public DescriptorImpl
 {
 protected:
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const CScript*, FlatSigningProvider&) const override { return Singleton(GetScriptForRawPubKey(keys[0])); }
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const std::vector<CKeyID>&, const CScript*, FlatSigningProvider&) const override { return Singleton(GetScriptForRawPubKey(keys[0])); }
 public:
     PKDescriptor(std::unique_ptr<PubkeyProvider> prov) : DescriptorImpl(Singleton(std::move(prov)), {}, "pk") {}
 };
@@ -510,9 +572,9 @@ public:
 class PKHDescriptor final : public DescriptorImpl
 {
 protected:
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const CScript*, FlatSigningProvider& out) const override
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const std::vector<CKeyID>& ids, const CScript*, FlatSigningProvider& out) const override
     {
-        CKeyID id = keys[0].GetID();
+        const CKeyID& id = ids[0];
         out.pubkeys.emplace(id, keys[0]);
         return Singleton(GetScriptForDestination(id));
     }
@@ -524,9 +586,9 @@ public:
 class WPKHDescriptor final : public DescriptorImpl
 {
 protected:
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const CScript*, FlatSigningProvider& out) const override
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const std::vector<CKeyID>& ids, const CScript*, FlatSigningProvider& out) const override
     {
-        CKeyID id = keys[0].GetID();
+        const CKeyID& id = ids[0];
         out.pubkeys.emplace(id, keys[0]);
         return Singleton(GetScriptForDestination(WitnessV0KeyHash(id)));
     }
@@ -538,10 +600,10 @@ public:
 class ComboDescriptor final : public DescriptorImpl
 {
 protected:
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const CScript*, FlatSigningProvider& out) const override
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const std::vector<CKeyID>& ids, const CScript*, FlatSigningProvider& out) const override
     {
         std::vector<CScript> ret;
-        CKeyID id = keys[0].GetID();
+        const CKeyID& id = ids[0];
         out.pubkeys.emplace(id, keys[0]);
         ret.emplace_back(GetScriptForRawPubKey(keys[0])); // P2PK
         ret.emplace_back(GetScriptForDestination(id)); // P2PKH
@@ -563,7 +625,7 @@ class MultisigDescriptor final : public DescriptorImpl
     const int m_threshold;
 protected:
     std::string ToStringExtra() const override { return strprintf("%i", m_threshold); }
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const CScript*, FlatSigningProvider&) const override { return Singleton(GetScriptForMultisig(m_threshold, keys)); }
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>& keys, const std::vector<CKeyID>&, const CScript*, FlatSigningProvider&) const override { return Singleton(GetScriptForMultisig(m_threshold, keys)); }
 public:
     MultisigDescriptor(int threshold, std::vector<std::unique_ptr<PubkeyProvider>> providers) : DescriptorImpl(std::move(providers), {}, "multi"), m_threshold(threshold) {}
 };
@@ -572,7 +634,7 @@ public:
 class SHDescriptor final : public DescriptorImpl
 {
 protected:
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const CScript* script, FlatSigningProvider&) const override { return Singleton(GetScriptForDestination(CScriptID(*script))); }
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const std::vector<CKeyID>&, const CScript* script, FlatSigningProvider&) const override { return Singleton(GetScriptForDestination(CScriptID(*script))); }
 public:
     SHDescriptor(std::unique_ptr<DescriptorImpl> desc) : DescriptorImpl({}, std::move(desc), "sh") {}
 };
@@ -581,7 +643,7 @@ public:
 class WSHDescriptor final : public DescriptorImpl
 {
 protected:
-    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const CScript* script, FlatSigningProvider&) const override { return Singleton(GetScriptForDestination(WitnessV0ScriptHash(*script))); }
+    std::vector<CScript> MakeScripts(const std::vector<CPubKey>&, const std::vector<CKeyID>&, const CScript* script, FlatSigningProvider&) const override { return Singleton(GetScriptForDestination(WitnessV0ScriptHash(*script))); }
 public:
     WSHDescriptor(std::unique_ptr<DescriptorImpl> desc) : DescriptorImpl({}, std::move(desc), "wsh") {}
 };
@@ -60,6 +60,17 @@ struct Descriptor {
      * out: scripts and public keys necessary for solving the expanded scriptPubKeys will be put here (may be equal to provider).
      */
     virtual bool ExpandFromCache(int pos, const std::vector<unsigned char>& cache, std::vector<CScript>& output_scripts, FlatSigningProvider& out) const = 0;
+
+    /** Expand a descriptor at every position in [begin, end), as Expand() does at each one.
+     *
+     * Derives the public keys of all positions first, and then hashes them together,
+     * which is faster than expanding one position at a time.
+     * provider: the provider to query for private keys in case of hardened derivation.
+     * output_scripts: will be overwritten with the expanded scriptPubKeys of each position.
+     * out: scripts and public keys necessary for solving the expanded scriptPubKeys of all positions will be put here (may be equal to provider).
+     * Returns false, with nothing put in out, if any position cannot be expanded.
+     */
+    virtual bool ExpandRange(int begin, int end, const SigningProvider& provider, std::vector<std::vector<CScript>>& output_scripts, FlatSigningProvider& out) const = 0;
 };
 
 /** Parse a descriptor string. Included private keys are put in out.
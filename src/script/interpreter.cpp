@@ -12,7 +12,9 @@
 #include <script/script.h>
 #include <uint256.h>
 
-typedef std::vector<unsigned char> valtype;
+#include <algorithm>
+
+typedef ScriptStackElement valtype;
 
 namespace {
 
@@ -104,7 +106,7 @@ bool static IsCompressedPubKey(const valtype &vchPubKey) {
  *
  * This function is consensus-critical since BIP66.
  */
-bool static IsValidSignatureEncoding(const std::vector<unsigned char> &sig) {
+bool static IsValidSignatureEncoding(const valtype &sig) {
     // Format: 0x30 [total-length] 0x02 [R-length] [R] 0x02 [S-length] [S] [sighash]
     // * total-length: 1-byte length descriptor of everything that follows,
     //   excluding the sighash byte.
@@ -197,7 +199,7 @@ bool static IsDefinedHashtypeSignature(const valtype &vchSig) {
     return true;
 }
 
-bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror) {
+bool static CheckSignatureEncoding(const valtype &vchSig, unsigned int flags, ScriptError* serror) {
     // Empty signature. Not strictly DER encoded, but allowed to provide a
     // compact way to provide an invalid signature for use with CHECK(MULTI)SIG
     if (vchSig.size() == 0) {
@@ -214,6 +216,10 @@ bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned i
     return true;
 }
 
+bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror) {
+    return CheckSignatureEncoding(valtype(vchSig.begin(), vchSig.end()), flags, serror);
+}
+
 bool static CheckPubKeyEncoding(const valtype &vchPubKey, unsigned int flags, const SigVersion &sigversion, ScriptError* serror) {
     if ((flags & SCRIPT_VERIFY_STRICTENC) != 0 && !IsCompressedOrUncompressedPubKey(vchPubKey)) {
         return set_error(serror, SCRIPT_ERR_PUBKEYTYPE);
@@ -250,6 +256,16 @@ bool static CheckMinimalPush(const valtype& data, opcodetype opcode) {
     return true;
 }
 
+/** The size of the opcode and the length prefix of a push instruction. */
+static inline size_t PushPrefixSize(opcodetype opcode)
+{
+    assert(0 <= opcode && opcode <= OP_PUSHDATA4);
+    if (opcode < OP_PUSHDATA1) return 1;
+    if (opcode == OP_PUSHDATA1) return 2;
+    if (opcode == OP_PUSHDATA2) return 3;
+    return 5;
+}
+
 int FindAndDelete(CScript& script, const CScript& b)
 {
     int nFound = 0;
@@ -278,7 +294,219 @@ int FindAndDelete(CScript& script, const CScript& b)
     return nFound;
 }
 
-bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+/**
+ * FindAndDelete of the push of a signature from the script code. The push is
+ * only built if the signature itself occurs in the script code, which it does
+ * not in any practical use.
+ */
+static int FindAndDeleteSignature(CScript& scriptCode, const valtype& vchSig)
+{
+    if (std::search(scriptCode.begin(), scriptCode.end(), vchSig.begin(), vchSig.end()) == scriptCode.end())
+        return 0;
+    return FindAndDelete(scriptCode, CScript() << std::vector<unsigned char>(vchSig.begin(), vchSig.end()));
+}
+
+/**
+ * The signature check of OP_CHECKSIG(VERIFY) on sig and pubkey, against the
+ * script from pbegincodehash to pend. Returns false with serror set if the
+ * script fails, and sets fSuccess to the result of the check otherwise.
+ */
+static bool EvalChecksig(const valtype& vchSig, const valtype& vchPubKey, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& fSuccess)
+{
+    // Subset of script starting at the most recent codeseparator
+    CScript scriptCode(pbegincodehash, pend);
+
+    // Drop the signature in pre-segwit scripts but not segwit scripts
+    if (sigversion == SigVersion::BASE) {
+        int found = FindAndDeleteSignature(scriptCode, vchSig);
+        if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
+            return set_error(serror, SCRIPT_ERR_SIG_FINDANDDELETE);
+    }
+
+    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
+        //serror is set
+        return false;
+    }
+    fSuccess = checker.CheckSig(MakeSpan(vchSig), MakeSpan(vchPubKey), scriptCode, sigversion);
+
+    if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
+        return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
+
+    return true;
+}
+
+/**
+ * Execute a pay-to-pubkey-hash script (as spent directly, or as the script
+ * of a P2WPKH output) without decoding it: compare the hash in place and
+ * check the signature, with the same results (and stack) as the generic
+ * interpreter.
+ *
+ * Only called with at least the signature and pubkey on the stack, and room
+ * for the two elements OP_DUP and the hash push add to it, so that none of
+ * the stack checks of the generic path can fail.
+ */
+static bool EvalPayToPubKeyHash(std::vector<valtype>& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    static const valtype vchFalse(0);
+    static const valtype vchTrue(1, (unsigned char)1);
+
+    // OP_DUP OP_HASH160 <hash> OP_EQUALVERIFY
+    const valtype& vchPubKey = stacktop(-1);
+    unsigned char hash[CHash160::OUTPUT_SIZE];
+    CHash160().Write(vchPubKey.data(), vchPubKey.size()).Finalize(hash);
+    if (memcmp(hash, &script[3], sizeof(hash)) != 0) {
+        // Leave the stack as the generic path does
+        stack.push_back(vchFalse);
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+    }
+
+    // OP_CHECKSIG
+    bool fSuccess = false;
+    if (!EvalChecksig(stacktop(-2), vchPubKey, script.begin(), script.end(), flags, checker, sigversion, serror, fSuccess))
+        return false;
+    popstack(stack);
+    popstack(stack);
+    stack.push_back(fSuccess ? vchTrue : vchFalse);
+    return set_success(serror);
+}
+
+/**
+ * OP_CHECKMULTISIG(VERIFY) up to pushing its result: check the signatures on
+ * the stack against the script from pbegincodehash to pend, and pop them,
+ * the keys, the counts and the dummy element. Returns false with serror set
+ * if the script fails, and sets fSuccess to the result of the check otherwise.
+ */
+static bool EvalCheckMultisig(std::vector<valtype>& stack, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, int& nOpCount, bool& fSuccess)
+{
+    const bool fRequireMinimal = (flags & SCRIPT_VERIFY_MINIMALDATA) != 0;
+
+    int i = 1;
+    if ((int)stack.size() < i)
+        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+
+    int nKeysCount = CScriptNum(stacktop(-i), fRequireMinimal).getint();
+    if (nKeysCount < 0 || nKeysCount > MAX_PUBKEYS_PER_MULTISIG)
+        return set_error(serror, SCRIPT_ERR_PUBKEY_COUNT);
+    nOpCount += nKeysCount;
+    if (nOpCount > MAX_OPS_PER_SCRIPT)
+        return set_error(serror, SCRIPT_ERR_OP_COUNT);
+    int ikey = ++i;
+    // ikey2 is the position of last non-signature item in the stack. Top stack item = 1.
+    // With SCRIPT_VERIFY_NULLFAIL, this is used for cleanup if operation fails.
+    int ikey2 = nKeysCount + 2;
+    i += nKeysCount;
+    if ((int)stack.size() < i)
+        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+
+    int nSigsCount = CScriptNum(stacktop(-i), fRequireMinimal).getint();
+    if (nSigsCount < 0 || nSigsCount > nKeysCount)
+        return set_error(serror, SCRIPT_ERR_SIG_COUNT);
+    int isig = ++i;
+    i += nSigsCount;
+    if ((int)stack.size() < i)
+        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+
+    // Subset of script starting at the most recent codeseparator
+    CScript scriptCode(pbegincodehash, pend);
+
+    // Drop the signature in pre-segwit scripts but not segwit scripts
+    for (int k = 0; k < nSigsCount; k++)
+    {
+        valtype& vchSig = stacktop(-isig-k);
+        if (sigversion == SigVersion::BASE) {
+            int found = FindAndDeleteSignature(scriptCode, vchSig);
+            if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
+                return set_error(serror, SCRIPT_ERR_SIG_FINDANDDELETE);
+        }
+    }
+
+    fSuccess = true;
+    while (fSuccess && nSigsCount > 0)
+    {
+        const valtype& vchSig    = stacktop(-isig);
+        const valtype& vchPubKey = stacktop(-ikey);
+
+        // Note how this makes the exact order of pubkey/signature evaluation
+        // distinguishable by CHECKMULTISIG NOT if the STRICTENC flag is set.
+        // See the script_(in)valid tests for details.
+        if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
+            // serror is set
+            return false;
+        }
+
+        // Check signature
+        bool fOk = checker.CheckSig(MakeSpan(vchSig), MakeSpan(vchPubKey), scriptCode, sigversion);
+
+        if (fOk) {
+            isig++;
+            nSigsCount--;
+        }
+        ikey++;
+        nKeysCount--;
+
+        // If there are more signatures left than keys left,
+        // then too many signatures have failed. Exit early,
+        // without checking any further signatures.
+        if (nSigsCount > nKeysCount)
+            fSuccess = false;
+    }
+
+    // Clean up stack of actual arguments
+    while (i-- > 1) {
+        // If the operation failed, we require that all signatures must be empty vector
+        if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && !ikey2 && stacktop(-1).size())
+            return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
+        if (ikey2 > 0)
+            ikey2--;
+        popstack(stack);
+    }
+
+    // A bug causes CHECKMULTISIG to consume one extra argument
+    // whose contents were not checked in any way.
+    //
+    // Unfortunately this is a potential source of mutability,
+    // so optionally verify it is exactly equal to zero prior
+    // to removing it from the stack.
+    if (stack.size() < 1)
+        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+    if ((flags & SCRIPT_VERIFY_NULLDUMMY) && stacktop(-1).size())
+        return set_error(serror, SCRIPT_ERR_SIG_NULLDUMMY);
+    popstack(stack);
+
+    return true;
+}
+
+/**
+ * Execute a bare multisig script (OP_m <pubkey>... OP_n OP_CHECKMULTISIG, as
+ * redeemed by P2SH and P2WSH multisig spends) without decoding it: push what
+ * the script pushes and run the check shared with the generic interpreter,
+ * with the same results (and stack).
+ *
+ * Only called with room on the stack for the n + 2 elements the script
+ * pushes, so that none of the stack checks of the generic path can fail.
+ */
+static bool EvalMultisig(std::vector<valtype>& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    static const valtype vchFalse(0);
+    static const valtype vchTrue(1, (unsigned char)1);
+
+    // OP_m <pubkey>... OP_n
+    stack.push_back(CScriptNum(CScript::DecodeOP_N((opcodetype)script[0])).getvch<valtype>());
+    for (size_t pos = 1; pos < script.size() - 2; pos += 1 + script[pos]) {
+        stack.emplace_back(script.begin() + pos + 1, script.begin() + pos + 1 + script[pos]);
+    }
+    stack.push_back(CScriptNum(CScript::DecodeOP_N((opcodetype)script[script.size() - 2])).getvch<valtype>());
+
+    // OP_CHECKMULTISIG, the only opcode counted towards the limit so far
+    int nOpCount = 1;
+    bool fSuccess = false;
+    if (!EvalCheckMultisig(stack, script.begin(), script.end(), flags, checker, sigversion, serror, nOpCount, fSuccess))
+        return false;
+    stack.push_back(fSuccess ? vchTrue : vchFalse);
+    return set_success(serror);
+}
+
+static bool EvalScript(std::vector<valtype>& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
 {
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
@@ -286,7 +514,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     // static const CScriptNum bnTrue(1);
     static const valtype vchFalse(0);
     // static const valtype vchZero(0);
-    static const valtype vchTrue(1, 1);
+    static const valtype vchTrue(1, (unsigned char)1);
 
     CScript::const_iterator pc = script.begin();
     CScript::const_iterator pend = script.end();
@@ -298,6 +526,10 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
     if (script.size() > MAX_SCRIPT_SIZE)
         return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
+    if (script.IsPayToPubKeyHash() && stack.size() >= 2 && stack.size() + 2 <= MAX_STACK_SIZE)
+        return EvalPayToPubKeyHash(stack, script, flags, checker, sigversion, serror);
+    if (script.IsMultisig() && stack.size() + CScript::DecodeOP_N((opcodetype)script[script.size() - 2]) + 2 <= MAX_STACK_SIZE)
+        return EvalMultisig(stack, script, flags, checker, sigversion, serror);
     int nOpCount = 0;
     bool fRequireMinimal = (flags & SCRIPT_VERIFY_MINIMALDATA) != 0;
 
@@ -310,10 +542,14 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
             //
             // Read instruction
             //
-            if (!script.GetOp(pc, opcode, vchPushValue))
+            CScript::const_iterator pbeginop = pc;
+            if (!script.GetOp(pc, opcode))
                 return set_error(serror, SCRIPT_ERR_BAD_OPCODE);
-            if (vchPushValue.size() > MAX_SCRIPT_ELEMENT_SIZE)
+            // The data pushed is at the end of the instruction
+            const size_t nPushSize = opcode <= OP_PUSHDATA4 ? (pc - pbeginop) - PushPrefixSize(opcode) : 0;
+            if (nPushSize > MAX_SCRIPT_ELEMENT_SIZE)
                 return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+            vchPushValue.assign(pc - nPushSize, pc);
 
             // Note how OP_RESERVED does not count towards the opcode limit.
             if (opcode > OP_16 && ++nOpCount > MAX_OPS_PER_SCRIPT)
@@ -371,7 +607,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     // ( -- value)
                     CScriptNum bn((int)opcode - (int)(OP_1 - 1));
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<valtype>());
                     // The result of these opcodes should always be the minimal way to push the data
                     // they push, so no need for a CheckMinimalPush here.
                 }
@@ -614,8 +850,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 -- x3 x4 x1 x2)
                     if (stack.size() < 4)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-4), stacktop(-2));
-                    swap(stacktop(-3), stacktop(-1));
+                    std::swap(stacktop(-4), stacktop(-2));
+                    std::swap(stacktop(-3), stacktop(-1));
                 }
                 break;
 
@@ -634,7 +870,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     // -- stacksize
                     CScriptNum bn(stack.size());
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<valtype>());
                 }
                 break;
 
@@ -701,8 +937,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     //  x2 x3 x1  after second swap
                     if (stack.size() < 3)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-3), stacktop(-2));
-                    swap(stacktop(-2), stacktop(-1));
+                    std::swap(stacktop(-3), stacktop(-2));
+                    std::swap(stacktop(-2), stacktop(-1));
                 }
                 break;
 
@@ -711,7 +947,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-2), stacktop(-1));
+                    std::swap(stacktop(-2), stacktop(-1));
                 }
                 break;
 
@@ -732,7 +968,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     CScriptNum bn(stacktop(-1).size());
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<valtype>());
                 }
                 break;
 
@@ -794,7 +1030,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     default:            assert(!"invalid opcode"); break;
                     }
                     popstack(stack);
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<valtype>());
                 }
                 break;
 
@@ -843,7 +1079,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     }
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(bn.getvch());
+                    stack.push_back(bn.getvch<valtype>());
 
                     if (opcode == OP_NUMEQUALVERIFY)
                     {
@@ -921,24 +1157,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     valtype& vchSig    = stacktop(-2);
                     valtype& vchPubKey = stacktop(-1);
 
-                    // Subset of script starting at the most recent codeseparator
-                    CScript scriptCode(pbegincodehash, pend);
-
-                    // Drop the signature in pre-segwit scripts but not segwit scripts
-                    if (sigversion == SigVersion::BASE) {
-                        int found = FindAndDelete(scriptCode, CScript(vchSig));
-                        if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
-                            return set_error(serror, SCRIPT_ERR_SIG_FINDANDDELETE);
-                    }
-
-                    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
-                        //serror is set
+                    bool fSuccess = false;
+                    if (!EvalChecksig(vchSig, vchPubKey, pbegincodehash, pend, flags, checker, sigversion, serror, fSuccess))
                         return false;
-                    }
-                    bool fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion);
-
-                    if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
-                        return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
 
                     popstack(stack);
                     popstack(stack);
@@ -958,98 +1179,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     // ([sig ...] num_of_signatures [pubkey ...] num_of_pubkeys -- bool)
 
-                    int i = 1;
-                    if ((int)stack.size() < i)
-                        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-
-                    int nKeysCount = CScriptNum(stacktop(-i), fRequireMinimal).getint();
-                    if (nKeysCount < 0 || nKeysCount > MAX_PUBKEYS_PER_MULTISIG)
-                        return set_error(serror, SCRIPT_ERR_PUBKEY_COUNT);
-                    nOpCount += nKeysCount;
-                    if (nOpCount > MAX_OPS_PER_SCRIPT)
-                        return set_error(serror, SCRIPT_ERR_OP_COUNT);
-                    int ikey = ++i;
-                    // ikey2 is the position of last non-signature item in the stack. Top stack item = 1.
-                    // With SCRIPT_VERIFY_NULLFAIL, this is used for cleanup if operation fails.
-                    int ikey2 = nKeysCount + 2;
-                    i += nKeysCount;
-                    if ((int)stack.size() < i)
-                        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-
-                    int nSigsCount = CScriptNum(stacktop(-i), fRequireMinimal).getint();
-                    if (nSigsCount < 0 || nSigsCount > nKeysCount)
-                        return set_error(serror, SCRIPT_ERR_SIG_COUNT);
-                    int isig = ++i;
-                    i += nSigsCount;
-                    if ((int)stack.size() < i)
-                        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-
-                    // Subset of script starting at the most recent codeseparator
-                    CScript scriptCode(pbegincodehash, pend);
-
-                    // Drop the signature in pre-segwit scripts but not segwit scripts
-                    for (int k = 0; k < nSigsCount; k++)
-                    {
-                        valtype& vchSig = stacktop(-isig-k);
-                        if (sigversion == SigVersion::BASE) {
-                            int found = FindAndDelete(scriptCode, CScript(vchSig));
-                            if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
-                                return set_error(serror, SCRIPT_ERR_SIG_FINDANDDELETE);
-                        }
-                    }
-
-                    bool fSuccess = true;
-                    while (fSuccess && nSigsCount > 0)
-                    {
-                        valtype& vchSig    = stacktop(-isig);
-                        valtype& vchPubKey = stacktop(-ikey);
-
-                        // Note how this makes the exact order of pubkey/signature evaluation
-                        // distinguishable by CHECKMULTISIG NOT if the STRICTENC flag is set.
-                        // See the script_(in)valid tests for details.
-                        if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
-                            // serror is set
-                            return false;
-                        }
-
-                        // Check signature
-                        bool fOk = checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion);
-
-                        if (fOk) {
-                            isig++;
-                            nSigsCount--;
-                        }
-                        ikey++;
-                        nKeysCount--;
-
-                        // If there are more signatures left than keys left,
-                        // then too many signatures have failed. Exit early,
-                        // without checking any further signatures.
-                        if (nSigsCount > nKeysCount)
-                            fSuccess = false;
-                    }
-
-                    // Clean up stack of actual arguments
-                    while (i-- > 1) {
-                        // If the operation failed, we require that all signatures must be empty vector
-                        if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && !ikey2 && stacktop(-1).size())
-                            return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
-                        if (ikey2 > 0)
-                            ikey2--;
-                        popstack(stack);
-                    }
-
-                    // A bug causes CHECKMULTISIG to consume one extra argument
-                    // whose contents were not checked in any way.
-                    //
-                    // Unfortunately this is a potential source of mutability,
-                    // so optionally verify it is exactly equal to zero prior
-                    // to removing it from the stack.
-                    if (stack.size() < 1)
-                        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    if ((flags & SCRIPT_VERIFY_NULLDUMMY) && stacktop(-1).size())
-                        return set_error(serror, SCRIPT_ERR_SIG_NULLDUMMY);
-                    popstack(stack);
+                    bool fSuccess = false;
+                    if (!EvalCheckMultisig(stack, pbegincodehash, pend, flags, checker, sigversion, serror, nOpCount, fSuccess))
+                        return false;
 
                     stack.push_back(fSuccess ? vchTrue : vchFalse);
 
@@ -1083,6 +1215,21 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     return set_success(serror);
 }
 
+bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    std::vector<valtype> stack_eval;
+    stack_eval.reserve(stack.size());
+    for (const auto& element : stack) {
+        stack_eval.emplace_back(element.begin(), element.end());
+    }
+    const bool ret = EvalScript(stack_eval, script, flags, checker, sigversion, serror);
+    stack.clear();
+    for (const valtype& element : stack_eval) {
+        stack.emplace_back(element.begin(), element.end());
+    }
+    return ret;
+}
+
 namespace {
 
 /**
@@ -1212,6 +1359,80 @@ uint256 GetOutputsHash(const T& txTo)
     return ss.GetHash();
 }
 
+/** Legacy signature hashes are computed from midstates for transactions with at least this many inputs */
+static constexpr size_t LEGACY_MIDSTATE_MIN_INPUTS = 8;
+/** Inputs between two midstates of the legacy signature serialization */
+static constexpr size_t LEGACY_MIDSTATE_INTERVAL = 8;
+/** Size of a serialized input with an empty script */
+static constexpr size_t BLANK_INPUT_SIZE = 36 + 1 + 4;
+
+/** Serialization stream that writes to a single SHA256 */
+class SHA256Writer
+{
+private:
+    CSHA256& m_hasher;
+
+public:
+    explicit SHA256Writer(CSHA256& hasher) : m_hasher(hasher) {}
+    void write(const char* pch, size_t size) { m_hasher.Write((const unsigned char*)pch, size); }
+};
+
+/** Serialization stream that appends to a byte vector */
+class ByteVectorWriter
+{
+private:
+    std::vector<unsigned char>& m_data;
+
+public:
+    explicit ByteVectorWriter(std::vector<unsigned char>& data) : m_data(data) {}
+    void write(const char* pch, size_t size) { m_data.insert(m_data.end(), pch, pch + size); }
+
+    template <typename T>
+    ByteVectorWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+};
+
+template <class T>
+bool UseLegacyMidstates(const T& txTo)
+{
+    if (txTo.vin.size() < LEGACY_MIDSTATE_MIN_INPUTS) return false;
+    for (const auto& txin : txTo.vin) {
+        if (txin.scriptWitness.IsNull()) return true;
+    }
+    return false;
+}
+
+/**
+ * The legacy SIGHASH_ALL signature hash of input nIn from the precomputed
+ * serialization: the midstate before it, the blank inputs up to it, the
+ * input itself with scriptCode as its script, and everything after it as one
+ * contiguous write.
+ */
+template <class T>
+uint256 LegacySignatureHashFromMidstate(const CScript& scriptCode, const T& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData& cache)
+{
+    const std::vector<unsigned char>& data = cache.m_legacy_serialization;
+    const size_t input_pos = cache.m_legacy_inputs_offset + nIn * BLANK_INPUT_SIZE;
+    const size_t midstate_pos = cache.m_legacy_inputs_offset + (nIn - nIn % LEGACY_MIDSTATE_INTERVAL) * BLANK_INPUT_SIZE;
+
+    CSHA256 hasher = cache.m_legacy_midstates[nIn / LEGACY_MIDSTATE_INTERVAL];
+    // Everything up to and including the prevout of the input being signed
+    hasher.Write(data.data() + midstate_pos, input_pos + 36 - midstate_pos);
+    SHA256Writer s(hasher);
+    CTransactionSignatureSerializer<T>(txTo, scriptCode, nIn, nHashType).SerializeScriptCode(s);
+    // Its nSequence, the other inputs, the outputs and nLockTime
+    hasher.Write(data.data() + input_pos + 37, data.size() - input_pos - 37);
+    ::Serialize(s, nHashType);
+
+    uint256 result;
+    hasher.Finalize(result.begin());
+    CSHA256().Write(result.begin(), CSHA256::OUTPUT_SIZE).Finalize(result.begin());
+    return result;
+}
+
 } // namespace
 
 template <class T>
@@ -1224,6 +1445,24 @@ PrecomputedTransactionData::PrecomputedTransactionData(const T& txTo)
         hashOutputs = GetOutputsHash(txTo);
         ready = true;
     }
+
+    if (UseLegacyMidstates(txTo)) {
+        ByteVectorWriter s(m_legacy_serialization);
+        s << txTo.nVersion;
+        WriteCompactSize(s, txTo.vin.size());
+        m_legacy_inputs_offset = m_legacy_serialization.size();
+        for (const auto& txin : txTo.vin) {
+            s << txin.prevout << CScript() << txin.nSequence;
+        }
+        s << txTo.vout << txTo.nLockTime;
+
+        CSHA256 hasher;
+        hasher.Write(m_legacy_serialization.data(), m_legacy_inputs_offset);
+        for (size_t i = 0; i < txTo.vin.size(); i += LEGACY_MIDSTATE_INTERVAL) {
+            if (i > 0) hasher.Write(m_legacy_serialization.data() + m_legacy_inputs_offset + (i - LEGACY_MIDSTATE_INTERVAL) * BLANK_INPUT_SIZE, LEGACY_MIDSTATE_INTERVAL * BLANK_INPUT_SIZE);
+            m_legacy_midstates.push_back(hasher);
+        }
+    }
 }
 
 // explicit instantiation
@@ -1291,6 +1530,11 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
         }
     }
 
+    if (cache && !cache->m_legacy_midstates.empty() && !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        return LegacySignatureHashFromMidstate(scriptCode, txTo, nIn, nHashType, *cache);
+    }
+
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, nHashType);
 
@@ -1307,18 +1551,17 @@ bool GenericTransactionSignatureChecker<T>::VerifySignature(const std::vector<un
 }
 
 template <class T>
-bool GenericTransactionSignatureChecker<T>::CheckSig(const std::vector<unsigned char>& vchSigIn, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
+bool GenericTransactionSignatureChecker<T>::CheckSig(Span<const unsigned char> vchSigIn, Span<const unsigned char> vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
 {
-    CPubKey pubkey(vchPubKey);
+    CPubKey pubkey(vchPubKey.begin(), vchPubKey.end());
     if (!pubkey.IsValid())
         return false;
 
     // Hash type is one byte tacked on to the end of the signature
-    std::vector<unsigned char> vchSig(vchSigIn);
-    if (vchSig.empty())
+    if (vchSigIn.size() == 0)
         return false;
-    int nHashType = vchSig.back();
-    vchSig.pop_back();
+    int nHashType = vchSigIn[vchSigIn.size() - 1];
+    std::vector<unsigned char> vchSig(vchSigIn.begin(), vchSigIn.end() - 1);
 
     uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->txdata);
 
@@ -1418,7 +1661,7 @@ template class GenericTransactionSignatureChecker<CMutableTransaction>;
 
 static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
-    std::vector<std::vector<unsigned char> > stack;
+    std::vector<valtype> stack;
     CScript scriptPubKey;
 
     if (witversion == 0) {
@@ -1428,7 +1671,10 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_WITNESS_EMPTY);
             }
             scriptPubKey = CScript(witness.stack.back().begin(), witness.stack.back().end());
-            stack = std::vector<std::vector<unsigned char> >(witness.stack.begin(), witness.stack.end() - 1);
+            stack.reserve(witness.stack.size() - 1);
+            for (auto it = witness.stack.begin(); it != witness.stack.end() - 1; ++it) {
+                stack.emplace_back(it->begin(), it->end());
+            }
             uint256 hashScriptPubKey;
             CSHA256().Write(&scriptPubKey[0], scriptPubKey.size()).Finalize(hashScriptPubKey.begin());
             if (memcmp(hashScriptPubKey.begin(), program.data(), 32)) {
@@ -1440,7 +1686,10 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH); // 2 items in witness
             }
             scriptPubKey << OP_DUP << OP_HASH160 << program << OP_EQUALVERIFY << OP_CHECKSIG;
-            stack = witness.stack;
+            stack.reserve(2);
+            for (const auto& element : witness.stack) {
+                stack.emplace_back(element.begin(), element.end());
+            }
         } else {
             return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_WRONG_LENGTH);
         }
@@ -1483,11 +1732,11 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
         return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
     }
 
-    std::vector<std::vector<unsigned char> > stack, stackCopy;
+    std::vector<valtype> stack, stackCopy;
     if (!EvalScript(stack, scriptSig, flags, checker, SigVersion::BASE, serror))
         // serror is set
         return false;
-    if (flags & SCRIPT_VERIFY_P2SH)
+    if ((flags & SCRIPT_VERIFY_P2SH) && scriptPubKey.IsPayToScriptHash())
         stackCopy = stack;
     if (!EvalScript(stack, scriptPubKey, flags, checker, SigVersion::BASE, serror))
         // serror is set
@@ -1532,7 +1781,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
         assert(!stack.empty());
 
         const valtype& pubKeySerialized = stack.back();
-        CScript pubKey2(pubKeySerialized.begin(), pubKeySerialized.end());
+        CScript pubKey2(pubKeySerialized.data(), pubKeySerialized.data() + pubKeySerialized.size());
         popstack(stack);
 
         if (!EvalScript(stack, pubKey2, flags, checker, SigVersion::BASE, serror))
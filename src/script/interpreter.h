@@ -6,8 +6,11 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include <crypto/sha256.h>
+#include <prevector.h>
 #include <script/script_error.h>
 #include <primitives/transaction.h>
+#include <span.h>
 
 #include <vector>
 #include <stdint.h>
@@ -18,6 +21,14 @@ class CScript;
 class CTransaction;
 class uint256;
 
+/**
+ * An element of the interpreter's stack. Signatures (up to 73 bytes) and
+ * public keys (up to 65 bytes) are stored inline, so that pushing, copying
+ * and moving them around the stack does not allocate; only larger elements
+ * go on the heap.
+ */
+typedef prevector<76, unsigned char> ScriptStackElement;
+
 /** Signature hash types/flags */
 enum
 {
@@ -124,6 +135,17 @@ struct PrecomputedTransactionData
     uint256 hashPrevouts, hashSequence, hashOutputs;
     bool ready = false;
 
+    /**
+     * For the legacy SIGHASH_ALL signature hashes of a transaction with many
+     * non-witness inputs, which all hash the transaction with every input
+     * script blanked but their own: that serialization, where the inputs
+     * start, and the SHA256 midstates at every LEGACY_MIDSTATE_INTERVAL-th
+     * input of it. Empty if the transaction is too small to benefit.
+     */
+    std::vector<unsigned char> m_legacy_serialization;
+    size_t m_legacy_inputs_offset = 0;
+    std::vector<CSHA256> m_legacy_midstates;
+
     template <class T>
     explicit PrecomputedTransactionData(const T& tx);
 };
@@ -144,7 +166,7 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
 class BaseSignatureChecker
 {
 public:
-    virtual bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
+    virtual bool CheckSig(Span<const unsigned char> scriptSig, Span<const unsigned char> vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
     {
         return false;
     }
@@ -177,7 +199,7 @@ protected:
 public:
     GenericTransactionSignatureChecker(const T* txToIn, unsigned int nInIn, const CAmount& amountIn) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(nullptr) {}
     GenericTransactionSignatureChecker(const T* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(&txdataIn) {}
-    bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override;
+    bool CheckSig(Span<const unsigned char> scriptSig, Span<const unsigned char> vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override;
     bool CheckLockTime(const CScriptNum& nLockTime) const override;
     bool CheckSequence(const CScriptNum& nSequence) const override;
 };
@@ -203,6 +203,33 @@ bool CScript::IsPayToScriptHash() const
             (*this)[22] == OP_EQUAL);
 }
 
+bool CScript::IsPayToPubKeyHash() const
+{
+    // Extra-fast test for pay-to-pubkey-hash CScripts:
+    return (this->size() == 25 &&
+            (*this)[0] == OP_DUP &&
+            (*this)[1] == OP_HASH160 &&
+            (*this)[2] == 0x14 &&
+            (*this)[23] == OP_EQUALVERIFY &&
+            (*this)[24] == OP_CHECKSIG);
+}
+
+bool CScript::IsMultisig() const
+{
+    // Fast test for bare multisig CScripts: OP_m, n pushes of compressed or
+    // uncompressed public keys, OP_n, OP_CHECKMULTISIG
+    const size_t size = this->size();
+    if (size < 3 || (*this)[size - 1] != OP_CHECKMULTISIG) return false;
+    const opcodetype first = (opcodetype)(*this)[0], last = (opcodetype)(*this)[size - 2];
+    if (first < OP_1 || first > OP_16 || last < OP_1 || last > OP_16) return false;
+    size_t pos = 1;
+    for (int keys = DecodeOP_N(last); keys > 0; --keys) {
+        if (pos >= size - 2 || ((*this)[pos] != 33 && (*this)[pos] != 65)) return false;
+        pos += 1 + (*this)[pos];
+    }
+    return pos == size - 2;
+}
+
 bool CScript::IsPayToWitnessScriptHash() const
 {
     // Extra-fast test for pay-to-witness-script-hash CScripts:
@@ -220,7 +220,9 @@ public:
 
     static const size_t nDefaultMaxNumSize = 4;
 
-    explicit CScriptNum(const std::vector<unsigned char>& vch, bool fRequireMinimal,
+    //! Decode a number from a byte vector (or a prevector, as on the interpreter's stack).
+    template <typename V>
+    explicit CScriptNum(const V& vch, bool fRequireMinimal,
                         const size_t nMaxNumSize = nDefaultMaxNumSize)
     {
         if (vch.size() > nMaxNumSize) {
@@ -317,17 +319,19 @@ public:
         return m_value;
     }
 
-    std::vector<unsigned char> getvch() const
+    template <typename V = std::vector<unsigned char>>
+    V getvch() const
     {
-        return serialize(m_value);
+        return serialize<V>(m_value);
     }
 
-    static std::vector<unsigned char> serialize(const int64_t& value)
+    template <typename V = std::vector<unsigned char>>
+    static V serialize(const int64_t& value)
     {
         if(value == 0)
-            return std::vector<unsigned char>();
+            return V();
 
-        std::vector<unsigned char> result;
+        V result;
         const bool neg = value < 0;
         uint64_t absvalue = neg ? -value : value;
 
@@ -356,7 +360,8 @@ public:
     }
 
 private:
-    static int64_t set_vch(const std::vector<unsigned char>& vch)
+    template <typename V>
+    static int64_t set_vch(const V& vch)
     {
       if (vch.empty())
           return 0;
@@ -537,6 +542,8 @@ public:
     unsigned int GetSigOpCount(const CScript& scriptSig) const;
 
     bool IsPayToScriptHash() const;
+    bool IsPayToPubKeyHash() const;
+    bool IsMultisig() const;
     bool IsPayToWitnessScriptHash() const;
     bool IsWitnessProgram(int& version, std::vector<unsigned char>& program) const;
 
@@ -5,6 +5,7 @@
 
 #include <script/sigcache.h>
 
+#include <crypto/common.h>
 #include <memusage.h>
 #include <pubkey.h>
 #include <random.h>
@@ -14,6 +15,107 @@
 #include <cuckoocache.h>
 #include <boost/thread.hpp>
 
+#include <atomic>
+
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * The counters are written after the lock is released, on every lookup, so
+ * they are padded off the cache line of the mutex. The trailing padding keeps
+ * whatever is allocated after a shard off the line of its counters. Padding
+ * rather than alignas, as plain new does not honour over-alignment before C++17.
+ */
+struct ShardedValidityCache::Shard
+{
+    boost::shared_mutex mutex;
+    CuckooCache::cache<uint256, SignatureCacheHasher> set;
+    size_t max_elements{0};
+    char padding_counters[CACHE_LINE_SIZE];
+    mutable std::atomic<uint64_t> hits{0};
+    mutable std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> inserts{0};
+    std::atomic<uint64_t> evictions{0};
+    char padding_end[CACHE_LINE_SIZE];
+};
+
+ShardedValidityCache::ShardedValidityCache()
+{
+    m_shards.emplace_back(new Shard);
+}
+
+ShardedValidityCache::~ShardedValidityCache() {}
+
+size_t ShardedValidityCache::Setup(size_t max_bytes, unsigned int shards)
+{
+    assert(shards >= 1 && shards <= MAX_SIG_CACHE_SHARDS);
+    m_shards.clear();
+    size_t elements = 0;
+    for (unsigned int i = 0; i < shards; ++i) {
+        m_shards.emplace_back(new Shard);
+        m_shards.back()->max_elements = m_shards.back()->set.setup_bytes(max_bytes / shards);
+        elements += m_shards.back()->max_elements;
+    }
+    return elements;
+}
+
+ShardedValidityCache::Shard& ShardedValidityCache::GetShard(const uint256& entry) const
+{
+    // The cuckoo table places an entry by the high bits of each of its words
+    // (see SignatureCacheHasher), so use the low ones of the first word here.
+    return *m_shards[ReadLE32(entry.begin()) % m_shards.size()];
+}
+
+bool ShardedValidityCache::Contains(const uint256& entry, bool erase) const
+{
+    Shard& shard = GetShard(entry);
+    bool found;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+        found = shard.set.contains(entry, erase);
+    }
+    (found ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+    return found;
+}
+
+void ShardedValidityCache::Insert(const uint256& entry)
+{
+    Shard& shard = GetShard(entry);
+    bool evicted;
+    {
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+        evicted = shard.set.insert(entry);
+    }
+    shard.inserts.fetch_add(1, std::memory_order_relaxed);
+    if (evicted) shard.evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+ValidityCacheStats ShardedValidityCache::GetStats() const
+{
+    ValidityCacheStats stats;
+    for (const auto& shard : m_shards) {
+        stats.hits += shard->hits.load(std::memory_order_relaxed);
+        stats.misses += shard->misses.load(std::memory_order_relaxed);
+        stats.inserts += shard->inserts.load(std::memory_order_relaxed);
+        stats.evictions += shard->evictions.load(std::memory_order_relaxed);
+        stats.max_elements += shard->max_elements;
+    }
+    stats.shards = m_shards.size();
+    stats.bytes = stats.max_elements * sizeof(uint256);
+    return stats;
+}
+
+size_t SetupValidityCache(ShardedValidityCache& cache, const std::string& name)
+{
+    // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
+    // setup_bytes creates the minimum possible cache (2 elements per shard).
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    unsigned int nShards = std::min(std::max((int64_t)1, gArgs.GetArg("-sigcacheshards", DEFAULT_SIG_CACHE_SHARDS)), (int64_t)MAX_SIG_CACHE_SHARDS);
+    size_t nElems = cache.Setup(nMaxCacheSize, nShards);
+    LogPrintf("Using %zu MiB out of %zu/2 requested for %s cache in %u shards, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, name, nShards, nElems);
+    return nElems;
+}
+
 namespace {
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
@@ -25,9 +127,7 @@ class CSignatureCache
 private:
      //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    ShardedValidityCache setValid;
 
 public:
     CSignatureCache()
@@ -44,19 +144,15 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        return setValid.Contains(entry, erase);
     }
 
     void Set(uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
-    }
-    uint32_t setup_bytes(size_t n)
-    {
-        return setValid.setup_bytes(n);
+        setValid.Insert(entry);
     }
+
+    ShardedValidityCache& GetCache() { return setValid; }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -72,12 +168,12 @@ static CSignatureCache signatureCache;
 // signatureCache.
 void InitSignatureCache()
 {
-    // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
-    // setup_bytes creates the minimum possible cache (2 elements).
-    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
-    size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
-    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+    SetupValidityCache(signatureCache.GetCache(), "signature");
+}
+
+ValidityCacheStats GetSignatureCacheStats()
+{
+    return signatureCache.GetCache().GetStats();
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
@@ -8,6 +8,8 @@
 
 #include <script/interpreter.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -16,6 +18,9 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Number of independently locked shards each validation cache is split into
+static const unsigned int DEFAULT_SIG_CACHE_SHARDS = 8;
+static const unsigned int MAX_SIG_CACHE_SHARDS = 256;
 
 class CPubKey;
 
@@ -40,6 +45,61 @@ public:
     }
 };
 
+/** Usage counters and sizing of a ShardedValidityCache. */
+struct ValidityCacheStats
+{
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t inserts{0};
+    //! Live entries dropped to make room for new ones
+    uint64_t evictions{0};
+    size_t shards{0};
+    //! Number of entries the cache can hold, over all shards
+    size_t max_elements{0};
+    size_t bytes{0};
+};
+
+/**
+ * A set of nonced uint256 hashes, split over a number of CuckooCache shards
+ * that each have their own lock.
+ *
+ * The entry picks its shard, so concurrent script checks rarely contend for
+ * the same lock or touch the same cache lines, and lookups in different shards
+ * proceed in parallel. Hit, miss, insertion and eviction counts are kept per
+ * shard with relaxed atomics and summed by GetStats().
+ */
+class ShardedValidityCache
+{
+public:
+    ShardedValidityCache();
+    ~ShardedValidityCache();
+
+    /**
+     * Discard the contents and split max_bytes evenly over the given number of
+     * shards (between 1 and MAX_SIG_CACHE_SHARDS). Not thread safe: only to be
+     * called while no other thread uses the cache.
+     *
+     * @returns the number of elements the cache can hold
+     */
+    size_t Setup(size_t max_bytes, unsigned int shards);
+
+    /** Look up an entry, marking it for deletion if erase is set. */
+    bool Contains(const uint256& entry, bool erase) const;
+
+    void Insert(const uint256& entry);
+
+    ValidityCacheStats GetStats() const;
+
+private:
+    struct Shard;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+
+    Shard& GetShard(const uint256& entry) const;
+};
+
+/** Parse -maxsigcachesize and -sigcacheshards into the setup of one of the two validation caches. */
+size_t SetupValidityCache(ShardedValidityCache& cache, const std::string& name);
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -53,4 +113,6 @@ public:
 
 void InitSignatureCache();
 
+ValidityCacheStats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -913,8 +913,9 @@ protected:
     size_t nSize;
 
     const int nVersion;
+    const int nType;
 public:
-    explicit CSizeComputer(int nVersionIn) : nSize(0), nVersion(nVersionIn) {}
+    explicit CSizeComputer(int nVersionIn, int nTypeIn = 0) : nSize(0), nVersion(nVersionIn), nType(nTypeIn) {}
 
     void write(const char *psz, size_t _nSize)
     {
@@ -939,6 +940,7 @@ public:
     }
 
     int GetVersion() const { return nVersion; }
+    int GetType() const { return nType; }
 };
 
 template<typename Stream>
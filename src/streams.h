@@ -463,6 +463,13 @@ public:
         return (*this);
     }
 
+    /** Exchange the underlying storage with v and rewind, so buffers can be recycled. */
+    void SwapStorage(vector_type& v)
+    {
+        vch.swap(v);
+        nReadPos = 0;
+    }
+
     void GetAndClear(CSerializeData &d) {
         d.insert(d.end(), begin(), end());
         clear();
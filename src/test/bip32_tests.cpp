@@ -151,4 +151,38 @@ BOOST_AUTO_TEST_CASE(bip32_test3) {
     RunTest(test3);
 }
 
+BOOST_AUTO_TEST_CASE(bip32_derive_multi) {
+    CExtKey key;
+    const std::vector<unsigned char> seed = ParseHex(test1.strHexMaster);
+    key.SetSeed(seed.data(), seed.size());
+    const CExtPubKey pubkey = key.Neuter();
+
+    // Unhardened children around the lane boundaries, then a mix with hardened ones.
+    std::vector<unsigned int> children;
+    for (unsigned int i = 0; i < 13; ++i) children.push_back(i);
+    std::vector<CExtPubKey> pub_children;
+    BOOST_CHECK(pubkey.DeriveMulti(pub_children, children));
+    BOOST_CHECK_EQUAL(pub_children.size(), children.size());
+    for (size_t i = 0; i < children.size(); ++i) {
+        CExtPubKey expected;
+        BOOST_CHECK(pubkey.Derive(expected, children[i]));
+        BOOST_CHECK(pub_children[i] == expected);
+    }
+
+    children.push_back(0x80000000);
+    children.push_back(7);
+    children.push_back(0x80000005);
+    std::vector<CExtKey> key_children;
+    BOOST_CHECK(key.DeriveMulti(key_children, children));
+    BOOST_CHECK_EQUAL(key_children.size(), children.size());
+    for (size_t i = 0; i < children.size(); ++i) {
+        CExtKey expected;
+        BOOST_CHECK(key.Derive(expected, children[i]));
+        BOOST_CHECK(key_children[i] == expected);
+    }
+
+    BOOST_CHECK(pubkey.DeriveMulti(pub_children, {}));
+    BOOST_CHECK(pub_children.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
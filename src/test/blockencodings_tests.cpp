@@ -321,6 +321,52 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(MempoolFeeOrderTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildBlockTestCase());
+
+    // Fill the mempool with transactions paying more than the ones in the
+    // block, so that the lookup in fee rate order is not enough to find them.
+    LOCK2(cs_main, pool.cs);
+    for (int i = 0; i < 20; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.hash = InsecureRand256();
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 42;
+        pool.addUnchecked(entry.Fee(10000 + i).FromTx(tx));
+    }
+    pool.addUnchecked(entry.Fee(1).FromTx(block.vtx[1]));
+    pool.addUnchecked(entry.Fee(20000).FromTx(block.vtx[2]));
+
+    {
+        CBlockHeaderAndShortTxIDs shortIDs(block, true);
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs, extra_txn) == READ_STATUS_OK);
+        BOOST_CHECK(partialBlock.IsTxAvailable(0));
+        // Found by the fee rate lookup, and again when searching the rest of
+        // the mempool for the other one; that is not a short id collision.
+        BOOST_CHECK(partialBlock.IsTxAvailable(1));
+        BOOST_CHECK(partialBlock.IsTxAvailable(2));
+
+        CBlock block2;
+        std::vector<CTransactionRef> vtx_missing;
+        BOOST_CHECK(partialBlock.FillBlock(block2, vtx_missing) == READ_STATUS_OK);
+        BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+    }
+
+    pool.removeRecursive(*block.vtx[1]);
+    {
+        CBlockHeaderAndShortTxIDs shortIDs(block, true);
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs, extra_txn) == READ_STATUS_OK);
+        BOOST_CHECK(!partialBlock.IsTxAvailable(1));
+        BOOST_CHECK(partialBlock.IsTxAvailable(2));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
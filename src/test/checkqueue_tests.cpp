@@ -148,7 +148,7 @@ typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
  */
 static void Correct_Queue_range(std::vector<size_t> range)
 {
-    auto small_queue = MakeUnique<Correct_Queue>(QUEUE_BATCH_SIZE);
+    auto small_queue = MakeUnique<Correct_Queue>(QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{small_queue->Thread();});
@@ -212,7 +212,7 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
 /** Test that failing checks are caught */
 BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
 {
-    auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE);
+    auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS);
 
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
@@ -245,7 +245,7 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
 // future blocks, ie, the bad state is cleared.
 BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
 {
-    auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE);
+    auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{fail_queue->Thread();});
@@ -273,7 +273,7 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
 // more than once as well
 BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
 {
-    auto queue = MakeUnique<Unique_Queue>(QUEUE_BATCH_SIZE);
+    auto queue = MakeUnique<Unique_Queue>(QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{queue->Thread();});
@@ -302,6 +302,40 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
 }
 
 
+// Test that every check is called exactly once with more workers than
+// there are per-worker queues, so that some workers share one, and batches
+// of all sizes are stolen between them.
+BOOST_AUTO_TEST_CASE(test_CheckQueue_ManyWorkers)
+{
+    auto queue = MakeUnique<Unique_Queue>(QUEUE_BATCH_SIZE, 8);
+    boost::thread_group tg;
+    for (auto x = 0; x < 24; ++x) {
+       tg.create_thread([&]{queue->Thread();});
+    }
+
+    UniqueCheck::results.clear();
+    size_t COUNT = 100000;
+    for (size_t total = COUNT; total;) {
+        CCheckQueueControl<UniqueCheck> control(queue.get());
+        // A single large batch, then many small ones
+        for (size_t batch = 0; batch < 100 && total; ++batch) {
+            size_t r = batch == 0 ? 5000 : InsecureRandRange(10);
+            std::vector<UniqueCheck> vChecks;
+            for (size_t k = 0; k < r && total; k++)
+                vChecks.emplace_back(--total);
+            control.Add(vChecks);
+        }
+        BOOST_REQUIRE(control.Wait());
+    }
+    BOOST_REQUIRE_EQUAL(UniqueCheck::results.size(), COUNT);
+    bool r = true;
+    for (size_t i = 0; i < COUNT; ++i)
+        r = r && UniqueCheck::results.count(i) == 1;
+    BOOST_REQUIRE(r);
+    tg.interrupt_all();
+    tg.join_all();
+}
+
 // Test that blocks which might allocate lots of memory free their memory aggressively.
 //
 // This test attempts to catch a pathological case where by lazily freeing
@@ -309,7 +343,7 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
 // time could leave the data hanging across a sequence of blocks.
 BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory)
 {
-    auto queue = MakeUnique<Memory_Queue>(QUEUE_BATCH_SIZE);
+    auto queue = MakeUnique<Memory_Queue>(QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{queue->Thread();});
@@ -340,7 +374,7 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory)
 // have been destructed
 BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup)
 {
-    auto queue = MakeUnique<FrozenCleanup_Queue>(QUEUE_BATCH_SIZE);
+    auto queue = MakeUnique<FrozenCleanup_Queue>(QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS);
     boost::thread_group tg;
     bool fails = false;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
@@ -384,7 +418,7 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup)
 /** Test that CCheckQueueControl is threadsafe */
 BOOST_AUTO_TEST_CASE(test_CheckQueueControl_Locks)
 {
-    auto queue = MakeUnique<Standard_Queue>(QUEUE_BATCH_SIZE);
+    auto queue = MakeUnique<Standard_Queue>(QUEUE_BATCH_SIZE, MAX_SCRIPTCHECK_THREADS);
     {
         boost::thread_group tg;
         std::atomic<int> nThreads {0};
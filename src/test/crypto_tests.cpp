@@ -4,6 +4,7 @@
 
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
+#include <crypto/chacha_poly_aead.h>
 #include <crypto/poly1305.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
@@ -11,6 +12,7 @@
 #include <crypto/sha512.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
+#include <crypto/hkdf_sha256_32.h>
 #include <random.h>
 #include <util/strencodings.h>
 #include <test/setup_common.h>
@@ -149,6 +151,52 @@ static void TestPoly1305(const std::string &hexmessage, const std::string &hexke
     BOOST_CHECK(tag == tagres);
 }
 
+static void TestChaCha20Poly1305AEAD(const std::string& hexk1, const std::string& hexk2, uint64_t seqnr, const std::string& hexplain, const std::string& hexcipher)
+{
+    std::vector<unsigned char> k1 = ParseHex(hexk1);
+    std::vector<unsigned char> k2 = ParseHex(hexk2);
+    std::vector<unsigned char> plain = ParseHex(hexplain);
+    std::vector<unsigned char> cipher = ParseHex(hexcipher);
+    ChaCha20Poly1305AEAD aead(k1.data(), k1.size(), k2.data(), k2.size());
+
+    std::vector<unsigned char> out(plain.size() + POLY1305_TAGLEN);
+    BOOST_CHECK(aead.Crypt(seqnr, out.data(), out.size(), plain.data(), plain.size(), true));
+    BOOST_CHECK_EQUAL(HexStr(out), hexcipher);
+    BOOST_CHECK_EQUAL(aead.GetLength(seqnr, cipher.data()), plain[0] | (plain[1] << 8) | (plain[2] << 16));
+
+    // Decrypting in place gives the plaintext back.
+    BOOST_CHECK(aead.Crypt(seqnr, out.data(), out.size() - POLY1305_TAGLEN, out.data(), out.size(), false));
+    out.resize(plain.size());
+    BOOST_CHECK(out == plain);
+
+    // Any change to the ciphertext, or the wrong sequence number, fails authentication.
+    BOOST_CHECK(!aead.Crypt(seqnr + 1, out.data(), out.size(), cipher.data(), cipher.size(), false));
+    for (size_t pos : {(size_t)0, cipher.size() / 2, cipher.size() - 1}) {
+        std::vector<unsigned char> tampered = cipher;
+        tampered[pos] ^= 1;
+        BOOST_CHECK(!aead.Crypt(seqnr, out.data(), out.size(), tampered.data(), tampered.size(), false));
+    }
+    // So do wrong sizes.
+    BOOST_CHECK(!aead.Crypt(seqnr, out.data(), out.size() + 1, cipher.data(), cipher.size(), false));
+    BOOST_CHECK(!aead.Crypt(seqnr, out.data(), 0, cipher.data(), POLY1305_TAGLEN, false));
+}
+
+static void TestHKDF_SHA256_32(const std::string& ikm_hex, const std::string& salt_hex, const std::string& info_hex, const std::string& okm_check_hex)
+{
+    std::vector<unsigned char> initial_key_material = ParseHex(ikm_hex);
+    std::vector<unsigned char> salt = ParseHex(salt_hex);
+    std::vector<unsigned char> info = ParseHex(info_hex);
+
+    // our implementation only supports strings for the "info" and "salt", stringify them
+    std::string salt_stringified(reinterpret_cast<char*>(salt.data()), salt.size());
+    std::string info_stringified(reinterpret_cast<char*>(info.data()), info.size());
+
+    CHKDF_HMAC_SHA256_L32 hkdf32(initial_key_material.data(), initial_key_material.size(), salt_stringified);
+    unsigned char out[32];
+    hkdf32.Expand32(info_stringified, out);
+    BOOST_CHECK(HexStr(out, out + 32) == okm_check_hex);
+}
+
 static std::string LongTestString() {
     std::string ret;
     for (int i=0; i<200000; i++) {
@@ -517,6 +565,64 @@ BOOST_AUTO_TEST_CASE(poly1305_testvector)
                  "13000000000000000000000000000000");
 }
 
+BOOST_AUTO_TEST_CASE(chacha20_crypt)
+{
+    // Crypt is the keystream of Output xored into the input, in any number of steps.
+    const std::vector<unsigned char> key = ParseHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    std::vector<unsigned char> in(300), keystream(300), out(300);
+    for (size_t i = 0; i < in.size(); ++i) in[i] = InsecureRand32();
+    ChaCha20 chacha(key.data(), key.size());
+    chacha.SetIV(7);
+    chacha.Seek(0);
+    chacha.Output(keystream.data(), keystream.size());
+    chacha.Seek(0);
+    chacha.Crypt(in.data(), out.data(), 64);
+    chacha.Crypt(in.data() + 64, out.data() + 64, in.size() - 64);
+    for (size_t i = 0; i < in.size(); ++i) {
+        BOOST_CHECK_EQUAL(out[i], in[i] ^ keystream[i]);
+    }
+    chacha.Seek(0);
+    chacha.Crypt(out.data(), out.data(), out.size());
+    BOOST_CHECK(out == in);
+}
+
+BOOST_AUTO_TEST_CASE(chacha20_poly1305_aead_testvector)
+{
+    TestChaCha20Poly1305AEAD("0000000000000000000000000000000000000000000000000000000000000000",
+                             "0000000000000000000000000000000000000000000000000000000000000000", 0,
+                             "01000000",
+                             "77b8e09faa042473a958ef9f7a30cb1cdf947c4e");
+    TestChaCha20Poly1305AEAD("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+                             "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f", 999,
+                             "fb00000776657273696f6e000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f20212223"
+                             "2425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f50515253"
+                             "5455565758595a5b5c5d5e5f606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f80818283"
+                             "8485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9fa0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3"
+                             "b4b5b6b7b8b9babbbcbdbebfc0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedfe0e1e2e3"
+                             "e4e5e6e7e8e9eaebecedeeeff0f1f2",
+                             "9168716f5ce9cbd4346e2b735987039d4d27c3b3bd5fe96a21dd87f97ea1d3ea14308b45d3ad8cc238d2c026e7fb7f75"
+                             "d6ebe9223e9396facc83bb5a26633a473ae36577659ad852d25b9a8c1b7e11b61e4837886aedccf0b2700cbe32b0e0f8"
+                             "5d9ddbe73833c612d0a1312f4dc50f75e7d228a41d4799bf3ce586a59bc50066b9ec9471a8e5131bdf2bf79eeaaa5cc8"
+                             "5c4de6ef301d6c6b27d09d9e648d7bc1fd51e44fe0973ba3bff261ff3008c410c725a2e215b3c540ac5133ba2a0bb535"
+                             "784cd4f67122938cc3e451cae99dacd61da5f4d7d25c840fbe5ba50b1fc4ba48fe7836f21e989802b93f5c00a9de5706"
+                             "2a0373c21bc6b966230e3f3990ad29decf58f93a5a20e35c8efc52901251");
+}
+
+BOOST_AUTO_TEST_CASE(hkdf_hmac_sha256_l32_tests)
+{
+    // Use rfc5869 test vectors but truncated to 32 bytes (our implementation only support length 32)
+    TestHKDF_SHA256_32(
+        /* IKM */ "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+        /* salt */ "000102030405060708090a0b0c",
+        /* info */ "f0f1f2f3f4f5f6f7f8f9",
+        /* expected OKM */ "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf");
+    TestHKDF_SHA256_32(
+        "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+        "",
+        "",
+        "8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d");
+}
+
 BOOST_AUTO_TEST_CASE(countbits_tests)
 {
     FastRandomContext ctx;
@@ -539,7 +645,7 @@ BOOST_AUTO_TEST_CASE(countbits_tests)
     }
 }
 
-BOOST_AUTO_TEST_CASE(sha256d64)
+static void TestSHA256D64()
 {
     for (int i = 0; i <= 32; ++i) {
         unsigned char in[64 * 32];
@@ -555,4 +661,131 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+static void TestSHA256Multi()
+{
+    for (int count : {0, 1, 2, 3, 7, 8, 9, 33, 100}) {
+        // Messages of all lengths around the chunk and padding boundaries
+        std::vector<std::vector<unsigned char>> messages(count);
+        std::vector<const unsigned char*> inputs(count);
+        std::vector<size_t> lengths(count);
+        for (int i = 0; i < count; ++i) {
+            messages[i].resize(InsecureRandBool() ? InsecureRandRange(200) : InsecureRandRange(2000));
+            for (unsigned char& c : messages[i]) c = InsecureRandBits(8);
+            inputs[i] = messages[i].data();
+            lengths[i] = messages[i].size();
+        }
+        std::vector<unsigned char> expected(32 * count), expected_double(32 * count), out(32 * count);
+        for (int i = 0; i < count; ++i) {
+            CSHA256().Write(inputs[i], lengths[i]).Finalize(expected.data() + 32 * i);
+            CHash256().Write(inputs[i], lengths[i]).Finalize(expected_double.data() + 32 * i);
+        }
+        SHA256Multi(out.data(), inputs.data(), lengths.data(), count);
+        BOOST_CHECK(out == expected);
+        SHA256DMulti(out.data(), inputs.data(), lengths.data(), count);
+        BOOST_CHECK(out == expected_double);
+    }
+}
+
+/** Run a test once with each SHA256 implementation this host supports, restricted to its kernels. */
+static void ForEachSHA256Implementation(void (*test)())
+{
+    using namespace sha256_implementation;
+    for (UseImplementation use : {STANDARD, USE_SSE4, USE_SSE4_AND_AVX2, USE_SHANI}) {
+        BOOST_TEST_MESSAGE("Using the '" << SHA256AutoDetect(use) << "' SHA256 implementation");
+        test();
+    }
+    SHA256AutoDetect();
+}
+
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    ForEachSHA256Implementation(TestSHA256D64);
+}
+
+BOOST_AUTO_TEST_CASE(sha256multi)
+{
+    ForEachSHA256Implementation(TestSHA256Multi);
+}
+
+BOOST_AUTO_TEST_CASE(sha512_finalize_multi)
+{
+    for (int count : {0, 1, 3, 4, 5, 9, 30}) {
+        // A prefix of whole chunks or not, and messages around the chunk and padding boundaries
+        for (size_t prefix_len : {0, 128, 256, 77}) {
+            std::vector<unsigned char> prefix(prefix_len);
+            for (unsigned char& c : prefix) c = InsecureRandBits(8);
+            CSHA512 hasher;
+            hasher.Write(prefix.data(), prefix.size());
+            std::vector<std::vector<unsigned char>> messages(count);
+            std::vector<const unsigned char*> inputs(count);
+            std::vector<size_t> lengths(count);
+            for (int i = 0; i < count; ++i) {
+                messages[i].resize(InsecureRandRange(400));
+                for (unsigned char& c : messages[i]) c = InsecureRandBits(8);
+                inputs[i] = messages[i].data();
+                lengths[i] = messages[i].size();
+            }
+            std::vector<unsigned char> expected(64 * count), out(64 * count);
+            for (int i = 0; i < count; ++i) {
+                CSHA512(hasher).Write(inputs[i], lengths[i]).Finalize(expected.data() + 64 * i);
+            }
+            hasher.FinalizeMulti(out.data(), inputs.data(), lengths.data(), count);
+            BOOST_CHECK(out == expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hmac_sha512_multi)
+{
+    const std::vector<unsigned char> key = ParseHex("4a656665");
+    const std::vector<unsigned char> message = ParseHex("7768617420646f2079612077616e7420666f72206e6f7468696e673f");
+    const std::vector<unsigned char> expected = ParseHex(
+        "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+        "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737");
+    std::vector<const unsigned char*> inputs(5, message.data());
+    std::vector<size_t> lengths(5, message.size());
+    std::vector<unsigned char> out(64 * 5);
+    CHMAC_SHA512(key.data(), key.size()).FinalizeMulti(out.data(), inputs.data(), lengths.data(), inputs.size());
+    for (int i = 0; i < 5; ++i) {
+        BOOST_CHECK(std::equal(expected.begin(), expected.end(), out.begin() + 64 * i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ripemd160_32)
+{
+    // Counts that exercise every combination of 8-way, 4-way and single hashes.
+    for (int count : {0, 1, 3, 4, 5, 8, 12, 13, 17}) {
+        std::vector<unsigned char> in(32 * count), out(20 * count), expected(20 * count);
+        for (unsigned char& c : in) c = InsecureRandBits(8);
+        for (int i = 0; i < count; ++i) {
+            CRIPEMD160().Write(in.data() + 32 * i, 32).Finalize(expected.data() + 20 * i);
+        }
+        RIPEMD160_32(out.data(), in.data(), count);
+        BOOST_CHECK(out == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hash160multi)
+{
+    for (int count : {0, 1, 2, 9, 40}) {
+        // Public key sized messages, and some others
+        std::vector<std::vector<unsigned char>> messages(count);
+        std::vector<const unsigned char*> inputs(count);
+        std::vector<size_t> lengths(count);
+        for (int i = 0; i < count; ++i) {
+            static const int SIZES[] = {33, 65, 0, 22, 100};
+            messages[i].resize(SIZES[InsecureRandRange(5)]);
+            for (unsigned char& c : messages[i]) c = InsecureRandBits(8);
+            inputs[i] = messages[i].data();
+            lengths[i] = messages[i].size();
+        }
+        std::vector<unsigned char> expected(20 * count), out(20 * count);
+        for (int i = 0; i < count; ++i) {
+            CHash160().Write(inputs[i], lengths[i]).Finalize(expected.data() + 20 * i);
+        }
+        Hash160Multi(out.data(), inputs.data(), lengths.data(), count);
+        BOOST_CHECK(out == expected);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -362,4 +362,63 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/** Test that insert reports exactly the live elements it had to drop, so that
+ * the table holds the number of distinct inserts minus the evictions.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_evictions)
+{
+    SeedInsecureRand(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    const uint32_t elements = cc.setup(1 << 10);
+    std::vector<uint256> hashes;
+    size_t evictions = 0;
+    for (uint32_t i = 0; i < 2 * elements; ++i) {
+        hashes.push_back(InsecureRand256());
+        evictions += cc.insert(hashes.back());
+    }
+    BOOST_CHECK(evictions >= elements);
+    size_t present = 0;
+    for (const uint256& h : hashes) present += cc.contains(h, false);
+    BOOST_CHECK_EQUAL(present, hashes.size() - evictions);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_validity_cache)
+{
+    SeedInsecureRand(true);
+    ShardedValidityCache cache;
+    const size_t elements = cache.Setup(1 << 20, 4);
+    ValidityCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.shards, 4U);
+    BOOST_CHECK_EQUAL(stats.max_elements, elements);
+    BOOST_CHECK_EQUAL(stats.bytes, elements * sizeof(uint256));
+    BOOST_CHECK(stats.bytes <= (1 << 20) && stats.bytes > (1 << 19));
+
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 1000; ++i) {
+        hashes.push_back(InsecureRand256());
+        BOOST_CHECK(!cache.Contains(hashes.back(), false));
+        cache.Insert(hashes.back());
+    }
+    for (const uint256& h : hashes) BOOST_CHECK(cache.Contains(h, false));
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.hits, 1000U);
+    BOOST_CHECK_EQUAL(stats.misses, 1000U);
+    BOOST_CHECK_EQUAL(stats.inserts, 1000U);
+    BOOST_CHECK_EQUAL(stats.evictions, 0U);
+
+    // Overfill it: every insert beyond the capacity evicts an entry.
+    for (size_t i = 0; i < 2 * elements; ++i) cache.Insert(InsecureRand256());
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.inserts, 1000U + 2 * elements);
+    BOOST_CHECK(stats.evictions >= elements);
+
+    // Setting it up again empties it and resets the counters.
+    cache.Setup(0, 1);
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.inserts, 0U);
+    BOOST_CHECK_EQUAL(stats.shards, 1U);
+    BOOST_CHECK_EQUAL(stats.max_elements, 2U);
+    BOOST_CHECK(!cache.Contains(hashes[0], false));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -160,6 +160,23 @@ void Check(const std::string& prv, const std::string& pub, int flags, const std:
         }
     }
 
+    // Expanding the whole range at once must give the same results as expanding each position.
+    for (int t = 0; t < 2; ++t) {
+        const FlatSigningProvider& key_provider = (flags & HARDENED) ? keys_priv : keys_pub;
+        FlatSigningProvider range_provider, pos_provider;
+        std::vector<std::vector<CScript>> range_spks;
+        BOOST_CHECK((t ? parse_priv : parse_pub)->ExpandRange(0, max, key_provider, range_spks, range_provider));
+        BOOST_CHECK_EQUAL(range_spks.size(), max);
+        for (size_t i = 0; i < max && i < range_spks.size(); ++i) {
+            std::vector<CScript> spks;
+            BOOST_CHECK((t ? parse_priv : parse_pub)->Expand(i, key_provider, spks, pos_provider));
+            BOOST_CHECK(range_spks[i] == spks);
+        }
+        BOOST_CHECK(range_provider.pubkeys == pos_provider.pubkeys);
+        BOOST_CHECK(range_provider.scripts == pos_provider.scripts);
+        BOOST_CHECK(range_provider.origins == pos_provider.origins);
+    }
+
     // Verify no expected paths remain that were not observed.
     BOOST_CHECK_MESSAGE(left_paths.empty(), "Not all expected key paths found: " + prv);
 }
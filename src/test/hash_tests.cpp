@@ -148,4 +148,39 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(siphash_multi)
+{
+    // Compare the Multi functions against one hash at a time, with counts
+    // that leave every possible remainder of lanes.
+    FastRandomContext ctx;
+    for (size_t count = 0; count <= 20; ++count) {
+        const uint64_t k0 = ctx.rand64(), k1 = ctx.rand64();
+
+        std::vector<uint256> vals(count);
+        std::vector<const uint256*> val_ptrs;
+        for (uint256& val : vals) {
+            val = InsecureRand256();
+            val_ptrs.push_back(&val);
+        }
+        std::vector<uint64_t> out(count);
+        SipHashUint256Multi(k0, k1, out.data(), val_ptrs.data(), count);
+        for (size_t i = 0; i < count; ++i) {
+            BOOST_CHECK_EQUAL(out[i], SipHashUint256(k0, k1, vals[i]));
+        }
+
+        std::vector<std::vector<unsigned char>> messages(count);
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> lengths;
+        for (std::vector<unsigned char>& message : messages) {
+            message = ctx.randbytes(ctx.randrange(100));
+            inputs.push_back(message.data());
+            lengths.push_back(message.size());
+        }
+        SipHashMulti(k0, k1, out.data(), inputs.data(), lengths.data(), count);
+        for (size_t i = 0; i < count; ++i) {
+            BOOST_CHECK_EQUAL(out[i], CSipHasher(k0, k1).Write(inputs[i], lengths[i]).Finalize());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -188,4 +188,25 @@ BOOST_AUTO_TEST_CASE(key_signature_tests)
     BOOST_CHECK(found_small);
 }
 
+BOOST_AUTO_TEST_CASE(key_ecdh)
+{
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(false);
+    uint256 secret1, secret2, secret3;
+    BOOST_CHECK(key2.GetPubKey().ComputeECDHSecret(key1.begin(), secret1));
+    BOOST_CHECK(key1.GetPubKey().ComputeECDHSecret(key2.begin(), secret2));
+    BOOST_CHECK(secret1 == secret2);
+    BOOST_CHECK(!secret1.IsNull());
+
+    // A different key pair gives a different secret.
+    CKey key3;
+    key3.MakeNewKey(true);
+    BOOST_CHECK(key3.GetPubKey().ComputeECDHSecret(key1.begin(), secret3));
+    BOOST_CHECK(secret3 != secret1);
+
+    // Invalid public keys are rejected.
+    BOOST_CHECK(!CPubKey().ComputeECDHSecret(key1.begin(), secret3));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
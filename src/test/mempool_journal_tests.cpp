@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/mempool_journal.h>
+#include <primitives/transaction.h>
+#include <util/system.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(mempool_journal_tests, BasicTestingSetup)
+
+static CTransactionRef MakeTx(int n)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].scriptSig = CScript() << n;
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = n;
+    return MakeTransactionRef(mtx);
+}
+
+//! Replay a journal into a list of "+txid" / "-txid" events.
+static bool ReplayEvents(const fs::path& path, uint64_t id, std::vector<std::string>& events)
+{
+    events.clear();
+    return MempoolJournal::Replay(path, id,
+        [&](const CTransactionRef& tx, int64_t) { events.push_back("+" + tx->GetHash().ToString()); },
+        [&](const uint256& txid) { events.push_back("-" + txid.ToString()); });
+}
+
+BOOST_AUTO_TEST_CASE(journal_replay)
+{
+    const fs::path path = SetDataDir("mempool_journal") / "mempool.journal";
+    const CTransactionRef tx1 = MakeTx(1), tx2 = MakeTx(2), tx3 = MakeTx(3);
+    std::vector<std::string> events;
+
+    MempoolJournal journal(path);
+    // Nothing is recorded before the first rotation.
+    journal.TransactionAdded(tx3, 0);
+    const uint64_t id1 = journal.Rotate();
+    BOOST_CHECK(id1 != 0);
+    journal.TransactionAdded(tx1, 10);
+    journal.TransactionAdded(tx2, 20);
+    journal.TransactionRemoved(tx1->GetHash());
+    BOOST_CHECK(journal.Commit() > 0);
+
+    BOOST_CHECK(ReplayEvents(path, id1, events));
+    BOOST_CHECK(events == std::vector<std::string>({"+" + tx1->GetHash().ToString(), "+" + tx2->GetHash().ToString(), "-" + tx1->GetHash().ToString()}));
+    BOOST_CHECK(!ReplayEvents(path, id1 + 1, events));
+    BOOST_CHECK(!ReplayEvents(path, 0, events));
+
+    // The previous generation stays replayable until it is discarded, and
+    // gets the changes buffered before the rotation.
+    journal.TransactionRemoved(tx2->GetHash());
+    const uint64_t id2 = journal.Rotate();
+    BOOST_CHECK(id2 != id1);
+    journal.TransactionAdded(tx3, 30);
+    journal.Commit();
+    BOOST_CHECK(ReplayEvents(path, id1, events));
+    BOOST_CHECK_EQUAL(events.size(), 4U);
+    BOOST_CHECK(ReplayEvents(path, id2, events));
+    BOOST_CHECK(events == std::vector<std::string>({"+" + tx3->GetHash().ToString()}));
+    journal.DiscardPrevious();
+    BOOST_CHECK(!ReplayEvents(path, id1, events));
+
+    // A record torn by an unclean shutdown is skipped.
+    journal.TransactionRemoved(tx3->GetHash());
+    const uint64_t size = journal.Commit();
+    FILE* file = fsbridge::fopen(path, "rb+");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK(TruncateFile(file, size - 1));
+    fclose(file);
+    BOOST_CHECK(ReplayEvents(path, id2, events));
+    BOOST_CHECK(events == std::vector<std::string>({"+" + tx3->GetHash().ToString()}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
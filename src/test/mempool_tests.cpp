@@ -9,6 +9,7 @@
 #include <test/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 #include <list>
 #include <vector>
 
@@ -75,6 +76,12 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
         testPool.addUnchecked(entry.FromTx(txChild[i]));
         testPool.addUnchecked(entry.FromTx(txGrandChild[i]));
     }
+    // Direct links are tracked in the entries, ordered by txid:
+    const CTxMemPoolEntry::Links& parentChildren = testPool.GetMemPoolChildren(testPool.mapTx.find(txParent.GetHash()));
+    BOOST_CHECK_EQUAL(parentChildren.size(), 3U);
+    BOOST_CHECK(std::is_sorted(parentChildren.begin(), parentChildren.end(),
+        [](const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) { return a->GetTx().GetHash() < b->GetTx().GetHash(); }));
+    BOOST_CHECK_EQUAL(testPool.GetMemPoolParents(testPool.mapTx.find(txGrandChild[1].GetHash())).size(), 1U);
     // Remove Child[0], GrandChild[0] should be removed:
     poolSize = testPool.size();
     testPool.removeRecursive(CTransaction(txChild[0]));
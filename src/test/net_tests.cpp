@@ -302,5 +302,115 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
     BOOST_CHECK_EQUAL(IsLocal(addr), false);
 }
 
+BOOST_AUTO_TEST_CASE(net_buffer_pool)
+{
+    NetBufferPool<std::vector<unsigned char>> pool(4096);
+
+    std::vector<unsigned char> buf = pool.Take(100);
+    BOOST_CHECK(buf.empty());
+    BOOST_CHECK(buf.capacity() >= 100);
+    buf.resize(1000);
+    const size_t capacity = buf.capacity();
+    pool.Give(std::move(buf));
+    NetBufferPoolStats stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.allocated, 1U);
+    BOOST_CHECK_EQUAL(stats.pooled, 1U);
+    BOOST_CHECK_EQUAL(stats.pooled_bytes, capacity);
+
+    // A larger request than the pooled buffer can hold is allocated
+    buf = pool.Take(capacity + 1);
+    BOOST_CHECK(buf.capacity() > capacity);
+    BOOST_CHECK_EQUAL(pool.GetStats().allocated, 2U);
+    pool.Give(std::move(buf));
+
+    // Smaller ones reuse pooled buffers, and get them back empty
+    buf = pool.Take(24);
+    BOOST_CHECK(buf.capacity() >= capacity);
+    BOOST_CHECK(buf.empty());
+    BOOST_CHECK_EQUAL(pool.GetStats().reused, 1U);
+    pool.Give(std::move(buf));
+
+    // Buffers over the size limits are freed
+    pool.Give(pool.Take(4096));
+    buf.reserve(NetBufferPool<std::vector<unsigned char>>::MAX_BUFFER_SIZE + 1);
+    pool.Give(std::move(buf));
+    stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.discarded, 2U);
+    BOOST_CHECK(stats.pooled_bytes <= 4096);
+}
+
+BOOST_AUTO_TEST_CASE(framed_net_msg)
+{
+    CSerializedNetMsg msg;
+    msg.command = "cmpctblock";
+    msg.data = {1, 2, 3, 4, 5};
+    const CFramedNetMsg framed(std::move(msg));
+    BOOST_CHECK_EQUAL(framed.command, "cmpctblock");
+    BOOST_CHECK(framed.data == std::vector<unsigned char>({1, 2, 3, 4, 5}));
+
+    CMessageHeader hdr(Params().MessageStart());
+    CDataStream stream(framed.header, SER_NETWORK, INIT_PROTO_VERSION);
+    stream >> hdr;
+    BOOST_CHECK(stream.empty());
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), "cmpctblock");
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, 5U);
+    const uint256 hash = Hash(framed.data.begin(), framed.data.end());
+    BOOST_CHECK(memcmp(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(encrypted_transport)
+{
+    const unsigned char K_1[CHACHA20_POLY1305_AEAD_KEY_LEN] = {1};
+    const unsigned char K_2[CHACHA20_POLY1305_AEAD_KEY_LEN] = {2};
+    EncryptedTransportSerializer serializer(K_1, K_2);
+    EncryptedTransportDeserializer deserializer(K_1, K_2);
+
+    // Messages of various sizes, each read back in chunks of a different size
+    std::vector<unsigned char> stream;
+    std::vector<size_t> sizes{0, 1, 100, 100000};
+    for (size_t size : sizes) {
+        CSerializedNetMsg msg;
+        msg.command = size == 0 ? "verack" : "tx";
+        msg.data.resize(size);
+        for (size_t i = 0; i < size; ++i) msg.data[i] = i;
+        std::vector<unsigned char> header;
+        serializer.PrepareForTransport(msg, header);
+        BOOST_CHECK(header.empty());
+        // 3 bytes of length, the command with its length and the tag
+        BOOST_CHECK_EQUAL(msg.data.size(), 3 + 1 + (size == 0 ? 6 : 2) + size + 16);
+        stream.insert(stream.end(), msg.data.begin(), msg.data.end());
+    }
+
+    size_t pos = 0;
+    for (size_t size : sizes) {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+        const size_t chunk = 1 + size / 3;
+        while (!msg.complete()) {
+            BOOST_REQUIRE(pos < stream.size());
+            const int read = deserializer.Read(msg, (const char*)stream.data() + pos, std::min(chunk, stream.size() - pos));
+            BOOST_REQUIRE(read > 0);
+            pos += read;
+        }
+        BOOST_CHECK(msg.m_authenticated);
+        BOOST_CHECK_EQUAL(msg.hdr.GetCommand(), size == 0 ? "verack" : "tx");
+        BOOST_CHECK_EQUAL(msg.hdr.nMessageSize, size);
+        BOOST_REQUIRE_EQUAL(msg.vRecv.size(), size);
+        for (size_t i = 0; i < size; ++i) BOOST_CHECK_EQUAL((unsigned char)msg.vRecv[i], (unsigned char)i);
+    }
+    BOOST_CHECK_EQUAL(pos, stream.size());
+
+    // A changed byte fails authentication.
+    CSerializedNetMsg msg;
+    msg.command = "ping";
+    msg.data.resize(8);
+    std::vector<unsigned char> header;
+    serializer.PrepareForTransport(msg, header);
+    msg.data[5] ^= 1;
+    CNetMessage received(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    BOOST_CHECK_EQUAL(deserializer.Read(received, (const char*)msg.data.data(), 3), 3);
+    BOOST_CHECK_EQUAL(deserializer.Read(received, (const char*)msg.data.data() + 3, msg.data.size() - 3), -1);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
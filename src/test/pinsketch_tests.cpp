@@ -0,0 +1,88 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pinsketch.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(pinsketch_tests, BasicTestingSetup)
+
+static uint32_t RandomElement()
+{
+    uint32_t element;
+    do {
+        element = InsecureRand32();
+    } while (element == 0);
+    return element;
+}
+
+BOOST_AUTO_TEST_CASE(pinsketch_decode)
+{
+    for (size_t capacity : {1, 2, 5, 20, 64}) {
+        for (size_t difference = 0; difference <= capacity; ++difference) {
+            // Sets with a few elements in common and difference elements in one or the other
+            PinSketch sketch1(capacity), sketch2(capacity);
+            std::vector<uint32_t> expected;
+            for (int i = 0; i < 10; ++i) {
+                const uint32_t element = RandomElement();
+                sketch1.Add(element);
+                sketch2.Add(element);
+            }
+            for (size_t i = 0; i < difference; ++i) {
+                expected.push_back(RandomElement());
+                (InsecureRandBool() ? sketch1 : sketch2).Add(expected.back());
+            }
+
+            // Merging goes through serialization, as the sketch of a peer would.
+            PinSketch merged = PinSketch::Deserialize(sketch2.Serialize());
+            BOOST_CHECK_EQUAL(merged.GetCapacity(), capacity);
+            merged.Merge(sketch1);
+            std::vector<uint32_t> elements;
+            BOOST_CHECK(merged.Decode(elements));
+            std::sort(elements.begin(), elements.end());
+            std::sort(expected.begin(), expected.end());
+            BOOST_CHECK(elements == expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pinsketch_over_capacity)
+{
+    // With capacity to spare, more elements than are decoded for are detected.
+    for (size_t max_elements : {1, 4, 16}) {
+        for (size_t count = max_elements + 1; count <= 3 * max_elements + 2; ++count) {
+            PinSketch sketch(max_elements + 1);
+            for (size_t i = 0; i < count; ++i) {
+                sketch.Add(RandomElement());
+            }
+            std::vector<uint32_t> elements{1};
+            BOOST_CHECK(!sketch.Decode(elements, max_elements));
+            BOOST_CHECK(elements.empty());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pinsketch_add_twice)
+{
+    PinSketch sketch(4);
+    const uint32_t element = RandomElement();
+    const std::vector<unsigned char> empty = sketch.Serialize();
+    BOOST_CHECK_EQUAL(empty.size(), 4 * PinSketch::ELEMENT_SIZE);
+    sketch.Add(element);
+    BOOST_CHECK(sketch.Serialize() != empty);
+    std::vector<uint32_t> elements;
+    BOOST_CHECK(sketch.Decode(elements));
+    BOOST_CHECK(elements == std::vector<uint32_t>{element});
+    sketch.Add(element);
+    BOOST_CHECK(sketch.Serialize() == empty);
+    BOOST_CHECK(sketch.Decode(elements));
+    BOOST_CHECK(elements.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
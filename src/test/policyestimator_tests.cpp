@@ -4,6 +4,7 @@
 
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <scheduler.h>
 #include <txmempool.h>
 #include <uint256.h>
 #include <util/system.h>
@@ -180,4 +181,40 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BackgroundUpdates)
+{
+    // The scheduler is not serviced, so queued updates wait until flushed.
+    CScheduler scheduler;
+    CBlockPolicyEstimator direct, queued;
+    queued.StartBackgroundUpdates(scheduler);
+    CTxMemPool direct_pool(&direct), queued_pool(&queued);
+    LOCK2(cs_main, direct_pool.cs);
+    LOCK(queued_pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    for (int blocknum = 0; blocknum < 50; blocknum++) {
+        std::vector<CTransactionRef> block;
+        for (int j = 0; j < 20; j++) {
+            tx.vin[0].prevout.n = 100 * blocknum + j;
+            direct_pool.addUnchecked(entry.Fee(1000 * (j + 1)).Height(blocknum).FromTx(tx));
+            queued_pool.addUnchecked(entry.Fee(1000 * (j + 1)).Height(blocknum).FromTx(tx));
+            // Only the higher fee half gets confirmed in the next block
+            if (j >= 10) block.push_back(MakeTransactionRef(tx));
+        }
+        direct_pool.removeForBlock(block, blocknum + 1);
+        queued_pool.removeForBlock(block, blocknum + 1);
+    }
+
+    BOOST_CHECK(direct.estimateSmartFee(2, nullptr, false) != CFeeRate(0));
+    BOOST_CHECK(queued.estimateSmartFee(2, nullptr, false) == CFeeRate(0));
+    queued.FlushQueuedUpdates();
+    for (int target = 1; target <= 25; target++) {
+        BOOST_CHECK(direct.estimateSmartFee(target, nullptr, false) == queued.estimateSmartFee(target, nullptr, false));
+        BOOST_CHECK(direct.estimateSmartFee(target, nullptr, true) == queued.estimateSmartFee(target, nullptr, true));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
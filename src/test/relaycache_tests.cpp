@@ -0,0 +1,58 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <core_memusage.h>
+#include <node/relaycache.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(relaycache_tests, BasicTestingSetup)
+
+static CTransactionRef MakeTx(int n)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].scriptSig = CScript() << n;
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = n;
+    return MakeTransactionRef(mtx);
+}
+
+BOOST_AUTO_TEST_CASE(relay_cache_limits)
+{
+    const CTransactionRef tx1 = MakeTx(1), tx2 = MakeTx(2), tx3 = MakeTx(3);
+    const size_t usage = RecursiveDynamicUsage(tx1);
+
+    // Room for two transactions
+    RelayCache cache(2 * usage);
+    const int64_t now = 1000000000;
+    cache.Add(tx1, now);
+    cache.Add(tx2, now + 1);
+    cache.Add(tx1, now + 2);
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+    BOOST_CHECK(cache.Find(tx1->GetHash()) == tx1);
+    BOOST_CHECK(cache.Find(tx2->GetHash()) == tx2);
+    BOOST_CHECK(!cache.Find(tx3->GetHash()));
+
+    // The oldest one makes room for a new one
+    cache.Add(tx3, now + 3);
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= 2 * usage);
+    BOOST_CHECK(!cache.Find(tx1->GetHash()));
+    BOOST_CHECK(cache.Find(tx3->GetHash()) == tx3);
+
+    // Transactions expire in the order they were added
+    RelayCache large_cache(10 * usage);
+    large_cache.Add(tx1, now);
+    large_cache.Add(tx2, now + 1);
+    large_cache.Add(tx3, now + 2);
+    large_cache.Add(MakeTx(4), now + 1 + RelayCache::EXPIRY);
+    BOOST_CHECK_EQUAL(large_cache.Size(), 3U);
+    BOOST_CHECK(!large_cache.Find(tx1->GetHash()));
+    BOOST_CHECK(large_cache.Find(tx2->GetHash()) == tx2);
+    BOOST_CHECK(large_cache.Find(tx3->GetHash()) == tx3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
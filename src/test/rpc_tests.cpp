@@ -4,6 +4,7 @@
 
 #include <rpc/server.h>
 #include <rpc/client.h>
+#include <rpc/jsonstream.h>
 #include <rpc/util.h>
 
 #include <core_io.h>
@@ -419,4 +420,41 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
     }
 }
 
+BOOST_AUTO_TEST_CASE(rpc_json_stream)
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("a", 1);
+    inner.pushKV("b\"c", UniValue(UniValue::VARR));
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("empty", UniValue(UniValue::VOBJ));
+    expected.pushKV("inner", inner);
+    UniValue list(UniValue::VARR);
+    list.push_back(inner);
+    list.push_back("x");
+    list.push_back(NullUniValue);
+    expected.pushKV("list", list);
+
+    // A tiny flush size makes the sink see many small chunks.
+    std::string out;
+    size_t chunks = 0;
+    JSONStreamWriter stream([&](const std::string& chunk) { out += chunk; ++chunks; }, 4);
+    BOOST_CHECK(!stream.IsUsed());
+    stream.BeginObject();
+    stream.Key("empty");
+    stream.BeginObject();
+    stream.EndObject();
+    stream.KeyValue("inner", inner);
+    stream.Key("list");
+    stream.BeginArray();
+    stream.Value(inner);
+    stream.Value("x");
+    stream.Value(NullUniValue);
+    stream.EndArray();
+    stream.EndObject();
+    stream.Flush();
+    BOOST_CHECK(stream.IsUsed());
+    BOOST_CHECK(chunks > 1);
+    BOOST_CHECK_EQUAL(out, expected.write());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
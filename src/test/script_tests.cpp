@@ -1520,6 +1520,158 @@ BOOST_AUTO_TEST_CASE(script_can_append_self)
     BOOST_CHECK(s == d);
 }
 
+// Accepts signature sig for public key pubkey and signature sig2 for pubkey2,
+// whatever the script code.
+class DummyKeysChecker : public BaseSignatureChecker
+{
+private:
+    const std::vector<unsigned char> &m_sig, &m_pubkey, &m_sig2, &m_pubkey2;
+
+public:
+    DummyKeysChecker(const std::vector<unsigned char>& sig, const std::vector<unsigned char>& pubkey, const std::vector<unsigned char>& sig2, const std::vector<unsigned char>& pubkey2) :
+        m_sig(sig), m_pubkey(pubkey), m_sig2(sig2), m_pubkey2(pubkey2) {}
+
+    bool CheckSig(Span<const unsigned char> sig, Span<const unsigned char> pubkey, const CScript& scriptCode, SigVersion sigversion) const override
+    {
+        return (sig == MakeSpan(m_sig) && pubkey == MakeSpan(m_pubkey)) || (sig == MakeSpan(m_sig2) && pubkey == MakeSpan(m_pubkey2));
+    }
+};
+
+BOOST_AUTO_TEST_CASE(script_p2pkh_template)
+{
+    // P2PKH scripts are executed without being decoded. The same script with a
+    // non-minimal push of the hash goes through the generic interpreter, and
+    // must give the same results and errors, and leave the same stack.
+    typedef std::vector<unsigned char> valtype;
+    CKey key, key2;
+    key.MakeNewKey(true);
+    key2.MakeNewKey(false);
+    const valtype pubkey = ToByteVector(key.GetPubKey());
+    const valtype pubkey2 = ToByteVector(key2.GetPubKey());
+    valtype sig, sig2, sig_other;
+    BOOST_CHECK(key.Sign(uint256S("1"), sig));
+    BOOST_CHECK(key2.Sign(uint256S("1"), sig2));
+    BOOST_CHECK(key.Sign(uint256S("2"), sig_other));
+    sig.push_back(SIGHASH_ALL);
+    sig2.push_back(SIGHASH_ALL);
+    sig_other.push_back(SIGHASH_ALL);
+    valtype sig_bad_hashtype = sig;
+    sig_bad_hashtype.back() = 0x42;
+    valtype sig_bad_der = sig;
+    sig_bad_der[1]++;
+    const DummyKeysChecker checker(sig, pubkey, sig2, pubkey2);
+
+    std::vector<std::vector<valtype>> stacks{
+        {sig, pubkey}, {sig_other, pubkey}, {sig2, pubkey2}, {sig, pubkey2}, {{}, pubkey}, {sig_bad_hashtype, pubkey},
+        {sig_bad_der, pubkey}, {pubkey}, {}, {{1}, sig, pubkey}, {sig, {}}, {pubkey, sig}};
+    // Stacks at and beyond the most the script can grow without exceeding MAX_STACK_SIZE
+    for (size_t size : {MAX_STACK_SIZE - 2, MAX_STACK_SIZE - 1, MAX_STACK_SIZE}) {
+        stacks.emplace_back(size - 2, valtype{1});
+        stacks.back().push_back(sig);
+        stacks.back().push_back(pubkey);
+    }
+
+    for (const valtype& hash_pubkey : {pubkey, pubkey2}) {
+        const CKeyID id = CPubKey(hash_pubkey).GetID();
+        const CScript script = GetScriptForDestination(id);
+        CScript script_generic = CScript() << OP_DUP << OP_HASH160 << OP_PUSHDATA1;
+        script_generic.push_back(id.size());
+        script_generic.insert(script_generic.end(), id.begin(), id.end());
+        script_generic << OP_EQUALVERIFY << OP_CHECKSIG;
+        BOOST_CHECK(script.IsPayToPubKeyHash());
+        BOOST_CHECK(!script_generic.IsPayToPubKeyHash());
+
+        for (const std::vector<valtype>& stack : stacks) {
+            for (int flags : {0, (int)SCRIPT_VERIFY_STRICTENC,
+                              SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_LOW_S | SCRIPT_VERIFY_NULLFAIL,
+                              SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_NULLFAIL | SCRIPT_VERIFY_WITNESS_PUBKEYTYPE | SCRIPT_VERIFY_CONST_SCRIPTCODE}) {
+                for (SigVersion sigversion : {SigVersion::BASE, SigVersion::WITNESS_V0}) {
+                    std::vector<valtype> stack1 = stack, stack2 = stack;
+                    ScriptError err1, err2;
+                    const bool ret1 = EvalScript(stack1, script, flags, checker, sigversion, &err1);
+                    const bool ret2 = EvalScript(stack2, script_generic, flags, checker, sigversion, &err2);
+                    BOOST_CHECK_EQUAL(ret1, ret2);
+                    BOOST_CHECK_EQUAL(ScriptErrorString(err1), ScriptErrorString(err2));
+                    BOOST_CHECK(stack1 == stack2);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(script_multisig_template)
+{
+    // Bare multisig scripts (as redeemed by P2SH and P2WSH multisig) are
+    // executed without being decoded. The same script behind an OP_NOP goes
+    // through the generic interpreter, and must give the same results and
+    // errors, and leave the same stack.
+    typedef std::vector<unsigned char> valtype;
+    CKey key, key2, key3;
+    key.MakeNewKey(true);
+    key2.MakeNewKey(false);
+    key3.MakeNewKey(true);
+    const valtype pubkey = ToByteVector(key.GetPubKey());
+    const valtype pubkey2 = ToByteVector(key2.GetPubKey());
+    valtype sig, sig2, sig_other;
+    BOOST_CHECK(key.Sign(uint256S("1"), sig));
+    BOOST_CHECK(key2.Sign(uint256S("1"), sig2));
+    BOOST_CHECK(key.Sign(uint256S("2"), sig_other));
+    sig.push_back(SIGHASH_ALL);
+    sig2.push_back(SIGHASH_ALL);
+    sig_other.push_back(SIGHASH_ALL);
+    valtype sig_bad_der = sig;
+    sig_bad_der[1]++;
+    const DummyKeysChecker checker(sig, pubkey, sig2, pubkey2);
+
+    std::vector<std::vector<valtype>> stacks{
+        {{}, sig, sig2}, {{}, sig2, sig}, {{}, sig}, {{}, sig2}, {{}, sig_other, sig2}, {{}, {}, {}}, {{}, {}, sig2},
+        {{1}, sig, sig2}, {sig, sig2}, {sig}, {}, {{}, sig_bad_der, sig2}, {{}, sig2, sig_bad_der}, {{}, sig, {}, sig2}};
+    // Stacks at and beyond the most the scripts below can grow without exceeding MAX_STACK_SIZE
+    for (size_t size : {MAX_STACK_SIZE - 6, MAX_STACK_SIZE - 5, MAX_STACK_SIZE - 4, MAX_STACK_SIZE - 2}) {
+        stacks.emplace_back(size - 2, valtype{});
+        stacks.back().push_back(sig);
+        stacks.back().push_back(sig2);
+    }
+
+    const std::vector<CPubKey> keys{key.GetPubKey(), key2.GetPubKey(), key3.GetPubKey()};
+    const std::vector<CScript> scripts{
+        GetScriptForMultisig(2, keys),
+        GetScriptForMultisig(1, keys),
+        GetScriptForMultisig(2, {key.GetPubKey(), key2.GetPubKey()}),
+        GetScriptForMultisig(1, {key2.GetPubKey()}),
+        GetScriptForMultisig(2, {key3.GetPubKey(), key2.GetPubKey(), key.GetPubKey()}),
+        CScript() << OP_3 << pubkey << pubkey2 << OP_2 << OP_CHECKMULTISIG};
+    for (const CScript& script : scripts) {
+        const CScript script_generic = (CScript() << OP_NOP) + script;
+        BOOST_CHECK(script.IsMultisig());
+        BOOST_CHECK(!script_generic.IsMultisig());
+
+        for (const std::vector<valtype>& stack : stacks) {
+            for (int flags : {0, (int)SCRIPT_VERIFY_STRICTENC,
+                              SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_LOW_S | SCRIPT_VERIFY_NULLFAIL | SCRIPT_VERIFY_NULLDUMMY,
+                              SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_NULLFAIL | SCRIPT_VERIFY_WITNESS_PUBKEYTYPE | SCRIPT_VERIFY_CONST_SCRIPTCODE | SCRIPT_VERIFY_MINIMALDATA}) {
+                for (SigVersion sigversion : {SigVersion::BASE, SigVersion::WITNESS_V0}) {
+                    std::vector<valtype> stack1 = stack, stack2 = stack;
+                    ScriptError err1, err2;
+                    const bool ret1 = EvalScript(stack1, script, flags, checker, sigversion, &err1);
+                    const bool ret2 = EvalScript(stack2, script_generic, flags, checker, sigversion, &err2);
+                    BOOST_CHECK_EQUAL(ret1, ret2);
+                    BOOST_CHECK_EQUAL(ScriptErrorString(err1), ScriptErrorString(err2));
+                    BOOST_CHECK(stack1 == stack2);
+                }
+            }
+        }
+    }
+
+    // Not the template
+    BOOST_CHECK(!(CScript() << OP_1 << pubkey << OP_2 << OP_CHECKMULTISIG).IsMultisig());
+    BOOST_CHECK(!(CScript() << OP_1 << pubkey << pubkey2 << OP_1 << OP_CHECKMULTISIG).IsMultisig());
+    BOOST_CHECK(!(CScript() << OP_1 << valtype(32, 2) << OP_1 << OP_CHECKMULTISIG).IsMultisig());
+    BOOST_CHECK(!(CScript() << OP_1 << pubkey << OP_1 << OP_CHECKMULTISIGVERIFY).IsMultisig());
+    BOOST_CHECK(!(CScript() << OP_0 << OP_0 << OP_CHECKMULTISIG).IsMultisig());
+    BOOST_CHECK(!(CScript() << OP_1 << pubkey << OP_1 << OP_CHECKMULTISIG << OP_NOP).IsMultisig());
+}
+
 
 #if defined(HAVE_CONSENSUS_LIB)
 
@@ -9,7 +9,10 @@
 #include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/ripemd160.h>
 #include <crypto/sha256.h>
+#include <crypto/sha512.h>
+#include <crypto/siphash.h>
 #include <miner.h>
 #include <net_processing.h>
 #include <noui.h>
@@ -36,6 +39,9 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     : m_path_root(fs::temp_directory_path() / "test_common_" PACKAGE_NAME / strprintf("%lu_%i", (unsigned long)GetTime(), (int)(InsecureRandRange(1 << 30))))
 {
     SHA256AutoDetect();
+    RIPEMD160AutoDetect();
+    SHA512AutoDetect();
+    SipHashAutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
@@ -92,12 +92,12 @@ void static RandomScript(CScript &script) {
         script << oplist[InsecureRandRange(sizeof(oplist)/sizeof(oplist[0]))];
 }
 
-void static RandomTransaction(CMutableTransaction &tx, bool fSingle) {
+void static RandomTransaction(CMutableTransaction &tx, bool fSingle, int max_ins = 4) {
     tx.nVersion = InsecureRand32();
     tx.vin.clear();
     tx.vout.clear();
     tx.nLockTime = (InsecureRandBool()) ? InsecureRand32() : 0;
-    int ins = (InsecureRandBits(2)) + 1;
+    int ins = InsecureRandRange(max_ins) + 1;
     int outs = fSingle ? ins : (InsecureRandBits(2)) + 1;
     for (int in = 0; in < ins; in++) {
         tx.vin.push_back(CTxIn());
@@ -161,6 +161,32 @@ BOOST_AUTO_TEST_CASE(sighash_test)
     #endif
 }
 
+// Legacy signature hashes of transactions with many inputs, which are computed
+// from the midstates in PrecomputedTransactionData.
+BOOST_AUTO_TEST_CASE(sighash_legacy_midstates)
+{
+    SeedInsecureRand(false);
+
+    for (int i = 0; i < 200; i++) {
+        const int nHashTypeSingle = InsecureRand32();
+        CMutableTransaction txTo;
+        RandomTransaction(txTo, (nHashTypeSingle & 0x1f) == SIGHASH_SINGLE, 40);
+        const CTransaction tx(txTo);
+        const PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK_EQUAL(txdata.m_legacy_midstates.empty(), tx.vin.size() < 8);
+
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+            CScript scriptCode;
+            RandomScript(scriptCode);
+            for (int nHashType : {nHashTypeSingle, (int)SIGHASH_ALL, (int)(InsecureRand32() & ~SIGHASH_ANYONECANPAY)}) {
+                const uint256 sho = SignatureHashOld(scriptCode, tx, nIn, nHashType);
+                BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, 0, SigVersion::BASE, &txdata) == sho);
+                BOOST_CHECK(SignatureHash(scriptCode, txTo, nIn, nHashType, 0, SigVersion::BASE, &txdata) == sho);
+            }
+        }
+    }
+}
+
 // Goal: check that SignatureHash generates correct hash
 BOOST_AUTO_TEST_CASE(sighash_from_data)
 {
@@ -206,6 +232,10 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
 
         sh = SignatureHash(scriptCode, *tx, nIn, nHashType, 0, SigVersion::BASE);
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
+
+        const PrecomputedTransactionData txdata(*tx);
+        sh = SignatureHash(scriptCode, *tx, nIn, nHashType, 0, SigVersion::BASE, &txdata);
+        BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
 BOOST_AUTO_TEST_SUITE_END()
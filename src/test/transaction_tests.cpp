@@ -11,6 +11,7 @@
 #include <consensus/tx_check.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <crypto/sha256.h>
 #include <key.h>
 #include <keystore.h>
 #include <validation.h>
@@ -464,7 +465,7 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction)
     // check all inputs concurrently, with the cache
     PrecomputedTransactionData txdata(tx);
     boost::thread_group threadGroup;
-    CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+    CCheckQueue<CScriptCheck> scriptcheckqueue(128, MAX_SCRIPTCHECK_THREADS);
     CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
 
     for (int i=0; i<20; i++)
@@ -769,4 +770,41 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     BOOST_CHECK(!IsStandardTx(CTransaction(t), reason));
 }
 
+BOOST_AUTO_TEST_CASE(make_transaction_refs)
+{
+    std::vector<CMutableTransaction> txs(50);
+    for (size_t i = 0; i < txs.size(); ++i) {
+        CMutableTransaction& tx = txs[i];
+        tx.vin.resize(1 + i % 3);
+        for (CTxIn& in : tx.vin) {
+            in.prevout = COutPoint(InsecureRand256(), InsecureRandBits(2));
+            in.scriptSig = CScript() << std::vector<unsigned char>(i * 7 % 120, 3);
+            if (i % 2) in.scriptWitness.stack.assign(i % 4, std::vector<unsigned char>(i * 13, 1));
+        }
+        tx.vout.resize(1 + i % 5);
+        for (CTxOut& out : tx.vout) {
+            out.nValue = InsecureRandBits(40);
+            out.scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(i, 2);
+        }
+    }
+    // Only the implementations with at least four lanes take the batched
+    // path, so go through each of them, comparing with serial hashing.
+    using namespace sha256_implementation;
+    for (UseImplementation use : {STANDARD, USE_SSE4, USE_SSE4_AND_AVX2, USE_SHANI}) {
+        BOOST_TEST_MESSAGE("Using the '" << SHA256AutoDetect(use) << "' SHA256 implementation");
+        std::vector<CMutableTransaction> copies = txs;
+        const std::vector<CTransactionRef> refs = MakeTransactionRefs(std::move(copies));
+        BOOST_REQUIRE_EQUAL(refs.size(), txs.size());
+        for (size_t i = 0; i < txs.size(); ++i) {
+            const CTransaction expected(txs[i]);
+            BOOST_CHECK(refs[i]->GetHash() == expected.GetHash());
+            BOOST_CHECK(refs[i]->GetWitnessHash() == expected.GetWitnessHash());
+            BOOST_CHECK(refs[i]->vin == expected.vin);
+            BOOST_CHECK(refs[i]->vout == expected.vout);
+        }
+        BOOST_CHECK(MakeTransactionRefs({}).empty());
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txannouncequeue.h>
+#include <policy/policy.h>
+#include <txmempool.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txannouncequeue_tests, TestingSetup)
+
+static CTransactionRef MakeTx(const COutPoint& prevout, int n)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = prevout;
+    mtx.vin[0].scriptSig = CScript() << n;
+    mtx.vout.resize(1);
+    mtx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    mtx.vout[0].nValue = COIN;
+    return MakeTransactionRef(mtx);
+}
+
+//! Visit up to max transactions from the queue, returning their txids in order.
+static std::vector<uint256> Announce(TxAnnouncementQueue& queue, uint64_t& cursor, int64_t now, size_t max = 1000)
+{
+    std::vector<uint256> txids;
+    queue.ForEach(cursor, now, [&](const TxMempoolInfo& info) {
+        if (txids.size() == max) return false;
+        txids.push_back(info.tx->GetHash());
+        return true;
+    });
+    return txids;
+}
+
+BOOST_AUTO_TEST_CASE(announce_order)
+{
+    CTxMemPool pool;
+    TxAnnouncementQueue queue(pool);
+    TestMemPoolEntryHelper entry;
+
+    const CTransactionRef low = MakeTx(COutPoint(InsecureRand256(), 0), 1);
+    const CTransactionRef high = MakeTx(COutPoint(InsecureRand256(), 0), 2);
+    const CTransactionRef child = MakeTx(COutPoint(low->GetHash(), 0), 3);
+    const CTransactionRef gone = MakeTx(COutPoint(InsecureRand256(), 0), 4);
+    {
+        LOCK2(cs_main, pool.cs);
+        pool.addUnchecked(entry.Fee(1000).FromTx(low));
+        pool.addUnchecked(entry.Fee(5000).FromTx(high));
+        pool.addUnchecked(entry.Fee(50000).FromTx(child));
+    }
+
+    const int64_t start = 1000000000;
+    uint64_t cursor1 = queue.End();
+    queue.Add(child->GetHash(), start);
+    queue.Add(low->GetHash(), start);
+    queue.Add(gone->GetHash(), start);
+    queue.Add(high->GetHash(), start + 1);
+    queue.Add(low->GetHash(), start + 2);
+    // A peer that connects now does not get what was queued before
+    uint64_t cursor2 = queue.End();
+    BOOST_CHECK_EQUAL(queue.Size(), 5U);
+
+    // Nothing is announced while the bucket is open
+    BOOST_CHECK(Announce(queue, cursor1, start + TxAnnouncementQueue::BUCKET_DURATION - 1).empty());
+
+    // Then parents come first and otherwise higher fee rates, duplicates and
+    // transactions that are not in the mempool are dropped
+    const int64_t now = start + TxAnnouncementQueue::BUCKET_DURATION;
+    std::vector<uint256> expected{high->GetHash(), low->GetHash(), child->GetHash()};
+    uint64_t cursor3 = cursor1;
+    BOOST_CHECK(Announce(queue, cursor1, now) == expected);
+    BOOST_CHECK_EQUAL(queue.Size(), 3U);
+    BOOST_CHECK(Announce(queue, cursor1, now).empty());
+    BOOST_CHECK(Announce(queue, cursor2, now).empty());
+
+    // Each peer keeps its own position
+    BOOST_CHECK(Announce(queue, cursor3, now, 2) == std::vector<uint256>(expected.begin(), expected.begin() + 2));
+    BOOST_CHECK(Announce(queue, cursor3, now) == std::vector<uint256>{child->GetHash()});
+
+    // Transactions queued after the bucket was sorted go into a new one
+    queue.Add(child->GetHash(), now);
+    BOOST_CHECK(Announce(queue, cursor1, now).empty());
+    BOOST_CHECK(Announce(queue, cursor2, now + TxAnnouncementQueue::BUCKET_DURATION) == std::vector<uint256>{child->GetHash()});
+
+    // Old buckets expire, and peers that were behind skip them
+    queue.Add(high->GetHash(), now + TxAnnouncementQueue::MAX_AGE + TxAnnouncementQueue::BUCKET_DURATION);
+    BOOST_CHECK_EQUAL(queue.Size(), 1U);
+    BOOST_CHECK(Announce(queue, cursor3, now + TxAnnouncementQueue::MAX_AGE + 2 * TxAnnouncementQueue::BUCKET_DURATION) == std::vector<uint256>{high->GetHash()});
+}
+
+BOOST_AUTO_TEST_CASE(announce_batches)
+{
+    CTxMemPool pool;
+    TxAnnouncementQueue queue(pool);
+    TestMemPoolEntryHelper entry;
+
+    // More transactions than ForEach copies out at a time, over two buckets
+    const int64_t start = 1000000000;
+    uint64_t cursor = queue.End();
+    for (int i = 0; i < 2500; ++i) {
+        const CTransactionRef tx = MakeTx(COutPoint(InsecureRand256(), 0), i);
+        {
+            LOCK2(cs_main, pool.cs);
+            pool.addUnchecked(entry.Fee(1000).FromTx(tx));
+        }
+        queue.Add(tx->GetHash(), start + (i < 1200 ? 0 : TxAnnouncementQueue::BUCKET_DURATION));
+    }
+    const int64_t now = start + 2 * TxAnnouncementQueue::BUCKET_DURATION;
+
+    // fn runs without the queue locked, so it may use the queue itself
+    size_t visited = 0;
+    queue.ForEach(cursor, now, [&](const TxMempoolInfo& info) {
+        BOOST_CHECK_EQUAL(queue.Size(), 2500U);
+        return ++visited < 1700;
+    });
+    BOOST_CHECK_EQUAL(visited, 1700U);
+    BOOST_CHECK_EQUAL(Announce(queue, cursor, now).size(), 801U);
+    BOOST_CHECK(Announce(queue, cursor, now).empty());
+    BOOST_CHECK_EQUAL(cursor, queue.End());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
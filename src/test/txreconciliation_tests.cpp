@@ -0,0 +1,159 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+static std::vector<uint256> AddRandom(TxReconciliationState& state, size_t n)
+{
+    std::vector<uint256> txids;
+    for (size_t i = 0; i < n; ++i) {
+        txids.push_back(InsecureRand256());
+        BOOST_CHECK(state.Add(txids.back()));
+    }
+    std::sort(txids.begin(), txids.end());
+    return txids;
+}
+
+static std::vector<uint256> Sorted(std::vector<uint256> txids)
+{
+    std::sort(txids.begin(), txids.end());
+    return txids;
+}
+
+BOOST_AUTO_TEST_CASE(reconcile_difference)
+{
+    const uint64_t salt1 = g_insecure_rand_ctx.rand64(), salt2 = g_insecure_rand_ctx.rand64();
+    TxReconciliationState initiator(true, salt1, salt2), responder(false, salt2, salt1);
+    const uint256 txid = InsecureRand256();
+    BOOST_CHECK_EQUAL(initiator.ShortId(txid), responder.ShortId(txid));
+
+    // Transactions both sides know about cancel out.
+    for (int i = 0; i < 20; ++i) {
+        const uint256 shared = InsecureRand256();
+        initiator.Add(shared);
+        responder.Add(shared);
+    }
+    const std::vector<uint256> initiator_only = AddRandom(initiator, 3);
+    const std::vector<uint256> responder_only = AddRandom(responder, 2);
+
+    BOOST_CHECK(initiator.IsRequestDue(0));
+    BOOST_CHECK(!responder.IsRequestDue(0));
+    BOOST_CHECK_EQUAL(initiator.StartRequest(100, 50), 23U);
+    BOOST_CHECK(!initiator.IsRequestDue(100));
+    // Transactions added during a reconciliation wait for the next one.
+    initiator.Add(InsecureRand256());
+    BOOST_CHECK_EQUAL(initiator.GetSetSize(), 1U);
+
+    std::vector<unsigned char> sketch;
+    std::vector<uint256> announce;
+    responder.HandleRequest(23, sketch, announce);
+    BOOST_CHECK(announce.empty());
+    BOOST_CHECK_EQUAL(sketch.size(), 4 * (TxReconciliationState::EstimateCapacity(22, 23) + TxReconciliationState::SKETCH_CHECK_CAPACITY));
+    BOOST_CHECK(TxReconciliationState::IsValidSketch(sketch));
+
+    std::vector<uint32_t> request;
+    BOOST_CHECK(!initiator.IsRequestExpired(49));
+    BOOST_CHECK(!initiator.SkipStaleSketch());
+    BOOST_CHECK(initiator.HandleSketch(sketch, announce, request));
+    BOOST_CHECK(Sorted(announce) == initiator_only);
+    BOOST_CHECK_EQUAL(request.size(), 2U);
+
+    responder.HandleDiff(true, request, announce);
+    BOOST_CHECK(Sorted(announce) == responder_only);
+    BOOST_CHECK(!initiator.IsInProgress());
+    BOOST_CHECK(!responder.IsInProgress());
+    BOOST_CHECK(!initiator.IsRequestDue(99));
+    BOOST_CHECK(initiator.IsRequestDue(100));
+}
+
+BOOST_AUTO_TEST_CASE(reconcile_failure)
+{
+    TxReconciliationState initiator(true, 1, 2), responder(false, 2, 1);
+    // Entirely different sets are more than the sketch can hold.
+    const std::vector<uint256> initiator_set = AddRandom(initiator, 10);
+    const std::vector<uint256> responder_set = AddRandom(responder, 10);
+
+    std::vector<unsigned char> sketch;
+    std::vector<uint256> announce;
+    responder.HandleRequest(initiator.StartRequest(0, 0), sketch, announce);
+    std::vector<uint32_t> request;
+    BOOST_CHECK(!initiator.HandleSketch(sketch, announce, request));
+    BOOST_CHECK(Sorted(announce) == initiator_set);
+    BOOST_CHECK(request.empty());
+
+    // Then the responder announces its whole set too.
+    responder.HandleDiff(false, request, announce);
+    BOOST_CHECK(Sorted(announce) == responder_set);
+}
+
+BOOST_AUTO_TEST_CASE(reconcile_timeout)
+{
+    TxReconciliationState initiator(true, 1, 2), responder(false, 2, 1);
+    const std::vector<uint256> initiator_set = AddRandom(initiator, 5);
+    const std::vector<uint256> responder_set = AddRandom(responder, 5);
+
+    // The responder does not answer in time.
+    initiator.StartRequest(100, 10);
+    BOOST_CHECK(!initiator.IsRequestExpired(9));
+    BOOST_CHECK(!responder.IsRequestExpired(10));
+    BOOST_CHECK(initiator.IsRequestExpired(10));
+    std::vector<uint256> announce;
+    initiator.AbandonRequest(announce);
+    BOOST_CHECK(Sorted(announce) == initiator_set);
+    BOOST_CHECK(!initiator.IsInProgress());
+    BOOST_CHECK(!initiator.IsRequestExpired(10));
+
+    // Its answer arrives late, before the next request.
+    std::vector<unsigned char> stale_sketch;
+    responder.HandleRequest(0, stale_sketch, announce);
+    BOOST_CHECK(announce.empty());
+    BOOST_CHECK(responder.IsInProgress());
+
+    // The next request makes the responder announce the abandoned set.
+    const std::vector<uint256> initiator_only = AddRandom(initiator, 2);
+    BOOST_CHECK(initiator.IsRequestDue(100));
+    std::vector<unsigned char> sketch;
+    responder.HandleRequest(initiator.StartRequest(200, 110), sketch, announce);
+    BOOST_CHECK(Sorted(announce) == responder_set);
+
+    // Sketches arrive in order: the stale one is skipped, the next one reconciles.
+    BOOST_CHECK(initiator.SkipStaleSketch());
+    BOOST_CHECK(!initiator.SkipStaleSketch());
+    std::vector<uint32_t> request;
+    BOOST_CHECK(initiator.HandleSketch(sketch, announce, request));
+    BOOST_CHECK(Sorted(announce) == initiator_only);
+    BOOST_CHECK(request.empty());
+    responder.HandleDiff(true, request, announce);
+    BOOST_CHECK(announce.empty());
+}
+
+BOOST_AUTO_TEST_CASE(reconcile_limits)
+{
+    BOOST_CHECK_EQUAL(TxReconciliationState::EstimateCapacity(0, 0), 1U);
+    BOOST_CHECK_EQUAL(TxReconciliationState::EstimateCapacity(10, 2), 9U);
+    BOOST_CHECK_EQUAL(TxReconciliationState::EstimateCapacity(1000, 1000), TxReconciliationState::MAX_SKETCH_CAPACITY);
+    BOOST_CHECK(!TxReconciliationState::IsValidSketch({}));
+    BOOST_CHECK(!TxReconciliationState::IsValidSketch(std::vector<unsigned char>(4)));
+    BOOST_CHECK(!TxReconciliationState::IsValidSketch(std::vector<unsigned char>(9)));
+    BOOST_CHECK(TxReconciliationState::IsValidSketch(std::vector<unsigned char>(8)));
+    BOOST_CHECK(TxReconciliationState::IsValidSketch(std::vector<unsigned char>(4 * 129)));
+    BOOST_CHECK(!TxReconciliationState::IsValidSketch(std::vector<unsigned char>(4 * 130)));
+
+    TxReconciliationState state(false, 1, 2);
+    for (size_t i = 0; i < TxReconciliationState::MAX_SET_SIZE; ++i) {
+        BOOST_CHECK(state.Add(InsecureRand256()));
+    }
+    BOOST_CHECK(!state.Add(InsecureRand256()));
+    BOOST_CHECK_EQUAL(state.GetSetSize(), TxReconciliationState::MAX_SET_SIZE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
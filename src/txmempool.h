@@ -18,6 +18,7 @@
 #include <crypto/siphash.h>
 #include <indirectmap.h>
 #include <policy/feerate.h>
+#include <prevector.h>
 #include <primitives/transaction.h>
 #include <sync.h>
 #include <random.h>
@@ -61,10 +62,20 @@ class CTxMemPool;
  * (nCountWithDescendants, nSizeWithDescendants, and nModFeesWithDescendants) for
  * all ancestors of the newly added transaction.
  *
+ * The entry also holds the links to its direct in-mempool parents and children.
+ * These are kept inline (rather than in a separate map owned by the mempool) to
+ * avoid a map node and two std::set allocations per transaction; the links are
+ * only modified by CTxMemPool, which is why they are mutable.
+ *
  */
 
 class CTxMemPoolEntry
 {
+public:
+    //! Direct in-mempool parents or children, sorted by txid. Most transactions
+    //! have at most a couple of each, which then fit without heap allocation.
+    typedef prevector<2, const CTxMemPoolEntry*> Links;
+
 private:
     const CTransactionRef tx;
     const CAmount nFee;             //!< Cached to avoid expensive parent-transaction lookups
@@ -90,6 +101,11 @@ private:
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
 
+    mutable Links m_parents;  //!< Maintained by CTxMemPool, see UpdateParent()
+    mutable Links m_children; //!< Maintained by CTxMemPool, see UpdateChild()
+
+    friend class CTxMemPool;
+
 public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, unsigned int _entryHeight,
@@ -129,6 +145,9 @@ public:
     CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
+    const Links& GetMemPoolParentsConst() const { return m_parents; }
+    const Links& GetMemPoolChildrenConst() const { return m_children; }
+
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
 };
 
@@ -394,8 +413,9 @@ public:
  *
  * In order for the feerate sort to remain correct, we must update transactions
  * in the mempool when new descendants arrive.  To facilitate this, we track
- * the set of in-mempool direct parents and direct children in mapLinks.  Within
- * each CTxMemPoolEntry, we track the size and fees of all descendants.
+ * the set of in-mempool direct parents and direct children in each
+ * CTxMemPoolEntry.  Within each CTxMemPoolEntry, we also track the size and
+ * fees of all descendants.
  *
  * Usually when a new transaction is added to the mempool, it has no in-mempool
  * children (because any such children would be an orphan).  So in
@@ -427,7 +447,7 @@ public:
  * state, to account for in-mempool, out-of-block descendants for all the
  * in-block transactions by calling UpdateTransactionsFromBlock().  Note that
  * until this is called, the mempool state is not consistent, and in particular
- * mapLinks may not be correct (and therefore functions like
+ * the parent/child links may not be correct (and therefore functions like
  * CalculateMemPoolAncestors() and CalculateDescendants() that rely
  * on them to walk the mempool are not generally safe to use).
  *
@@ -536,20 +556,14 @@ public:
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
-    const setEntries & GetMemPoolParents(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
-    const setEntries & GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    const CTxMemPoolEntry::Links& GetMemPoolParents(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    const CTxMemPoolEntry::Links& GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
-    struct TxLinks {
-        setEntries parents;
-        setEntries children;
-    };
-
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
-    txlinksMap mapLinks;
-
+    /** Add or remove link from a parent/child list, keeping cachedInnerUsage in sync. */
+    void UpdateLinks(CTxMemPoolEntry::Links& links, const CTxMemPoolEntry& link, bool add);
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -642,7 +656,7 @@ public:
      *  limitDescendantSize = max size of descendants any ancestor can have
      *  errString = populated with error reason if any limits are hit
      *  fSearchForParents = whether to search a tx's vin for in-mempool parents, or
-     *    look up parents from mapLinks. Must be true for entries not in the mempool
+     *    look up parents from the entry's links. Must be true for entries not in the mempool
      */
     bool CalculateMemPoolAncestors(const CTxMemPoolEntry& entry, setEntries& setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string& errString, bool fSearchForParents = true) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
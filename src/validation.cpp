@@ -14,10 +14,10 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
-#include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <index/txindex.h>
+#include <node/mempool_journal.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
@@ -49,6 +49,7 @@
 #include <future>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -1353,16 +1354,16 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 }
 
 
-static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
+static ShardedValidityCache scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
 
 void InitScriptExecutionCache() {
-    // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
-    // setup_bytes creates the minimum possible cache (2 elements).
-    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
-    size_t nElems = scriptExecutionCache.setup_bytes(nMaxCacheSize);
-    LogPrintf("Using %zu MiB out of %zu/2 requested for script execution cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+    SetupValidityCache(scriptExecutionCache, "script execution");
+}
+
+ValidityCacheStats GetScriptExecutionCacheStats()
+{
+    return scriptExecutionCache.GetStats();
 }
 
 /**
@@ -1406,8 +1407,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             // round - giving us 19 + 32 + 4 = 55 bytes (+ 8 + 1 = 64)
             static_assert(55 - sizeof(flags) - 32 >= 128/8, "Want at least 128 bits of nonce for script execution cache");
             CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
-            AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
-            if (scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
+            if (scriptExecutionCache.Contains(hashCacheEntry, !cacheFullScriptStore)) {
                 return true;
             }
 
@@ -1454,7 +1454,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             if (cacheFullScriptStore && !pvChecks) {
                 // We executed all of the provided scripts, and were told to
                 // cache the result. Do so now.
-                scriptExecutionCache.insert(hashCacheEntry);
+                scriptExecutionCache.Insert(hashCacheEntry);
             }
         }
     }
@@ -1667,7 +1667,7 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128, MAX_SCRIPTCHECK_THREADS);
 
 void ThreadScriptCheck(int worker_num) {
     util::ThreadRename(strprintf("scriptch.%i", worker_num));
@@ -4732,7 +4732,113 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(chainActive.Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_JOURNAL = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+//! Number of transactions whose scripts are checked in parallel ahead of adding them in LoadMempool
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
+
+static Mutex g_mempool_journal_mutex;
+//! Shared, so that the journal can be committed to disk without holding g_mempool_journal_mutex
+static std::shared_ptr<MempoolJournal> g_mempool_journal GUARDED_BY(g_mempool_journal_mutex);
+
+static std::shared_ptr<MempoolJournal> GetMempoolJournal(const CTxMemPool& pool)
+{
+    LOCK(g_mempool_journal_mutex);
+    if (!g_mempool_journal || g_mempool_journal->GetAttachedPool() != &pool) return nullptr;
+    return g_mempool_journal;
+}
+
+static fs::path MempoolJournalPath()
+{
+    return GetDataDir() / "mempool.journal";
+}
+
+namespace {
+struct MempoolLoadEntry {
+    CTransactionRef tx;
+    int64_t nTime;
+    int64_t nFeeDelta;
+};
+} // namespace
+
+/** Order entries so that every transaction comes after its in-set parents, otherwise keeping their order. */
+static std::vector<MempoolLoadEntry> SortForLoad(std::vector<MempoolLoadEntry>&& entries)
+{
+    std::unordered_map<uint256, size_t, SaltedTxidHasher> index;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        index.emplace(entries[i].tx->GetHash(), i);
+    }
+
+    // Iterative depth-first post-order walk over in-set parents.
+    std::vector<MempoolLoadEntry> sorted;
+    sorted.reserve(entries.size());
+    std::vector<bool> visited(entries.size(), false);
+    std::vector<std::pair<size_t, size_t>> stack; // entry index, next input to look at
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (visited[i]) continue;
+        visited[i] = true;
+        stack.emplace_back(i, 0);
+        while (!stack.empty()) {
+            const size_t pos = stack.back().first;
+            const CTransaction& tx = *entries[pos].tx;
+            if (stack.back().second < tx.vin.size()) {
+                const auto it = index.find(tx.vin[stack.back().second++].prevout.hash);
+                if (it != index.end() && !visited[it->second]) {
+                    visited[it->second] = true;
+                    stack.emplace_back(it->second, 0);
+                }
+            } else {
+                sorted.push_back(std::move(entries[pos]));
+                stack.pop_back();
+            }
+        }
+    }
+    return sorted;
+}
+
+/**
+ * Verify the scripts of a batch of transactions on the script check threads,
+ * storing the results in the signature cache, so that the (sequential)
+ * AcceptToMemoryPool calls that follow mostly hit the cache. Transactions whose
+ * inputs cannot be found are skipped; failures are left for ATMP to report.
+ */
+static void WarmSignatureCache(std::vector<MempoolLoadEntry>::const_iterator begin, std::vector<MempoolLoadEntry>::const_iterator end,
+                               const std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher>& loaded)
+{
+    if (!nScriptCheckThreads) return;
+
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(end - begin);
+    std::vector<CScriptCheck> checks;
+    {
+        LOCK(cs_main);
+        for (auto it = begin; it != end; ++it) {
+            const CTransaction& tx = *it->tx;
+            std::vector<CTxOut> spent;
+            spent.reserve(tx.vin.size());
+            for (const CTxIn& txin : tx.vin) {
+                const Coin& coin = pcoinsTip->AccessCoin(txin.prevout);
+                if (!coin.IsSpent()) {
+                    spent.push_back(coin.out);
+                    continue;
+                }
+                const auto parent = loaded.find(txin.prevout.hash);
+                if (parent == loaded.end() || txin.prevout.n >= parent->second->vout.size()) break;
+                spent.push_back(parent->second->vout[txin.prevout.n]);
+            }
+            if (spent.size() != tx.vin.size()) continue;
+
+            txdata.emplace_back(tx);
+            for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+                checks.emplace_back(spent[i], tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, true /* cacheStore */, &txdata.back());
+            }
+        }
+    }
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(checks);
+    control.Wait();
+}
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -4751,30 +4857,76 @@ bool LoadMempool(CTxMemPool& pool)
     int64_t already_there = 0;
     int64_t nNow = GetTime();
 
+    std::vector<MempoolLoadEntry> entries;
+    std::map<uint256, CAmount> mapDeltas;
+    uint64_t journal_id = 0;
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_NO_JOURNAL) {
             return false;
         }
+        if (version == MEMPOOL_DUMP_VERSION) {
+            file >> journal_id;
+        }
         uint64_t num;
         file >> num;
         while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
+            MempoolLoadEntry entry;
+            file >> entry.tx;
+            file >> entry.nTime;
+            file >> entry.nFeeDelta;
+            entries.push_back(std::move(entry));
+        }
+        file >> mapDeltas;
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    // Apply the changes recorded since the dump was written.
+    std::map<uint256, size_t> positions;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        positions.emplace(entries[i].tx->GetHash(), i);
+    }
+    bool replayed = MempoolJournal::Replay(MempoolJournalPath(), journal_id,
+        [&](const CTransactionRef& tx, int64_t nTime) {
+            if (positions.emplace(tx->GetHash(), entries.size()).second) {
+                entries.push_back(MempoolLoadEntry{tx, nTime, 0});
+            }
+        },
+        [&](const uint256& txid) {
+            auto it = positions.find(txid);
+            if (it != positions.end()) {
+                entries[it->second].tx = nullptr;
+                positions.erase(it);
+            }
+        });
+    if (replayed) {
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const MempoolLoadEntry& e) { return e.tx == nullptr; }), entries.end());
+    }
+    entries = SortForLoad(std::move(entries));
+
+    std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher> loaded;
+    for (const MempoolLoadEntry& entry : entries) {
+        loaded.emplace(entry.tx->GetHash(), entry.tx);
+    }
+
+    for (size_t batch = 0; batch < entries.size(); batch += MEMPOOL_LOAD_BATCH_SIZE) {
+        const auto batch_begin = entries.cbegin() + batch;
+        const auto batch_end = entries.cbegin() + std::min(entries.size(), batch + MEMPOOL_LOAD_BATCH_SIZE);
+        WarmSignatureCache(batch_begin, batch_end, loaded);
+
+        for (auto it = batch_begin; it != batch_end; ++it) {
+            const CTransactionRef& tx = it->tx;
+            CAmount amountdelta = it->nFeeDelta;
             if (amountdelta) {
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
             CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+            if (it->nTime + nExpiryTimeout > nNow) {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, nTime,
+                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, it->nTime,
                                            nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
                                            false /* test_accept */);
                 if (state.IsValid()) {
@@ -4796,15 +4948,10 @@ bool LoadMempool(CTxMemPool& pool)
             if (ShutdownRequested())
                 return false;
         }
-        std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
+    }
 
-        for (const auto& i : mapDeltas) {
-            pool.PrioritiseTransaction(i.first, i.second);
-        }
-    } catch (const std::exception& e) {
-        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
-        return false;
+    for (const auto& i : mapDeltas) {
+        pool.PrioritiseTransaction(i.first, i.second);
     }
 
     LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
@@ -4817,17 +4964,24 @@ bool DumpMempool(const CTxMemPool& pool)
 
     std::map<uint256, CAmount> mapDeltas;
     std::vector<TxMempoolInfo> vinfo;
+    uint64_t journal_id = 0;
 
     static Mutex dump_mutex;
     LOCK(dump_mutex);
 
+    const std::shared_ptr<MempoolJournal> journal = GetMempoolJournal(pool);
     {
         LOCK(pool.cs);
         for (const auto &i : pool.mapDeltas) {
             mapDeltas[i.first] = i.second;
         }
         vinfo = pool.infoAll();
+
+        // Changes made after this point go to a new journal extending this dump.
+        if (journal) journal_id = journal->Rotate();
     }
+    // Create the new journal file before the dump that refers to it.
+    if (journal) journal->Commit();
 
     int64_t mid = GetTimeMicros();
 
@@ -4841,6 +4995,7 @@ bool DumpMempool(const CTxMemPool& pool)
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
         file << version;
+        file << journal_id;
 
         file << (uint64_t)vinfo.size();
         for (const auto& i : vinfo) {
@@ -4861,9 +5016,50 @@ bool DumpMempool(const CTxMemPool& pool)
         LogPrintf("Failed to dump mempool: %s. Continuing anyway.\n", e.what());
         return false;
     }
+
+    if (journal) journal->DiscardPrevious();
     return true;
 }
 
+void StartMempoolJournal(CTxMemPool& pool)
+{
+    {
+        LOCK(pool.cs);
+        LOCK(g_mempool_journal_mutex);
+        g_mempool_journal = std::make_shared<MempoolJournal>(MempoolJournalPath());
+        g_mempool_journal->Attach(pool);
+    }
+    // Changes are only written once the journal is rotated by a dump, which
+    // also folds in whatever was replayed from the previous journal.
+    DumpMempool(pool);
+}
+
+void FlushMempoolJournal(CTxMemPool& pool)
+{
+    const std::shared_ptr<MempoolJournal> journal = GetMempoolJournal(pool);
+    if (!journal) return;
+    if (journal->Commit() > MAX_MEMPOOL_JOURNAL_SIZE) {
+        DumpMempool(pool);
+    }
+}
+
+void StopMempoolJournal()
+{
+    std::shared_ptr<MempoolJournal> journal;
+    {
+        LOCK(g_mempool_journal_mutex);
+        if (!g_mempool_journal) return;
+        journal = std::move(g_mempool_journal);
+    }
+    // Make sure no mempool notification is still being written to it. The
+    // last reference (possibly a concurrent flush) commits it to disk.
+    {
+        LOCK(journal->GetAttachedPool()->cs);
+        journal->Detach();
+    }
+    journal.reset();
+}
+
 //! Guess how far we are in the verification process at the given block index
 //! require cs_main if pindex has not been validated yet (because nChainTx might be unset)
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex *pindex) {
@@ -46,6 +46,7 @@ struct ChainTxData;
 
 struct PrecomputedTransactionData;
 struct LockPoints;
+struct ValidityCacheStats;
 
 /** Default for -whitelistrelay. */
 static const bool DEFAULT_WHITELISTRELAY = true;
@@ -73,7 +74,9 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
 /** Maximum number of script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 16;
+static const int MAX_SCRIPTCHECK_THREADS = 256;
+/** Maximum number of script-checking threads used when derived from the number of cores */
+static const int MAX_AUTO_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
@@ -114,6 +117,10 @@ static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** How often to sync the mempool journal to disk, in seconds */
+static const unsigned int MEMPOOL_JOURNAL_FLUSH_INTERVAL = 10;
+/** Size at which the mempool journal is folded into a new mempool.dat, in bytes */
+static const uint64_t MAX_MEMPOOL_JOURNAL_SIZE = 64 * 1000 * 1000;
 /** Default for -mempoolreplacement */
 static const bool DEFAULT_ENABLE_REPLACEMENT = true;
 /** Default for using fee filter */
@@ -369,6 +376,9 @@ public:
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
+/** Usage counters of the script-execution cache */
+ValidityCacheStats GetScriptExecutionCacheStats();
+
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
@@ -475,9 +485,18 @@ CBlockFileInfo* GetBlockFileInfo(size_t n);
 /** Dump the mempool to disk. */
 bool DumpMempool(const CTxMemPool& pool);
 
-/** Load the mempool from disk. */
+/** Load the mempool from disk, including changes recorded in the mempool journal. */
 bool LoadMempool(CTxMemPool& pool);
 
+/** Start recording mempool changes in a journal extending mempool.dat. Dumps the mempool. */
+void StartMempoolJournal(CTxMemPool& pool);
+
+/** Sync the mempool journal to disk, and fold it into a new dump once it has grown large. */
+void FlushMempoolJournal(CTxMemPool& pool);
+
+/** Stop recording mempool changes. */
+void StopMempoolJournal();
+
 //! Check whether the block associated with this index entry is pruned or not.
 inline bool IsBlockPruned(const CBlockIndex* pblockindex)
 {
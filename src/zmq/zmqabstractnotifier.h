@@ -9,6 +9,8 @@
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+class uint256;
+enum class MemPoolRemovalReason;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
@@ -43,6 +45,12 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
 
+    // Mempool and chain events, in the order they happened
+    virtual bool NotifyBlockConnect(const uint256 &hash);
+    virtual bool NotifyBlockDisconnect(const uint256 &hash);
+    virtual bool NotifyTransactionAcceptance(const CTransaction &transaction);
+    virtual bool NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason);
+
 protected:
     void *psocket;
     std::string type;
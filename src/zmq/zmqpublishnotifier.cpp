@@ -5,17 +5,21 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <streams.h>
+#include <txmempool.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
 #include <util/system.h>
 #include <rpc/server.h>
 
+#include <assert.h>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_SEQUENCE  = "sequence";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -206,3 +210,61 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+/**
+ * The byte that follows 'R' in a sequence message. These values are part of
+ * the notification interface (see doc/zmq.md) and must not change, whatever
+ * the order of MemPoolRemovalReason.
+ */
+static uint8_t SequenceRemovalReason(MemPoolRemovalReason reason)
+{
+    switch (reason) {
+    case MemPoolRemovalReason::UNKNOWN: return 0;
+    case MemPoolRemovalReason::EXPIRY: return 1;
+    case MemPoolRemovalReason::SIZELIMIT: return 2;
+    case MemPoolRemovalReason::REORG: return 3;
+    case MemPoolRemovalReason::BLOCK: return 4;
+    case MemPoolRemovalReason::CONFLICT: return 5;
+    case MemPoolRemovalReason::REPLACED: return 6;
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+static bool SendSequenceMsg(CZMQAbstractPublishNotifier& notifier, const uint256& hash, char label, int reason = -1)
+{
+    unsigned char data[sizeof(uint256) + 2];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    data[32] = label;
+    size_t size = 33;
+    if (reason >= 0) {
+        data[size++] = reason;
+    }
+    return notifier.SendMessage(MSG_SEQUENCE, data, size);
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockConnect(const uint256 &hash)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence block connect %s\n", hash.GetHex());
+    return SendSequenceMsg(*this, hash, 'C');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockDisconnect(const uint256 &hash)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence block disconnect %s\n", hash.GetHex());
+    return SendSequenceMsg(*this, hash, 'D');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionAcceptance(const CTransaction &transaction)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence mempool acceptance %s\n", hash.GetHex());
+    return SendSequenceMsg(*this, hash, 'A');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence mempool removal %s\n", hash.GetHex());
+    return SendSequenceMsg(*this, hash, 'R', SequenceRemovalReason(reason));
+}
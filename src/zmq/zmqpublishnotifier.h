@@ -52,4 +52,21 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+/**
+ * Publishes every change to the mempool and the active chain as a hash
+ * followed by a one byte label: 'A' (added to mempool), 'R' (removed from
+ * mempool, followed by a one byte MemPoolRemovalReason), 'C' (block
+ * connected, implying its transactions left the mempool) or 'D' (block
+ * disconnected). Subscribers can use the message sequence number to detect
+ * dropped messages and resync with getrawmempool.
+ */
+class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnect(const uint256 &hash) override;
+    bool NotifyBlockDisconnect(const uint256 &hash) override;
+    bool NotifyTransactionAcceptance(const CTransaction &transaction) override;
+    bool NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test large RPC results streamed as chunked HTTP replies.
+
+getrawmempool true and getblock with verbosity 2 stream their result once it
+is larger than one chunk (64 KiB). Check that such replies are chunked and
+that their body is the same JSON-RPC reply as the one built in memory for a
+batch request, which is never streamed.
+"""
+
+from decimal import Decimal
+import http.client
+import json
+import urllib.parse
+
+from test_framework.messages import CTransaction, FromHex, ToHex
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, str_to_b64str
+
+NUM_OUTPUTS = 500
+NUM_SPENDS = 200
+
+
+class HTTPChunkedTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def rpc_request(self, method, params):
+        """Send one JSON-RPC request, returning the response and its parsed body."""
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        headers = {"Authorization": "Basic " + str_to_b64str(url.username + ':' + url.password)}
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('POST', '/', json.dumps({"method": method, "params": params, "id": 1}), headers)
+        response = conn.getresponse()
+        body = json.loads(response.read().decode(), parse_float=Decimal)
+        conn.close()
+        return response, body
+
+    def check_streamed(self, method, params):
+        response, body = self.rpc_request(method, params)
+        assert_equal(response.status, 200)
+        assert_equal(response.getheader('Transfer-Encoding'), 'chunked')
+        assert_equal(response.getheader('Content-Length'), None)
+        assert_equal(body['error'], None)
+        assert_equal(body['id'], 1)
+        batch = self.nodes[0].batch([getattr(self.nodes[0], method).get_request(*params)])
+        assert_equal(body['result'], batch[0]['result'])
+        return body['result']
+
+    def run_test(self):
+        node = self.nodes[0]
+        key = node.get_deterministic_priv_key()
+
+        self.log.info("Create a transaction with %d outputs" % NUM_OUTPUTS)
+        coinbase = node.getblock(node.getblockhash(1), 2)['tx'][0]
+        amount = Decimal('0.0999')
+        tx = FromHex(CTransaction(), node.createrawtransaction([{'txid': coinbase['txid'], 'vout': 0}], {key.address: amount}))
+        tx.vout *= NUM_OUTPUTS
+        fanout_txid = node.sendrawtransaction(node.signrawtransactionwithkey(ToHex(tx), [key.key])['hex'])
+        block_hash = node.generatetoaddress(1, key.address)[0]
+
+        self.log.info("Check that getblock with verbosity 2 is streamed")
+        block = self.check_streamed('getblock', [block_hash, 2])
+        assert_equal(block['tx'][1]['txid'], fanout_txid)
+        assert_equal(len(block['tx'][1]['vout']), NUM_OUTPUTS)
+
+        self.log.info("Fill the mempool with %d transactions" % NUM_SPENDS)
+        txids = []
+        for n in range(NUM_SPENDS):
+            raw_tx = node.createrawtransaction([{'txid': fanout_txid, 'vout': n}], {key.address: amount - Decimal('0.0001')})
+            txids.append(node.sendrawtransaction(node.signrawtransactionwithkey(raw_tx, [key.key])['hex']))
+
+        self.log.info("Check that getrawmempool true is streamed")
+        mempool = self.check_streamed('getrawmempool', [True])
+        assert_equal(sorted(mempool.keys()), sorted(txids))
+
+        self.log.info("Check that small results are not streamed")
+        response, body = self.rpc_request('getrawmempool', [False])
+        assert_equal(response.getheader('Transfer-Encoding'), None)
+        assert_equal(sorted(body['result']), sorted(txids))
+
+
+if __name__ == '__main__':
+    HTTPChunkedTest().main()
@@ -3,6 +3,7 @@
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Test the ZMQ notification interface."""
+from decimal import Decimal
 import struct
 
 from test_framework.address import ADDRESS_BCRT1_UNSPENDABLE
@@ -15,6 +16,12 @@ from test_framework.util import (
 from io import BytesIO
 
 ADDRESS = "tcp://127.0.0.1:28332"
+# The sequence notifier publishes on its own socket, so that its messages
+# are checked independently of the order of the other topics.
+SEQUENCE_ADDRESS = "tcp://127.0.0.1:28333"
+
+# Removal reasons of the sequence notifier, see doc/zmq.md
+REMOVAL_REPLACED = 6
 
 class ZMQSubscriber:
     def __init__(self, socket, topic):
@@ -62,8 +69,14 @@ class ZMQTest (BitcoinTestFramework):
         self.rawblock = ZMQSubscriber(socket, b"rawblock")
         self.rawtx = ZMQSubscriber(socket, b"rawtx")
 
+        sequence_socket = self.zmq_context.socket(zmq.SUB)
+        sequence_socket.set(zmq.RCVTIMEO, 60000)
+        sequence_socket.connect(SEQUENCE_ADDRESS)
+        self.sequence = ZMQSubscriber(sequence_socket, b"sequence")
+
         self.extra_args = [
-            ["-zmqpub%s=%s" % (sub.topic.decode(), ADDRESS) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]],
+            ["-zmqpub%s=%s" % (sub.topic.decode(), ADDRESS) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]] +
+            ["-zmqpubsequence=%s" % SEQUENCE_ADDRESS],
             [],
         ]
         self.add_nodes(self.num_nodes, self.extra_args)
@@ -105,6 +118,9 @@ class ZMQTest (BitcoinTestFramework):
             block = self.rawblock.receive()
             assert_equal(genhashes[x], hash256(block[:80]).hex())
 
+            # Should receive the block connection, with no removal for the coinbase.
+            assert_equal(self.receive_sequence(), (genhashes[x], b'C', None))
+
         if self.is_wallet_compiled():
             self.log.info("Wait for tx from second node")
             payment_txid = self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 1.0)
@@ -119,15 +135,65 @@ class ZMQTest (BitcoinTestFramework):
             assert_equal(payment_txid, hash256(hex).hex())
 
 
+            # Should receive its acceptance to the mempool of the first node.
+            assert_equal(self.receive_sequence(), (payment_txid, b'A', None))
+
+        self._zmq_sequence_test()
+
         self.log.info("Test the getzmqnotifications RPC")
         assert_equal(self.nodes[0].getzmqnotifications(), [
             {"type": "pubhashblock", "address": ADDRESS, "hwm": 1000},
             {"type": "pubhashtx", "address": ADDRESS, "hwm": 1000},
             {"type": "pubrawblock", "address": ADDRESS, "hwm": 1000},
             {"type": "pubrawtx", "address": ADDRESS, "hwm": 1000},
+            {"type": "pubsequence", "address": SEQUENCE_ADDRESS, "hwm": 1000},
         ])
 
         assert_equal(self.nodes[1].getzmqnotifications(), [])
 
+    def receive_sequence(self):
+        """Receive a sequence message as (hash, label, removal reason or None)."""
+        body = self.sequence.receive()
+        reason = body[33] if len(body) > 33 else None
+        return body[:32].hex(), body[32:33], reason
+
+    def spend_coinbase(self, height, fee):
+        """Create a replaceable transaction spending the coinbase of the block at height."""
+        node = self.nodes[0]
+        key = node.get_deterministic_priv_key()
+        coinbase = node.getblock(node.getblockhash(height), 2)['tx'][0]
+        raw_tx = node.createrawtransaction([{'txid': coinbase['txid'], 'vout': 0}], {key.address: coinbase['vout'][0]['value'] - fee}, 0, True)
+        signed = node.signrawtransactionwithkey(raw_tx, [key.key])
+        assert signed['complete']
+        return signed['hex']
+
+    def _zmq_sequence_test(self):
+        node = self.nodes[0]
+        if node.getrawmempool():
+            # Clear the payment of the wallet test out of the way.
+            block_hash = node.generatetoaddress(1, ADDRESS_BCRT1_UNSPENDABLE)[0]
+            assert_equal(self.receive_sequence(), (block_hash, b'C', None))
+
+        self.log.info("Test the sequence notifier on mempool acceptance and replacement")
+        txid = node.sendrawtransaction(self.spend_coinbase(1, Decimal('0.0001')))
+        assert_equal(self.receive_sequence(), (txid, b'A', None))
+        replacement_txid = node.sendrawtransaction(self.spend_coinbase(1, Decimal('0.001')))
+        assert_equal(self.receive_sequence(), (txid, b'R', REMOVAL_REPLACED))
+        assert_equal(self.receive_sequence(), (replacement_txid, b'A', None))
+
+        self.log.info("Test the sequence notifier on block connection and disconnection")
+        block_hash = node.generatetoaddress(1, ADDRESS_BCRT1_UNSPENDABLE)[0]
+        # The transaction leaves the mempool implicitly with the block.
+        assert_equal(self.receive_sequence(), (block_hash, b'C', None))
+        node.invalidateblock(block_hash)
+        assert_equal(self.receive_sequence(), (block_hash, b'D', None))
+        # Its transaction returns to the mempool.
+        assert_equal(self.receive_sequence(), (replacement_txid, b'A', None))
+        node.reconsiderblock(block_hash)
+        assert_equal(self.receive_sequence(), (block_hash, b'C', None))
+        assert_equal(node.getrawmempool(), [])
+        self.sync_all()
+
+
 if __name__ == '__main__':
     ZMQTest().main()
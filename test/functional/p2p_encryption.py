@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test encrypted connections between peers (-p2pencryption).
+
+Nodes 0 and 1 both encrypt their connections and use encryption between
+each other; node 2 does not, and talks to both in plaintext. Node 1 first
+tries to set up encryption with node 2, which drops the connection, and then
+connects again in plaintext.
+"""
+
+from decimal import Decimal
+
+from test_framework.mininode import P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    connect_nodes,
+    wait_until,
+)
+
+
+class P2PEncryptionTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 3
+        self.extra_args = [["-p2pencryption"], ["-p2pencryption"], []]
+
+    def setup_network(self):
+        self.setup_nodes()
+        connect_nodes(self.nodes[0], 1)
+        connect_nodes(self.nodes[1], 2)
+        connect_nodes(self.nodes[2], 0)
+        # Node 1 reconnects to node 2 in plaintext
+        wait_until(lambda: len(self.nodes[1].getpeerinfo()) == 2 and all(p['version'] != 0 for p in self.nodes[1].getpeerinfo()))
+
+    def run_test(self):
+        self.log.info("Check that only connections between nodes that both encrypt are encrypted")
+        for peer in self.nodes[0].getpeerinfo():
+            # The outbound peer is node 1
+            assert_equal(peer['encrypted'], not peer['inbound'])
+        for peer in self.nodes[1].getpeerinfo():
+            # The inbound peer is node 0
+            assert_equal(peer['encrypted'], peer['inbound'])
+        for peer in self.nodes[2].getpeerinfo():
+            assert not peer['encrypted']
+
+        self.log.info("Check that plaintext peers can still connect")
+        plain_peer = self.nodes[0].add_p2p_connection(P2PInterface())
+        plain_peer.sync_with_ping()
+        assert not self.nodes[0].getpeerinfo()[-1]['encrypted']
+        self.nodes[0].disconnect_p2ps()
+
+        self.log.info("Relay blocks and transactions over the encrypted connection")
+        self.nodes[2].generate(101)
+        self.sync_all()
+        key = self.nodes[0].get_deterministic_priv_key()
+        coinbase = self.nodes[0].getblock(self.nodes[0].getblockhash(1), 2)['tx'][0]
+        raw_tx = self.nodes[0].createrawtransaction([{'txid': coinbase['txid'], 'vout': 0}], {key.address: coinbase['vout'][0]['value'] - Decimal('0.001')})
+        signed = self.nodes[0].signrawtransactionwithkey(raw_tx, [key.key])
+        assert signed['complete']
+        # Node 2 is disconnected from node 0, so it can only get the
+        # transaction through node 1.
+        self.nodes[2].disconnectnode(nodeid=[p['id'] for p in self.nodes[2].getpeerinfo() if not p['inbound']][0])
+        txid = self.nodes[0].sendrawtransaction(signed['hex'])
+        self.sync_mempools()
+        for node in self.nodes:
+            assert_equal(node.getrawmempool(), [txid])
+        self.nodes[0].generate(1)
+        self.sync_blocks()
+
+        peer = [p for p in self.nodes[0].getpeerinfo() if p['encrypted']][0]
+        assert peer['bytessent_per_msg']['tx'] > 0
+        assert peer['bytessent_per_msg']['version'] > 0
+        assert peer['bytesrecv_per_msg']['version'] > 0
+
+
+if __name__ == '__main__':
+    P2PEncryptionTest().main()
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the -socketevents modes, -netthreads and -msghandlerthreads with many inbound peers.
+
+Every mode supported by the build, and several socket handler and message
+handler threads, are used to serve a large number of loopback peers, each of
+which must complete the handshake and get its pings answered.
+"""
+
+import platform
+import time
+
+from test_framework.messages import msg_getdata, CInv
+from test_framework.mininode import P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, wait_until
+
+NUM_PEERS = 100
+
+class P2PSocketEventsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        # See USE_POLL and USE_EPOLL in compat.h
+        modes = ['epoll', 'poll'] if platform.system() == 'Linux' else ['select']
+
+        self.log.info("Check that an unknown mode is rejected")
+        self.stop_node(0)
+        node.assert_start_raises_init_error(
+            extra_args=['-socketevents=unknown'],
+            expected_msg="Error: Invalid -socketevents ('unknown') specified. Only these modes are supported: {}".format(", ".join(modes)))
+
+        self.log.info("Check that an invalid number of message handler threads is rejected")
+        node.assert_start_raises_init_error(
+            extra_args=['-msghandlerthreads=0'],
+            expected_msg="Error: Invalid -msghandlerthreads (0), must be between 1 and 16")
+
+        runs = [(mode, 1, 1) for mode in modes] + [(modes[0], 4, 1), (modes[0], 4, 4)]
+        for mode, threads, msg_threads in runs:
+            self.log.info("Serve {} peers with -socketevents={} -netthreads={} -msghandlerthreads={}".format(NUM_PEERS, mode, threads, msg_threads))
+            self.start_node(0, extra_args=['-socketevents={}'.format(mode), '-netthreads={}'.format(threads), '-msghandlerthreads={}'.format(msg_threads)])
+            start = time.time()
+            peers = [node.add_p2p_connection(P2PInterface()) for _ in range(NUM_PEERS)]
+            assert_equal(len(node.getpeerinfo()), NUM_PEERS)
+
+            for peer in peers:
+                peer.sync_with_ping()
+
+            # Have every peer download the tip block at once
+            tip = int(node.getbestblockhash(), 16)
+            for peer in peers:
+                peer.send_message(msg_getdata([CInv(2, tip)]))
+            for peer in peers:
+                peer.wait_for_block(tip, timeout=60)
+            self.log.info("Handshakes, pings and block downloads took {:.2f}s".format(time.time() - start))
+
+            node.disconnect_p2ps()
+            wait_until(lambda: len(node.getpeerinfo()) == 0, timeout=60)
+            self.stop_node(0)
+
+if __name__ == '__main__':
+    P2PSocketEventsTest().main()
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test transaction relay by set reconciliation (-txreconciliation).
+
+Nodes 0 and 1 both offer reconciliation and use it on their connection;
+node 2 does not, and relays transactions with node 1 by announcing them.
+"""
+
+from decimal import Decimal
+
+from test_framework.mininode import P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    connect_nodes,
+)
+
+
+class P2PTxReconciliationTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 3
+        self.extra_args = [["-txreconciliation"], ["-txreconciliation"], []]
+
+    def setup_network(self):
+        self.setup_nodes()
+        connect_nodes(self.nodes[0], 1)
+        connect_nodes(self.nodes[1], 2)
+
+    def spend_coinbase(self, node, height):
+        """Spend the coinbase output of the block node 0 mined at height, and send it from node."""
+        key = self.nodes[0].get_deterministic_priv_key()
+        coinbase = node.getblock(node.getblockhash(height), 2)['tx'][0]
+        raw_tx = node.createrawtransaction([{'txid': coinbase['txid'], 'vout': 0}], {key.address: coinbase['vout'][0]['value'] - Decimal('0.001')})
+        signed = node.signrawtransactionwithkey(raw_tx, [key.key])
+        assert signed['complete']
+        return node.sendrawtransaction(signed['hex'])
+
+    def run_test(self):
+        self.log.info("Check that reconciliation is used only between nodes that both offer it")
+        assert self.nodes[0].getpeerinfo()[0]['txreconciliation']
+        for peer in self.nodes[1].getpeerinfo():
+            # The inbound peer is node 0
+            assert_equal(peer['txreconciliation'], peer['inbound'])
+        assert not self.nodes[2].getpeerinfo()[0]['txreconciliation']
+
+        self.log.info("Check that reconciliation is not offered to peers of older versions")
+        old_peer = self.nodes[0].add_p2p_connection(P2PInterface())
+        old_peer.sync_with_ping()
+        assert 'sendrecon' not in old_peer.last_message
+        assert not self.nodes[0].getpeerinfo()[-1]['txreconciliation']
+        self.nodes[0].disconnect_p2ps()
+
+        self.nodes[0].generate(101)
+        self.sync_all()
+
+        self.log.info("Relay transactions from every node")
+        txids = [self.spend_coinbase(node, height) for height, node in enumerate(self.nodes, start=1)]
+        self.sync_mempools()
+        for node in self.nodes:
+            assert_equal(sorted(node.getrawmempool()), sorted(txids))
+
+        self.log.info("Check that nodes 0 and 1 reconciled their transactions")
+        peer = self.nodes[0].getpeerinfo()[0]
+        assert peer['bytessent_per_msg']['reqrecon'] > 0
+        assert peer['bytessent_per_msg']['reconcildiff'] > 0
+        assert peer['bytesrecv_per_msg']['sketch'] > 0
+        assert 'reqrecon' not in self.nodes[2].getpeerinfo()[0]['bytesrecv_per_msg']
+
+
+if __name__ == '__main__':
+    P2PTxReconciliationTest().main()
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getvalidationcacheinfo RPC and the -sigcacheshards option."""
+
+from decimal import Decimal
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+CACHES = ['signature', 'script_execution']
+
+
+class GetValidationCacheInfoTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [[], ["-sigcacheshards=3", "-maxsigcachesize=0"]]
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("Check the sizing of the caches")
+        info = node.getvalidationcacheinfo()
+        for cache in CACHES:
+            assert_equal(info[cache]['shards'], 8)
+            assert_equal(info[cache]['bytes'], info[cache]['max_elements'] * 32)
+            assert info[cache]['bytes'] <= 16 << 20
+            for counter in ['hits', 'misses', 'inserts', 'evictions']:
+                assert_equal(info[cache][counter], 0)
+        info = self.nodes[1].getvalidationcacheinfo()
+        for cache in CACHES:
+            # A zero size leaves the minimum of two entries per shard
+            assert_equal(info[cache]['shards'], 3)
+            assert_equal(info[cache]['max_elements'], 6)
+
+        self.log.info("Check that a transaction validated for the mempool is found in the caches when it is mined")
+        node.generate(101)
+        self.sync_all()
+        key = node.get_deterministic_priv_key()
+        coinbase = node.getblock(node.getblockhash(1), 2)['tx'][0]
+        raw_tx = node.createrawtransaction([{'txid': coinbase['txid'], 'vout': 0}], {key.address: coinbase['vout'][0]['value'] - Decimal('0.001')})
+        signed = node.signrawtransactionwithkey(raw_tx, [key.key])
+        node.sendrawtransaction(signed['hex'])
+        before = node.getvalidationcacheinfo()
+        assert before['signature']['inserts'] > 0
+        assert_equal(before['script_execution']['inserts'], 1)
+        node.generate(1)
+        after = node.getvalidationcacheinfo()
+        assert after['script_execution']['hits'] > before['script_execution']['hits']
+        assert_equal(after['script_execution']['misses'], before['script_execution']['misses'])
+
+
+if __name__ == '__main__':
+    GetValidationCacheInfoTest().main()
@@ -84,6 +84,12 @@ class NetTest(BitcoinTestFramework):
         assert_equal(self.nodes[0].getnetworkinfo()['networkactive'], True)
         assert_equal(self.nodes[0].getnetworkinfo()['connections'], 2)
 
+        # By now, buffers of messages sent and received have been reused
+        buffers = self.nodes[0].getnetworkinfo()['buffers']
+        for direction in ['send', 'receive']:
+            assert_greater_than(buffers[direction]['allocated'], 0)
+            assert_greater_than(buffers[direction]['reused'], 0)
+
     def _test_getaddednodeinfo(self):
         assert_equal(self.nodes[0].getaddednodeinfo(), [])
         # add a node (node2) to node0